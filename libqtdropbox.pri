@@ -5,8 +5,21 @@ HEADERS += qtdropbox_global.h\
            qdropbox.h \
            qtdropbox.h \
            qdropboxjson.h \
+           qdropboxjsondocument.h \
+           qdropboxjsonarray.h \
+           qdropboxjsonstreamreader.h \
+           qdropboxjsonscanner.h \
+           qdropboxjsonwriter.h \
+           qdropboxjsonpath.h \
+           qdropboxjsonsnapshot.h \
            qdropboxaccount.h \
            qdropboxfile.h \
-           qdropboxfileinfo.h
+           qdropboxfileinfo.h \
+           qdropboxdirectorylisting.h \
+           qdropboxreply.h \
+           qdropboxsession.h \
+           qdropboxrequesttable.h \
+           qdropboxrequestscheduler.h \
+           qdropboxratelimiter.h
 
 CONFIG += network
@@ -1,21 +1,50 @@
 QT       += network xml
+!contains(DEFINES, QTDROPBOX_NO_CONCURRENT) {
+    greaterThan(QT_MAJOR_VERSION, 4): QT += concurrent
+}
 
 INCLUDEPATH += $$PWD/src
 
 SOURCES += \
     $$PWD/src/qdropbox.cpp \
     $$PWD/src/qdropboxjson.cpp \
+    $$PWD/src/qdropboxjsondocument.cpp \
+    $$PWD/src/qdropboxjsonarray.cpp \
+    $$PWD/src/qdropboxjsonstreamreader.cpp \
+    $$PWD/src/qdropboxjsonscanner.cpp \
+    $$PWD/src/qdropboxjsonwriter.cpp \
+    $$PWD/src/qdropboxjsonpath.cpp \
+    $$PWD/src/qdropboxjsonsnapshot.cpp \
     $$PWD/src/qdropboxaccount.cpp \
     $$PWD/src/qdropboxfile.cpp \
-    $$PWD/src/qdropboxfileinfo.cpp
+    $$PWD/src/qdropboxfileinfo.cpp \
+    $$PWD/src/qdropboxdirectorylisting.cpp \
+    $$PWD/src/qdropboxreply.cpp \
+    $$PWD/src/qdropboxsession.cpp \
+    $$PWD/src/qdropboxrequesttable.cpp \
+    $$PWD/src/qdropboxrequestscheduler.cpp \
+    $$PWD/src/qdropboxratelimiter.cpp
 
 HEADERS += \
     $$PWD/src/qtdropbox_global.h \
     $$PWD/src/qdropbox.h \
     $$PWD/src/qdropboxjson.h \
+    $$PWD/src/qdropboxjsondocument.h \
+    $$PWD/src/qdropboxjsonarray.h \
+    $$PWD/src/qdropboxjsonstreamreader.h \
+    $$PWD/src/qdropboxjsonscanner.h \
+    $$PWD/src/qdropboxjsonwriter.h \
+    $$PWD/src/qdropboxjsonpath.h \
+    $$PWD/src/qdropboxjsonsnapshot.h \
     $$PWD/src/qdropboxaccount.h \
     $$PWD/src/qdropboxfile.h \
     $$PWD/src/qtdropbox.h \
-    $$PWD/src/qdropboxfileinfo.h
+    $$PWD/src/qdropboxfileinfo.h \
+    $$PWD/src/qdropboxdirectorylisting.h \
+    $$PWD/src/qdropboxreply.h \
+    $$PWD/src/qdropboxsession.h \
+    $$PWD/src/qdropboxrequesttable.h \
+    $$PWD/src/qdropboxrequestscheduler.h \
+    $$PWD/src/qdropboxratelimiter.h
 
 CONFIG += network
@@ -10,22 +10,55 @@ TEMPLATE = lib
 
 DEFINES += QTDROPBOX_LIBRARY
 #          QTDROPBOX_DEBUG
+#          QTDROPBOX_NO_CONCURRENT
+
+# QtConcurrent is part of QtCore in Qt 4, without it responses and directory listings are
+# parsed by the calling thread
+!contains(DEFINES, QTDROPBOX_NO_CONCURRENT) {
+    greaterThan(QT_MAJOR_VERSION, 4): QT += concurrent
+}
 
 SOURCES += \
     src/qdropbox.cpp \
     src/qdropboxjson.cpp \
+    src/qdropboxjsondocument.cpp \
+    src/qdropboxjsonarray.cpp \
+    src/qdropboxjsonstreamreader.cpp \
+    src/qdropboxjsonscanner.cpp \
+    src/qdropboxjsonwriter.cpp \
+    src/qdropboxjsonpath.cpp \
+    src/qdropboxjsonsnapshot.cpp \
     src/qdropboxaccount.cpp \
     src/qdropboxfile.cpp \
-    src/qdropboxfileinfo.cpp
+    src/qdropboxfileinfo.cpp \
+    src/qdropboxdirectorylisting.cpp \
+    src/qdropboxreply.cpp \
+    src/qdropboxsession.cpp \
+    src/qdropboxrequesttable.cpp \
+    src/qdropboxrequestscheduler.cpp \
+    src/qdropboxratelimiter.cpp
 
 HEADERS += \
     src/qtdropbox_global.h \
     src/qdropbox.h \
     src/qdropboxjson.h \
+    src/qdropboxjsondocument.h \
+    src/qdropboxjsonarray.h \
+    src/qdropboxjsonstreamreader.h \
+    src/qdropboxjsonscanner.h \
+    src/qdropboxjsonwriter.h \
+    src/qdropboxjsonpath.h \
+    src/qdropboxjsonsnapshot.h \
     src/qdropboxaccount.h \
     src/qdropboxfile.h \
     src/qtdropbox.h \
-    src/qdropboxfileinfo.h
+    src/qdropboxfileinfo.h \
+    src/qdropboxdirectorylisting.h \
+    src/qdropboxreply.h \
+    src/qdropboxsession.h \
+    src/qdropboxrequesttable.h \
+    src/qdropboxrequestscheduler.h \
+    src/qdropboxratelimiter.h
 
 TARGET = QtDropbox
 
@@ -1,8 +1,133 @@
 #include "qdropbox.h"
+#include "qdropboxreply.h"
+#include "qdropboxjsonstreamreader.h"
+
+#include <QScopedPointer>
+#include <QFutureWatcher>
+#ifndef QTDROPBOX_NO_CONCURRENT
+#include <QtConcurrentRun>
+#endif
+#include <QThread>
+
+//! Parses metadata while it is received and emits the contents of a directory entry by entry
+class QDropboxMetadataStream : public QDropboxJsonHandler
+{
+public:
+    QDropboxMetadataStream(QDropbox *dropbox, bool keep) :
+        reader(this),
+        keepResponse(keep),
+        _dropbox(dropbox),
+        _contentsKey(false),
+        _inContents(false)
+    {
+    }
+
+    bool addData(const QByteArray &data)
+    {
+        if(keepResponse)
+            response.append(data);
+        return reader.addData(data);
+    }
+
+    void key(const QString &key)
+    {
+        _contentsKey = (reader.depth() == 1 && key == "contents");
+    }
+
+    void startArray()
+    {
+        if(_contentsKey && reader.depth() == 2)
+            _inContents = true;
+    }
+
+    void endArray()
+    {
+        if(reader.depth() == 1)
+            _inContents = false;
+    }
+
+    void startObject()
+    {
+        // every entry is parsed on its own as soon as it is complete
+        if(_inContents && reader.depth() == 3)
+            reader.captureCurrent();
+    }
+
+    void captured(const QDropboxJsonValue &value)
+    {
+        QDropboxFileInfo entry(value);
+        entry.freeze();
+        if(entry.isValid())
+            emit _dropbox->metadataContentReceived(entry);
+    }
+
+    QDropboxJsonStreamReader reader;
+    QByteArray               response;
+    bool                     keepResponse;
+
+private:
+    QDropbox *_dropbox;
+    bool      _contentsKey;
+    bool      _inContents;
+};
+
+//! Parses a response and creates the objects needed for its signals, may run on a parser thread
+static qdropbox_parsed_response parseResponse(qdropbox_parsed_response job)
+{
+    job.json.parseUtf8(job.response);
+    if(!job.json.isValid())
+        return job;
+
+    // the results are read by other threads (queued signals, replies), so nothing may be parsed lazily
+    job.json.freeze();
+
+    if(job.needText)
+        job.text = QString::fromUtf8(job.response);
+    if(!job.needObjects)
+        return job;
+
+    switch(job.type)
+    {
+    case QDROPBOX_REQ_ACCINFO:
+        job.account = QDropboxAccount(job.json);
+        break;
+    case QDROPBOX_REQ_METADAT:
+        // the contents are listed here as well, so the receiver does not have to
+    {
+        job.metadata = QDropboxFileInfo(job.json);
+
+        // large listings are built in documents of their own (see QDropboxFileInfo::contents())
+        const QList<QDropboxFileInfo> contents = job.metadata.contents();
+        for(QList<QDropboxFileInfo>::const_iterator it = contents.constBegin(); it != contents.constEnd(); ++it)
+            it->freeze();
+        break;
+    }
+    case QDROPBOX_REQ_REVISIO:
+    {
+        QDropboxJsonArray list = job.json.getJsonArray();
+        job.revisions.reserve(list.size());
+        for(QDropboxJsonArray::const_iterator it = list.begin(); it != list.end(); ++it)
+            job.revisions.append(QDropboxFileInfo(*it));
+        break;
+    }
+    default:
+        break;
+    }
+    return job;
+}
+
+//! Registers the types of the signals, receivers on other threads get them queued
+static void registerMetaTypes()
+{
+    qRegisterMetaType<QDropboxAccount>("QDropboxAccount");
+    qRegisterMetaType<QDropboxFileInfo>("QDropboxFileInfo");
+    qRegisterMetaType<QList<QDropboxFileInfo> >("QList<QDropboxFileInfo>");
+}
 
 QDropbox::QDropbox(QObject *parent) :
     QObject(parent),
-    conManager(this)
+    conManager(this),
+    _dispatchTimer(this)
 {
 #ifdef QTDROPBOX_DEBUG
     qDebug() << "creating dropbox api" << endl;
@@ -18,18 +143,31 @@ QDropbox::QDropbox(QObject *parent) :
     oauthTokenSecret = "";
 
     lastreply = 0;
+    _parseInBackground = false;
 
     connect(&conManager, SIGNAL(finished(QNetworkReply*)), this, SLOT(networkReplyFinished(QNetworkReply*)));
 
     // needed for nonce generation
     qsrand(QDateTime::currentMSecsSinceEpoch());
 
-    _evLoop = NULL;
+    _networkThread = NULL;
+    registerMetaTypes();
+
+    _priority     = QDropbox::NormalPriority;
+    _callPriority = -1;
+    _callCaller   = 0;
+
+    // waiting requests are sent when the rate limit or their retry allows it
+    _maxRetries = 4;
+    _clock.start();
+    _dispatchTimer.setSingleShot(true);
+    connect(&_dispatchTimer, SIGNAL(timeout()), this, SLOT(dispatchRequests()));
 }
 
 QDropbox::QDropbox(QString key, QString sharedSecret, OAuthMethod method, QString url, QObject *parent) :
     QObject(parent),
-    conManager(this)
+    conManager(this),
+    _dispatchTimer(this)
 {
 #ifdef QTDROPBOX_DEBUG
     qDebug() << "creating api with key, shared secret and method" << endl;
@@ -47,13 +185,31 @@ QDropbox::QDropbox(QString key, QString sharedSecret, OAuthMethod method, QStrin
     oauthTokenSecret = "";
 
     lastreply = 0;
+    _parseInBackground = false;
 
     connect(&conManager, SIGNAL(finished(QNetworkReply*)), this, SLOT(networkReplyFinished(QNetworkReply*)));
 
     // needed for nonce generation
     qsrand(QDateTime::currentMSecsSinceEpoch());
 
-    _evLoop = NULL;
+    _networkThread = NULL;
+    registerMetaTypes();
+
+    _priority     = QDropbox::NormalPriority;
+    _callPriority = -1;
+    _callCaller   = 0;
+
+    // waiting requests are sent when the rate limit or their retry allows it
+    _maxRetries = 4;
+    _clock.start();
+    _dispatchTimer.setSingleShot(true);
+    connect(&_dispatchTimer, SIGNAL(timeout()), this, SLOT(dispatchRequests()));
+}
+
+QDropbox::~QDropbox()
+{
+    // with a network thread this runs on that thread, destroyed() stops it afterwards
+    qDeleteAll(streamMap);
 }
 
 QDropbox::Error QDropbox::error()
@@ -106,11 +262,12 @@ void QDropbox::setApiVersion(QString apiversion)
 
 void QDropbox::requestFinished(int nr, QNetworkReply *rply)
 {
+    // streamed responses were partially read by networkReplyReadyRead() already
+    QScopedPointer<QDropboxMetadataStream> stream(streamMap.take(nr));
 #ifdef QTDROPBOX_DEBUG
     int resp_bytes = rply->bytesAvailable();
 #endif
-    QByteArray buff = rply->readAll();
-    QString response = QString(buff);
+    QByteArray response = rply->readAll();
 #ifdef QTDROPBOX_DEBUG
     qDebug() << "request " << nr << "finished." << endl;
     qDebug() << "request was: " << rply->url().toString() << endl;
@@ -119,8 +276,23 @@ void QDropbox::requestFinished(int nr, QNetworkReply *rply)
     qDebug() << "response: " << resp_bytes << "bytes" << endl;
     qDebug() << "status code: " << rply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toString() << endl;
     qDebug() << "== begin response ==" << endl << response << endl << "== end response ==" << endl;
-    qDebug() << "req#" << nr << " is of type " << requestMap[nr].type << endl;
+    qDebug() << "req#" << nr << " is of type " << _requests.value(nr).type << endl;
 #endif
+    // the rate of requests follows the answers of the server
+    const int status = rply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if(status >= 200 && status < 300)
+        _limiter.succeeded();
+    else if(status == QDROPBOX_ERROR_REQUEST_CAP)
+        _limiter.throttled(_clock.elapsed());
+
+    if(retryRequest(nr, rply))
+    {
+        // only successful responses are streamed, so the stream is still empty for the retry
+        if(!stream.isNull())
+            streamMap.insert(nr, stream.take());
+        return;
+    }
+
     // drop box error handling based on return codes
     switch(rply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt())
     {
@@ -128,47 +300,47 @@ void QDropbox::requestFinished(int nr, QNetworkReply *rply)
         errorState = QDropbox::BadInput;
         errorText  = "";
         emit errorOccured(errorState);
-        checkReleaseEventLoop(nr);
+        failRequest(nr, errorState, errorText);
         return;
         break;
     case QDROPBOX_ERROR_EXPIRED_TOKEN:
         errorState = QDropbox::TokenExpired;
         errorText  = "";
         emit tokenExpired();
-        checkReleaseEventLoop(nr);
+        failRequest(nr, errorState, errorText);
         return;
         break;
     case QDROPBOX_ERROR_BAD_OAUTH_REQUEST:
         errorState = QDropbox::BadOAuthRequest;
         errorText  = "";
         emit errorOccured(errorState);
-        checkReleaseEventLoop(nr);
+        failRequest(nr, errorState, errorText);
         return;
         break;
     case QDROPBOX_ERROR_FILE_NOT_FOUND:
         emit fileNotFound();
-        checkReleaseEventLoop(nr);
+        failRequest(nr, QDropbox::FileNotFound, "");
         return;
         break;
     case QDROPBOX_ERROR_WRONG_METHOD:
         errorState = QDropbox::WrongHttpMethod;
         errorText  = "";
         emit errorOccured(errorState);
-        checkReleaseEventLoop(nr);
+        failRequest(nr, errorState, errorText);
         return;
         break;
     case QDROPBOX_ERROR_REQUEST_CAP:
         errorState = QDropbox::MaxRequestsExceeded;
         errorText = "";
         emit errorOccured(errorState);
-        checkReleaseEventLoop(nr);
+        failRequest(nr, errorState, errorText);
         return;
         break;
     case QDROPBOX_ERROR_USER_OVER_QUOTA:
         errorState = QDropbox::UserOverQuota;
         errorText = "";
         emit errorOccured(errorState);
-        checkReleaseEventLoop(nr);
+        failRequest(nr, errorState, errorText);
         return;
         break;
     default:
@@ -184,20 +356,22 @@ void QDropbox::requestFinished(int nr, QNetworkReply *rply)
         qDebug() << "error " << errorState << "(" << errorText << ") in request" << endl;
 #endif
         emit errorOccured(errorState);
+        failRequest(nr, errorState, errorText);
         return;
     }
 
     // ignore connection requests
-    if(requestMap[nr].type == QDROPBOX_REQ_CONNECT)
+    if(_requests.value(nr).type == QDROPBOX_REQ_CONNECT)
     {
 #ifdef QTDROPBOX_DEBUG
         qDebug() << "- answer to connection request ignored" << endl;
 #endif
-        requestMap.remove(nr);
+        _requests.remove(nr);
         return;
     }
 
     bool delayed_finish = false;
+    bool background     = false;
     int delayed_nr;
 
     if(rply->attribute(QNetworkRequest::HttpStatusCodeAttribute) == 302)
@@ -211,69 +385,62 @@ void QDropbox::requestFinished(int nr, QNetworkReply *rply)
         qDebug() << "new url: " << newlocation.toString() << endl;
 #endif
         int oldnr = nr;
-        nr = sendRequest(newlocation, requestMap[nr].method, 0, requestMap[nr].host);
-        requestMap[nr].type = QDROPBOX_REQ_REDIREC;
-        requestMap[nr].linked = oldnr;
+        const qdropbox_request request = _requests.value(nr);
+        nr = sendRequest(newlocation, request.method, 0, request.host, request.priority);
+        if(nr < 0)
+        {
+            failRequest(oldnr, errorState, errorText);
+            return;
+        }
+        _requests.setType(nr, QDROPBOX_REQ_REDIREC);
+        _requests.setLinked(nr, oldnr);
+
+        // the redirection answers the original request, so it streams its response
+        if(!stream.isNull())
+            attachMetadataStream(nr, stream.take());
         return;
     }
     else
     {
-        if(requestMap[nr].type == QDROPBOX_REQ_REDIREC)
+        const qdropbox_request redir = _requests.value(nr);
+        if(redir.type == QDROPBOX_REQ_REDIREC)
         {
             // change values if this is the answert to a redirect
-            qdropbox_request redir = requestMap[nr];
-            qdropbox_request orig  = requestMap[redir.linked];
-            requestMap[nr] = orig;
-            requestMap.remove(nr);
+            _requests.remove(nr);
             nr = redir.linked;
         }
 
         // standard handling depending on message type
-        switch(requestMap[nr].type)
+        switch(_requests.value(nr).type)
         {
         case QDROPBOX_REQ_CONNECT:
             // was only a connect request - so drop it
             break;
         case QDROPBOX_REQ_RQTOKEN:
             // requested a tiken
-            responseTokenRequest(response);
-            break;
-        case QDROPBOX_REQ_RQBTOKN:
-            responseBlockedTokenRequest(response);
+            responseTokenRequest(QString::fromUtf8(response));
             break;
         case QDROPBOX_REQ_AULOGIN:
-            delayed_nr = responseDropboxLogin(response, nr);
+            delayed_nr = responseDropboxLogin(QString::fromUtf8(response), nr);
             delayed_finish = true;
             break;
         case QDROPBOX_REQ_ACCTOKN:
-            responseAccessToken(response);
+            responseAccessToken(QString::fromUtf8(response));
             break;
         case QDROPBOX_REQ_METADAT:
-            parseMetadata(response);
-            break;
-        case QDROPBOX_REQ_BMETADA:
-            parseBlockingMetadata(response);
-			break;
-        case QDROPBOX_REQ_BACCTOK:
-            responseBlockingAccessToken(response);
+            if(!stream.isNull())
+                background = parseMetadataStream(nr, stream.data(), response);
+            else
+                background = parseResponseOf(nr, QDROPBOX_REQ_METADAT, response);
             break;
         case QDROPBOX_REQ_ACCINFO:
-            parseAccountInfo(response);
-            break;
-        case QDROPBOX_REQ_BACCINF:
-            parseBlockingAccountInfo(response);
+            background = parseResponseOf(nr, QDROPBOX_REQ_ACCINFO, response);
             break;
         case QDROPBOX_REQ_SHRDLNK:
-            parseSharedLink(response);
-            break;
-        case QDROPBOX_REQ_BSHRDLN:
-            parseBlockingSharedLink(response);
+            background = parseResponseOf(nr, QDROPBOX_REQ_SHRDLNK, response);
             break;
 		case QDROPBOX_REQ_REVISIO:
-			parseRevisions(response);
-			break;
-		case QDROPBOX_REQ_BREVISI:
-			parseBlockingRevisions(response);
+			background = parseResponseOf(nr, QDROPBOX_REQ_REVISIO, response);
 			break;
         default:
             errorState  = QDropbox::ResponseToUnknownRequest;
@@ -283,25 +450,28 @@ void QDropbox::requestFinished(int nr, QNetworkReply *rply)
         }
     }
 
-    if(delayed_finish)
+    // requests parsed in background are finished as soon as their results are emitted
+    if(delayed_finish && delayed_nr != 0)
         delayMap[delayed_nr] = nr;
-    else
-    {
-        if(delayMap[nr])
-        {
-            int drq = delayMap[nr];
-            while(drq!=0)
-            {
-                emit operationFinished(delayMap[drq]);
-                delayMap.remove(drq);
-                drq = delayMap[drq];
-            }
-        }
+    else if(!background)
+        finishRequest(nr);
+
+    return;
+}
 
-        requestMap.remove(nr);
-        emit operationFinished(nr);
+void QDropbox::finishRequest(int nr)
+{
+    // requests delayed by this one are finished with it, take() leaves no entries behind
+    int drq = delayMap.take(nr);
+    while(drq != 0)
+    {
+        emit operationFinished(drq);
+        drq = delayMap.take(drq);
     }
 
+    _requests.remove(nr);
+    finishReply(nr);
+    emit operationFinished(nr);
     return;
 }
 
@@ -310,8 +480,52 @@ void QDropbox::networkReplyFinished(QNetworkReply *rply)
 #ifdef QTDROPBOX_DEBUG
     qDebug() << "reply finished" << endl;
 #endif
-    int reqnr = replynrMap[rply];
-    requestFinished(reqnr, rply);
+    int reqnr = _requests.id(rply);
+    if(reqnr != 0)
+    {
+        // the connection is free again, a redirection may already use it
+        _scheduler.finished(_requests.value(reqnr).host);
+        requestFinished(reqnr, rply);
+    }
+
+    // the request may still be parsed or redirected, but its reply is done
+    _requests.releaseReply(rply);
+    rply->deleteLater();
+
+    dispatchRequests();
+}
+
+void QDropbox::backgroundParseFinished()
+{
+    QFutureWatcher<qdropbox_parsed_response> *watcher =
+            static_cast<QFutureWatcher<qdropbox_parsed_response>*>(sender());
+    const qdropbox_parsed_response parsed = watcher->result();
+    watcher->deleteLater();
+
+#ifdef QTDROPBOX_DEBUG
+    qDebug() << "response to request " << parsed.nr << " parsed in background" << endl;
+#endif
+    responseParsed(parsed);
+    finishRequest(parsed.nr);
+}
+
+void QDropbox::networkReplyReadyRead()
+{
+    QNetworkReply *rply = qobject_cast<QNetworkReply*>(sender());
+    int reqnr = _requests.id(rply);
+    QDropboxMetadataStream *stream = streamMap.value(reqnr, NULL);
+    if(stream == NULL)
+        return;
+
+    // only successful responses are streamed, anything else is left to requestFinished(),
+    // which keeps the stream if the request is retried or redirected
+    if(rply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200)
+        return;
+
+#ifdef QTDROPBOX_DEBUG
+    qDebug() << "streaming " << rply->bytesAvailable() << " bytes of request " << reqnr << endl;
+#endif
+    stream->addData(rply->readAll());
 }
 /*
 QString QDropbox::hmacsha1(QString base, QString key)
@@ -501,7 +715,7 @@ void QDropbox::prepareApiUrl()
     //  apiurl.setScheme("http");
 }
 
-int QDropbox::sendRequest(QUrl request, QString type, QByteArray postdata, QString host)
+int QDropbox::sendRequest(QUrl request, QString type, QByteArray postdata, QString host, int priority)
 {
     if(!host.trimmed().compare(""))
         host = apiurl.toString(QUrl::RemoveScheme).mid(2);
@@ -521,17 +735,7 @@ int QDropbox::sendRequest(QUrl request, QString type, QByteArray postdata, QStri
     if(!req_str.startsWith("/"))
         req_str = QString("/%1").arg(req_str);
 
-    QNetworkRequest rq(request);
-    QNetworkReply *rply;
-
-    if(!type.compare("GET"))
-        rply = conManager.get(rq);
-    else if(!type.compare("POST"))
-    {
-        rq.setHeader( QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded" );
-        rply = conManager.post(rq, postdata);
-    }
-    else
+    if(type.compare("GET") && type.compare("POST"))
     {
         errorState = QDropbox::UnknownQueryMethod;
         errorText  = "The provided query method is unknown.";
@@ -542,17 +746,146 @@ int QDropbox::sendRequest(QUrl request, QString type, QByteArray postdata, QStri
         return -1;
     }
 
-    replynrMap[rply] = ++lastreply;
+    qdropbox_request req;
+    req.type   = 0;
+    req.method = type;
+    req.host   = host;
+    req.linked   = 0;
+    req.attempts = 0;
+
+    // requests of a call of a client are queued for that client
+    if(priority < 0)
+        priority = _callPriority >= 0 ? _callPriority : _priority;
+    req.priority = priority;
+
+    // the request is only sent once its host has a free connection
+    int nr = _requests.insert(NULL, req);
+    if(nr < 0)
+    {
+        errorState = QDropbox::MaxRequestsExceeded;
+        errorText  = "Too many requests in flight.";
+        emit errorOccured(errorState);
+#ifdef QTDROPBOX_DEBUG
+        qDebug() << "error " << errorState << "(" << errorText << ") in request" << endl;
+#endif
+        return -1;
+    }
+    lastreply = nr;
 
-    requestMap[lastreply].method = type;
-    requestMap[lastreply].host   = host;
+    qdropbox_pending_request pending;
+    pending.nr       = nr;
+    pending.url      = request;
+    pending.method   = type;
+    pending.postdata = postdata;
+    pending.host     = host;
+    _scheduler.enqueue(pending, priority, _callCaller);
 
 #ifdef QTDROPBOX_DEBUG
-    qDebug() << "sendRequest() -> request #" << lastreply << " sent." << endl;
+    qDebug() << "sendRequest() -> request #" << lastreply << " queued." << endl;
 #endif
+    dispatchRequests();
     return lastreply;
 }
 
+bool QDropbox::retryRequest(int nr, QNetworkReply *rply)
+{
+    switch(rply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt())
+    {
+    case 500:
+    case 502:
+    case QDROPBOX_ERROR_REQUEST_CAP:
+    case 504:
+        break;
+    default:
+        return false;
+    }
+
+    // only requests without side effects may be sent twice
+    const qdropbox_request request = _requests.value(nr);
+    if(request.method.compare("GET") || request.attempts >= _maxRetries)
+        return false;
+
+    const qint64 now = _clock.elapsed();
+    qint64 delay = QDropboxRateLimiter::retryDelay(request.attempts);
+    if(rply->hasRawHeader("Retry-After"))
+    {
+        // the server asks all requests to wait, not only this one
+        const qint64 after = QDropboxRateLimiter::retryAfter(rply->rawHeader("Retry-After"),
+                                                            QDateTime::currentMSecsSinceEpoch());
+        if(after >= 0)
+        {
+            delay = after;
+            _limiter.pause(now + delay);
+        }
+    }
+
+    qdropbox_pending_request pending;
+    pending.nr     = nr;
+    pending.url    = rply->url();
+    pending.method = request.method;
+    pending.host   = request.host;
+    _requests.setAttempts(nr, request.attempts + 1);
+    _retries.insert(now + delay, pending);
+
+#ifdef QTDROPBOX_DEBUG
+    qDebug() << "request #" << nr << " retried in " << delay << " ms" << endl;
+#endif
+    return true;
+}
+
+void QDropbox::dispatchRequests()
+{
+    const qint64 now = _clock.elapsed();
+
+    // retries that are due wait with the other requests of their priority
+    QMultiMap<qint64,qdropbox_pending_request>::iterator it = _retries.begin();
+    while(it != _retries.end() && it.key() <= now)
+    {
+        _scheduler.enqueue(it.value(), _requests.value(it.value().nr).priority, 0);
+        it = _retries.erase(it);
+    }
+
+    qdropbox_pending_request pending;
+    qint64 wait = 0;
+    while(_scheduler.queued() > 0 && (wait = _limiter.waitTime(now)) == 0 &&
+          _scheduler.takeNext(&pending))
+    {
+        if(!_requests.contains(pending.nr))
+        {
+            _scheduler.finished(pending.host);
+            continue;
+        }
+        _limiter.acquire(now);
+
+        QNetworkRequest rq(pending.url);
+        QNetworkReply *rply;
+
+        if(!pending.method.compare("POST"))
+        {
+            rq.setHeader( QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded" );
+            rply = conManager.post(rq, pending.postdata);
+        }
+        else
+            rply = conManager.get(rq);
+
+        _requests.setReply(pending.nr, rply);
+        if(streamMap.contains(pending.nr))
+            connect(rply, SIGNAL(readyRead()), this, SLOT(networkReplyReadyRead()));
+
+#ifdef QTDROPBOX_DEBUG
+        qDebug() << "dispatchRequests() -> request #" << pending.nr << " sent." << endl;
+#endif
+    }
+
+    // wake up for the next token of the limiter or the next retry, at least once a minute
+    if(!_retries.isEmpty())
+        wait = (wait > 0) ? qMin(wait, _retries.begin().key() - now) : _retries.begin().key() - now;
+    if(wait > 0)
+        _dispatchTimer.start(int(qMin(wait, qint64(60000))));
+    else
+        _dispatchTimer.stop();
+}
+
 void QDropbox::responseTokenRequest(QString response)
 {
     parseToken(response);
@@ -651,63 +984,304 @@ void QDropbox::parseToken(QString response)
     return;
 }
 
-void QDropbox::parseAccountInfo(QString response)
+qdropbox_parsed_response QDropbox::parseJob(int nr, qdropbox_request_type type, const QByteArray &response)
 {
-#ifdef QTDROPBOX_DEBUG
-    qDebug() << "== account info ==" << response << "== account info end ==";
+    qdropbox_parsed_response job;
+    job.nr       = nr;
+    job.type     = type;
+    job.response = response;
+
+    // strings and objects are only created if anybody is interested in them
+    switch(type)
+    {
+    case QDROPBOX_REQ_ACCINFO:
+        job.needText    = receivers(SIGNAL(accountInfoReceived(QString))) > 0;
+        job.needObjects = receivers(SIGNAL(accountReceived(QDropboxAccount))) > 0;
+        break;
+    case QDROPBOX_REQ_METADAT:
+        job.needText    = receivers(SIGNAL(metadataReceived(QString))) > 0;
+        job.needObjects = receivers(SIGNAL(fileInfoReceived(QDropboxFileInfo))) > 0;
+        break;
+    case QDROPBOX_REQ_SHRDLNK:
+        job.needText    = receivers(SIGNAL(sharedLinkReceived(QString))) > 0;
+        job.needObjects = false;
+        break;
+    case QDROPBOX_REQ_REVISIO:
+        job.needText    = receivers(SIGNAL(revisionsReceived(QString))) > 0;
+        job.needObjects = receivers(SIGNAL(revisionListReceived(QList<QDropboxFileInfo>))) > 0;
+        break;
+    default:
+        job.needText    = false;
+        job.needObjects = false;
+        break;
+    }
+
+    // a reply of the request receives the objects as well
+    if(!replyMap.value(nr).isNull())
+        job.needObjects = true;
+    return job;
+}
+
+// parses the response of a non-blocking request, returns true if it is parsed in background
+bool QDropbox::parseResponseOf(int nr, qdropbox_request_type type, const QByteArray &response)
+{
+#ifndef QTDROPBOX_NO_CONCURRENT
+    if(_parseInBackground)
+    {
+        startBackgroundParse(nr, type, response);
+        return true;
+    }
+#endif
+
+    responseParsed(parseResponse(parseJob(nr, type, response)));
+    return false;
+}
+
+#ifndef QTDROPBOX_NO_CONCURRENT
+void QDropbox::startBackgroundParse(int nr, qdropbox_request_type type, const QByteArray &response)
+{
+    qdropbox_parsed_response job = parseJob(nr, type, response);
+
+    // the watcher belongs to this thread, so finished() is delivered here by the event loop
+    QFutureWatcher<qdropbox_parsed_response> *watcher = new QFutureWatcher<qdropbox_parsed_response>(this);
+    connect(watcher, SIGNAL(finished()), this, SLOT(backgroundParseFinished()));
+    watcher->setFuture(QtConcurrent::run(&_parserPool, parseResponse, job));
+    return;
+}
 #endif
 
-    QDropboxJson json;
-    json.parseString(response);
-    _tempJson.parseString(response);
+void QDropbox::responseParsed(const qdropbox_parsed_response &parsed)
+{
+    QDropboxJson json(parsed.json);
+
+    // the reply is finished by finishRequest(), only its results are set here
+    QDropboxReply *reply = replyMap.value(parsed.nr);
+    if(reply != NULL)
+        reply->_json = json;
+
     if(!json.isValid())
     {
         errorState = QDropbox::APIError;
-        errorText  = "Dropbox API did not send correct answer for account information.";
+        switch(parsed.type)
+        {
+        case QDROPBOX_REQ_ACCINFO:
+            errorText = "Dropbox API did not send correct answer for account information.";
+            break;
+        case QDROPBOX_REQ_SHRDLNK:
+            errorText = "Dropbox API did not send correct answer for file/directory shared link.";
+            break;
+        default:
+            errorText = "Dropbox API did not send correct answer for file/directory metadata.";
+            break;
+        }
 #ifdef QTDROPBOX_DEBUG
         qDebug() << "error: " << errorText << endl;
 #endif
+        if(reply != NULL)
+        {
+            reply->_error     = errorState;
+            reply->_errorText = errorText;
+        }
         emit errorOccured(errorState);
         return;
     }
 
-    emit accountInfoReceived(response);
+    switch(parsed.type)
+    {
+    case QDROPBOX_REQ_ACCINFO:
+        if(parsed.needText)
+            emit accountInfoReceived(parsed.text);
+        if(parsed.needObjects)
+            emit accountReceived(parsed.account);
+        break;
+    case QDROPBOX_REQ_METADAT:
+        if(parsed.needText)
+            emit metadataReceived(parsed.text);
+        if(parsed.needObjects)
+            emit fileInfoReceived(parsed.metadata);
+        break;
+    case QDROPBOX_REQ_SHRDLNK:
+        if(parsed.needText)
+            emit sharedLinkReceived(parsed.text);
+        break;
+    case QDROPBOX_REQ_REVISIO:
+        if(parsed.needText)
+            emit revisionsReceived(parsed.text);
+        if(parsed.needObjects)
+            emit revisionListReceived(parsed.revisions);
+        break;
+    default:
+        break;
+    }
+
+    if(reply == NULL)
+        return;
+
+    switch(parsed.type)
+    {
+    case QDROPBOX_REQ_ACCINFO:
+        reply->_account = parsed.account;
+        break;
+    case QDROPBOX_REQ_METADAT:
+        reply->_metadata = parsed.metadata;
+        break;
+    case QDROPBOX_REQ_SHRDLNK:
+        reply->_sharedLink = QUrl(json.getString("url"));
+        break;
+    case QDROPBOX_REQ_REVISIO:
+        reply->_revisions = parsed.revisions;
+        break;
+    default:
+        break;
+    }
     return;
 }
 
-void QDropbox::parseSharedLink(QString response)
+QDropboxReply *QDropbox::createReply(int nr)
 {
+    QDropboxReply *reply = new QDropboxReply(nr, this);
+    if(nr < 0)
+    {
+        // the request was not sent at all
+        reply->_error     = errorState;
+        reply->_errorText = errorText;
+        reply->finish();
+        return reply;
+    }
+
+    replyMap.insert(nr, reply);
+    return reply;
+}
+
+void QDropbox::finishReply(int nr)
+{
+    QPointer<QDropboxReply> reply = replyMap.take(nr);
+    if(reply.isNull())
+        return;
+
 #ifdef QTDROPBOX_DEBUG
-    qDebug() << "== shared link ==" << response << "== shared link end ==";
+    qDebug() << "reply to request " << nr << " finished after " << reply->_timer.elapsed() << "ms" << endl;
 #endif
+    reply->finish();
+    return;
+}
+
+void QDropbox::waitForRequest(int nr)
+{
+    // the loop of this wait only ends with this request, nested waits do not interfere
+    QDropboxReply *reply = createReply(nr);
+    reply->waitForFinished();
+    delete reply;
+    return;
+}
 
-    //QDropboxJson json;
-    //json.parseString(response);
-    _tempJson.parseString(response);
-    if(!_tempJson.isValid())
+QDropboxReply *QDropbox::startCall(int type, QString file, int max, int priority, int caller)
+{
+    // requests sent during the call are queued with the priority of the caller
+    _callPriority = priority;
+    _callCaller   = caller;
+
+    QDropboxReply *reply;
+    switch(type)
     {
-        errorState = QDropbox::APIError;
-        errorText  = "Dropbox API did not send correct answer for file/directory shared link.";
-#ifdef QTDROPBOX_DEBUG
-        qDebug() << "error: " << errorText << endl;
-#endif
-        emit errorOccured(errorState);
-        stopEventLoop();
-        return;
+    case QDROPBOX_REQ_RQTOKEN:
+        reply = createReply(requestToken(false));
+        break;
+    case QDROPBOX_REQ_ACCTOKN:
+        reply = createReply(requestAccessToken(false));
+        break;
+    case QDROPBOX_REQ_ACCINFO:
+        reply = accountInfo();
+        break;
+    case QDROPBOX_REQ_METADAT:
+        reply = metadata(file);
+        break;
+    case QDROPBOX_REQ_SHRDLNK:
+        reply = sharedLink(file);
+        break;
+    case QDROPBOX_REQ_REVISIO:
+        reply = revisions(file, max);
+        break;
+    default:
+        reply = createReply(-1);
+        break;
     }
-    emit sharedLinkReceived(response);
+
+    _callPriority = -1;
+    _callCaller   = 0;
+    return reply;
 }
 
-void QDropbox::parseMetadata(QString response)
+QDropboxReply *QDropbox::call(int type, QString file, int max, int priority, int caller)
 {
-#ifdef QTDROPBOX_DEBUG
-    qDebug() << "== metadata ==" << response << "== metadata end ==";
-#endif
+    QDropboxReply *reply = NULL;
 
-    QDropboxJson json;
-    json.parseString(response);
-    _tempJson.parseString(response);
-    if(!json.isValid())
+    // requests are always sent by the thread of QDropbox, so only that thread touches the
+    // bookkeeping of requests and replies
+    if(QThread::currentThread() == thread())
+        reply = startCall(type, file, max, priority, caller);
+    else
+        QMetaObject::invokeMethod(this, "startCall", Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(QDropboxReply*, reply),
+                                  Q_ARG(int, type), Q_ARG(QString, file), Q_ARG(int, max),
+                                  Q_ARG(int, priority), Q_ARG(int, caller));
+    return reply;
+}
+
+QDropboxReply *QDropbox::callAndWait(int type, QString file, int max, int priority, int caller)
+{
+    QDropboxReply *reply = call(type, file, max, priority, caller);
+    reply->waitForFinished();
+    return reply;
+}
+
+void QDropbox::failRequest(int nr, Error error, const QString &text)
+{
+    // errors of a redirection belong to the original request
+    const qdropbox_request request = _requests.value(nr);
+    if(request.type == QDROPBOX_REQ_REDIREC)
+    {
+        _requests.remove(nr);
+        nr = request.linked;
+    }
+    _requests.remove(nr);
+
+    QDropboxReply *reply = replyMap.value(nr);
+    if(reply == NULL)
+        return;
+
+    reply->_error     = error;
+    reply->_errorText = text;
+    finishReply(nr);
+    return;
+}
+
+void QDropbox::startMetadataStream(int reqnr)
+{
+    if(!_requests.contains(reqnr))
+        return;
+
+    // the whole response is only kept if someone needs it (see parseJob())
+    bool keepResponse = receivers(SIGNAL(metadataReceived(QString))) > 0 ||
+                        receivers(SIGNAL(fileInfoReceived(QDropboxFileInfo))) > 0;
+    attachMetadataStream(reqnr, new QDropboxMetadataStream(this, keepResponse));
+}
+
+void QDropbox::attachMetadataStream(int reqnr, QDropboxMetadataStream *stream)
+{
+    streamMap.insert(reqnr, stream);
+
+    // queued requests are connected by dispatchRequests()
+    QNetworkReply *rply = _requests.reply(reqnr);
+    if(rply != NULL)
+        connect(rply, SIGNAL(readyRead()), this, SLOT(networkReplyReadyRead()));
+}
+
+bool QDropbox::parseMetadataStream(int nr, QDropboxMetadataStream *stream, const QByteArray &response)
+{
+    // the rest of the response was not passed to the stream yet
+    stream->addData(response);
+    if(!stream->reader.finish())
     {
         errorState = QDropbox::APIError;
         errorText  = "Dropbox API did not send correct answer for file/directory metadata.";
@@ -715,12 +1289,14 @@ void QDropbox::parseMetadata(QString response)
         qDebug() << "error: " << errorText << endl;
 #endif
         emit errorOccured(errorState);
-        stopEventLoop();
-        return;
+        failRequest(nr, errorState, errorText);
+        return false;
     }
 
-    emit metadataReceived(response);
-    return;
+    // the whole response is parsed like any other, in background if that is enabled
+    if(stream->keepResponse)
+        return parseResponseOf(nr, QDROPBOX_REQ_METADAT, stream->response);
+    return false;
 }
 
 void QDropbox::setKey(QString key)
@@ -816,21 +1392,19 @@ int QDropbox::requestToken(bool blocking)
 #endif
 
     int reqnr = sendRequest(url);
+    _requests.setType(reqnr, QDROPBOX_REQ_RQTOKEN);
     if(blocking)
-    {
-        requestMap[reqnr].type = QDROPBOX_REQ_RQBTOKN;
-        startEventLoop();
-    }
-    else
-        requestMap[reqnr].type = QDROPBOX_REQ_RQTOKEN;
+        waitForRequest(reqnr);
 
     return reqnr;
 }
 
 bool QDropbox::requestTokenAndWait()
 {
-    requestToken(true);
-    return (error() == NoError);
+    QDropboxReply *reply = callAndWait(QDROPBOX_REQ_RQTOKEN);
+    bool ok = (reply->error() == NoError && error() == NoError);
+    reply->deleteLater();
+    return ok;
 }
 
 int QDropbox::authorize(QString email, QString pwd)
@@ -846,7 +1420,7 @@ int QDropbox::authorize(QString email, QString pwd)
     query.addQueryItem("oauth_token", oauthToken);
     dropbox_authorize.setQuery(query);
     int reqnr = sendRequest(dropbox_authorize, "GET", 0, "www.dropbox.com");
-    requestMap[reqnr].type = QDROPBOX_REQ_AULOGIN;
+    _requests.setType(reqnr, QDROPBOX_REQ_AULOGIN);
     mail     = email;
     password = pwd;
     return reqnr;
@@ -905,24 +1479,22 @@ int QDropbox::requestAccessToken(bool blocking)
     QUrl xQuery(url.toString(QUrl::RemoveQuery));
     int reqnr = sendRequest(xQuery, "POST", postData);
 
+    _requests.setType(reqnr, QDROPBOX_REQ_ACCTOKN);
     if(blocking)
-    {
-        requestMap[reqnr].type = QDROPBOX_REQ_BACCTOK;
-        startEventLoop();
-    }
-    else
-        requestMap[reqnr].type = QDROPBOX_REQ_ACCTOKN;
+        waitForRequest(reqnr);
 
     return reqnr;
 }
 
 bool QDropbox::requestAccessTokenAndWait()
 {
-    requestAccessToken(true);
+    QDropboxReply *reply = callAndWait(QDROPBOX_REQ_ACCTOKN);
+    bool ok = (reply->error() == NoError && error() == NoError);
+    reply->deleteLater();
 #ifdef QTDROPBOX_DEBUG
     qDebug() << "requestTokenAndWait() finished: error = " << error() << endl;
 #endif
-    return (error() == NoError);
+    return ok;
 }
 
 void QDropbox::requestAccountInfo(bool blocking)
@@ -949,30 +1521,18 @@ void QDropbox::requestAccountInfo(bool blocking)
     url.setQuery(urlQuery);
 
     int reqnr = sendRequest(url);
+    _requests.setType(reqnr, QDROPBOX_REQ_ACCINFO);
     if(blocking)
-    {
-        requestMap[reqnr].type = QDROPBOX_REQ_BACCINF;
-        startEventLoop();
-    }
-    else
-        requestMap[reqnr].type = QDROPBOX_REQ_ACCINFO;
+        waitForRequest(reqnr);
     return;
 }
 
 QDropboxAccount QDropbox::requestAccountInfoAndWait()
 {
-    requestAccountInfo(true);
-    QDropboxAccount a(_tempJson.strContent(), this);
-    _account = a;
-    return _account;
-}
-
-void QDropbox::parseBlockingAccountInfo(QString response)
-{
-    clearError();
-    parseAccountInfo(response);
-    stopEventLoop();
-    return;
+    QDropboxReply *reply = callAndWait(QDROPBOX_REQ_ACCINFO);
+    QDropboxAccount a = reply->account();
+    reply->deleteLater();
+    return a;
 }
 
 void QDropbox::requestMetadata(QString file, bool blocking)
@@ -999,21 +1559,20 @@ void QDropbox::requestMetadata(QString file, bool blocking)
     url.setPath(QString("/%1/metadata/%2").arg(_version.left(1), file));
 
     int reqnr = sendRequest(url);
+    _requests.setType(reqnr, QDROPBOX_REQ_METADAT);
     if(blocking)
-    {
-        requestMap[reqnr].type = QDROPBOX_REQ_BMETADA;
-        startEventLoop();
-    }
-    else
-        requestMap[reqnr].type = QDROPBOX_REQ_METADAT;
+        waitForRequest(reqnr);
+    else if(receivers(SIGNAL(metadataContentReceived(QDropboxFileInfo))) > 0)
+        startMetadataStream(reqnr);
     //QDropboxFileInfo fi(_tempJson.strContent(), this);
     return;
 }
 
 QDropboxFileInfo QDropbox::requestMetadataAndWait(QString file)
 {
-    requestMetadata(file, true);
-    QDropboxFileInfo fi(_tempJson.strContent(), this);
+    QDropboxReply *reply = callAndWait(QDROPBOX_REQ_METADAT, file);
+    QDropboxFileInfo fi = reply->metadata();
+    reply->deleteLater();
     return fi;
 }
 
@@ -1039,177 +1598,179 @@ void QDropbox::requestSharedLink(QString file, bool blocking)
     url.setQuery(urlQuery);
 
     int reqnr = sendRequest(url);
+    _requests.setType(reqnr, QDROPBOX_REQ_SHRDLNK);
     if(blocking)
-    {
-        requestMap[reqnr].type = QDROPBOX_REQ_BSHRDLN;
-        startEventLoop();
-    }
-    else
-        requestMap[reqnr].type = QDROPBOX_REQ_SHRDLNK;
+        waitForRequest(reqnr);
 
     return;
 }
 
 QUrl QDropbox::requestSharedLinkAndWait(QString file)
 {
-    requestSharedLink(file,true);
-    QDropboxJson json(_tempJson.strContent());
-    QString urlString = json.getString("url");
-    return QUrl(urlString);
+    QDropboxReply *reply = callAndWait(QDROPBOX_REQ_SHRDLNK, file);
+    QUrl link = reply->sharedLink();
+    reply->deleteLater();
+    return link;
 }
 
-void QDropbox::startEventLoop()
+void QDropbox::requestRevisions(QString file, int max, bool blocking)
 {
-#ifdef QTDROPBOX_DEBUG
-    qDebug() << "QDropbox::startEventLoop()" << endl;
-#endif
-    if(_evLoop == NULL)
-        _evLoop = new QEventLoop(this);
-    _evLoop->exec();
+	clearError();
+
+	QUrl url;
+    url.setUrl(apiurl.toString());
+
+    QUrlQuery urlQuery;
+    urlQuery.addQueryItem("oauth_consumer_key",_appKey);
+    urlQuery.addQueryItem("oauth_nonce", nonce);
+    urlQuery.addQueryItem("oauth_signature_method", signatureMethodString());
+    urlQuery.addQueryItem("oauth_timestamp", QString::number(timestamp));
+    urlQuery.addQueryItem("oauth_token", oauthToken);
+    urlQuery.addQueryItem("oauth_version", _version);
+    urlQuery.addQueryItem("rev_limit", QString::number(max));
+
+    QString signature = oAuthSign(url);
+    urlQuery.addQueryItem("oauth_signature", QUrl::toPercentEncoding(signature));
+
+    url.setPath(QString("/%1/revisions/%2").arg(_version.left(1), file));
+    url.setQuery(urlQuery);
+
+    int reqnr = sendRequest(url);
+    _requests.setType(reqnr, QDROPBOX_REQ_REVISIO);
+    if(blocking)
+        waitForRequest(reqnr);
+
     return;
 }
 
-void QDropbox::stopEventLoop()
+QList<QDropboxFileInfo> QDropbox::requestRevisionsAndWait(QString file, int max)
 {
-#ifdef QTDROPBOX_DEBUG
-    qDebug() << "QDropbox::stopEventLoop()" << endl;
-#endif
-    if(_evLoop == NULL)
-        return;
-#ifdef QTDROPBOX_DEBUG
-    qDebug() << "loop ended" << endl;
-#endif
-    _evLoop->exit();
-    return;
+	QDropboxReply *reply = callAndWait(QDROPBOX_REQ_REVISIO, file, max);
+	QList<QDropboxFileInfo> revisionList = reply->revisions();
+	reply->deleteLater();
+	return revisionList;
 }
 
-void QDropbox::responseBlockedTokenRequest(QString response)
+QDropboxReply *QDropbox::accountInfo()
 {
-    clearError();
-    responseTokenRequest(response);
-    stopEventLoop();
-    return;
+    const int previous = lastreply;
+    requestAccountInfo(false);
+    return createReply(lastreply != previous ? lastreply : -1);
 }
 
-void QDropbox::responseBlockingAccessToken(QString response)
+QDropboxReply *QDropbox::metadata(QString file)
 {
-    clearError();
-    responseAccessToken(response);
-    stopEventLoop();
-    return;
+    const int previous = lastreply;
+    requestMetadata(file, false);
+    QDropboxReply *reply = createReply(lastreply != previous ? lastreply : -1);
+
+    // a streamed response has to be kept for the metadata of the reply
+    QDropboxMetadataStream *stream = streamMap.value(reply->requestNumber(), NULL);
+    if(stream != NULL)
+        stream->keepResponse = true;
+    return reply;
 }
 
-void QDropbox::parseBlockingMetadata(QString response)
+QDropboxReply *QDropbox::revisions(QString file, int max)
 {
-    clearError();
-    parseMetadata(response);
-    stopEventLoop();
-    return;
+    const int previous = lastreply;
+    requestRevisions(file, max, false);
+    return createReply(lastreply != previous ? lastreply : -1);
 }
 
-void QDropbox::parseBlockingSharedLink(QString response)
+QDropboxReply *QDropbox::sharedLink(QString file)
 {
-    clearError();
-    parseSharedLink(response);
-    stopEventLoop();
-	return;
+    const int previous = lastreply;
+    requestSharedLink(file, false);
+    return createReply(lastreply != previous ? lastreply : -1);
 }
 
-// check if the event loop has to be stopped after a blocking request was sent
-void QDropbox::checkReleaseEventLoop(int reqnr)
+void QDropbox::startNetworkThread()
 {
-    switch(requestMap[reqnr].type)
-    {
-    case QDROPBOX_REQ_RQBTOKN:
-    case QDROPBOX_REQ_BACCTOK:
-    case QDROPBOX_REQ_BACCINF:
-    case QDROPBOX_REQ_BMETADA:
-	case QDROPBOX_REQ_BREVISI:
-        stopEventLoop(); // release local event loop
-        break;
-    default:
-        break;
-    }
+    if(_networkThread != NULL)
+        return;
+
+#ifdef QTDROPBOX_DEBUG
+    qDebug() << "moving QDropbox to a network thread" << endl;
+#endif
+    _networkThread = new QThread();
+    _networkThread->setObjectName("QDropbox network");
+    // the thread ends as soon as QDropbox was destroyed on it
+    connect(this, SIGNAL(destroyed()), _networkThread, SLOT(quit()), Qt::DirectConnection);
+    _networkThread->start();
+    moveToThread(_networkThread);
     return;
 }
 
-void QDropbox::requestRevisions(QString file, int max, bool blocking)
+void QDropbox::setParseInBackground(bool enabled)
 {
-	clearError();
+    _parseInBackground = enabled;
+}
 
-	QUrl url;
-    url.setUrl(apiurl.toString());
+bool QDropbox::parseInBackground()
+{
+    return _parseInBackground;
+}
 
-    QUrlQuery urlQuery;
-    urlQuery.addQueryItem("oauth_consumer_key",_appKey);
-    urlQuery.addQueryItem("oauth_nonce", nonce);
-    urlQuery.addQueryItem("oauth_signature_method", signatureMethodString());
-    urlQuery.addQueryItem("oauth_timestamp", QString::number(timestamp));
-    urlQuery.addQueryItem("oauth_token", oauthToken);
-    urlQuery.addQueryItem("oauth_version", _version);
-    urlQuery.addQueryItem("rev_limit", QString::number(max));
+qdropbox_request_statistics QDropbox::requestStatistics() const
+{
+    qdropbox_request_statistics statistics = _requests.statistics();
+    statistics.queued = _scheduler.queued();
+    return statistics;
+}
 
-    QString signature = oAuthSign(url);
-    urlQuery.addQueryItem("oauth_signature", QUrl::toPercentEncoding(signature));
+void QDropbox::setPriority(Priority priority)
+{
+    _priority = priority;
+}
 
-    url.setPath(QString("/%1/revisions/%2").arg(_version.left(1), file));
-    url.setQuery(urlQuery);
+QDropbox::Priority QDropbox::priority()
+{
+    return _priority;
+}
 
-    int reqnr = sendRequest(url);
-    if(blocking)
-    {
-        requestMap[reqnr].type = QDROPBOX_REQ_BREVISI;
-        startEventLoop();
-    }
-    else
-        requestMap[reqnr].type = QDROPBOX_REQ_REVISIO;
+void QDropbox::setMaxRequestsPerHost(QString host, int max)
+{
+    _scheduler.setMaxRunning(host, max);
 
-    return;
+    // a higher limit may let queued requests go
+    dispatchRequests();
 }
 
-QList<QDropboxFileInfo> QDropbox::requestRevisionsAndWait(QString file, int max)
+int QDropbox::maxRequestsPerHost(QString host)
 {
-	clearError();
-	requestRevisions(file, max, true);
-	QList<QDropboxFileInfo> revisionList;
+    return _scheduler.maxRunning(host);
+}
 
-	if(errorState != QDropbox::NoError || !_tempJson.isValid())
-		return revisionList;
+int QDropbox::queuedRequests(Priority priority)
+{
+    return _scheduler.queued(priority);
+}
 
-	QStringList responseList = _tempJson.getArray();
-	for(int i=0; i<responseList.size(); ++i)
-	{
-		QString revData = responseList.at(i);
-		QDropboxFileInfo revision(revData);
-		revisionList.append(revision);
-	}
+void QDropbox::setRateLimit(double requestsPerSecond)
+{
+    _limiter.setMaxRate(requestsPerSecond);
+    _limiter.setBurst(int(requestsPerSecond));
+}
 
-	return revisionList;
+double QDropbox::rateLimit()
+{
+    return _limiter.maxRate();
 }
 
-void QDropbox::parseRevisions(QString response)
+double QDropbox::currentRate()
 {
-    QDropboxJson json;
-    _tempJson.parseString(response);
-    if(!_tempJson.isValid())
-    {
-        errorState = QDropbox::APIError;
-        errorText  = "Dropbox API did not send correct answer for file/directory metadata.";
-        emit errorOccured(errorState);
-        stopEventLoop();
-        return;
-    }
+    return _limiter.rate();
+}
 
-    emit revisionsReceived(response);
-    return;
+void QDropbox::setMaxRetries(int retries)
+{
+    _maxRetries = qMax(0, retries);
 }
 
-void QDropbox::parseBlockingRevisions(QString response)
+int QDropbox::maxRetries()
 {
-	clearError();
-	parseRevisions(response);
-	stopEventLoop();
-	return;
+    return _maxRetries;
 }
 
 void QDropbox::clearError()
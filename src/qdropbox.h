@@ -12,6 +12,12 @@
 #include <QDomDocument>
 #include <QEventLoop>
 #include <QUrlQuery>
+#include <QThreadPool>
+#include <QThread>
+#include <QPointer>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QMultiMap>
 
 #ifdef QTDROPBOX_DEBUG
 #include <QDebug>
@@ -21,36 +27,30 @@
 #include "qdropboxjson.h"
 #include "qdropboxaccount.h"
 #include "qdropboxfileinfo.h"
+#include "qdropboxrequesttable.h"
+#include "qdropboxrequestscheduler.h"
+#include "qdropboxratelimiter.h"
 
-typedef int qdropbox_request_type;
-
-const qdropbox_request_type QDROPBOX_REQ_CONNECT = 0x01;
-const qdropbox_request_type QDROPBOX_REQ_RQTOKEN = 0x02;
-const qdropbox_request_type QDROPBOX_REQ_AULOGIN = 0x03;
-const qdropbox_request_type QDROPBOX_REQ_REDIREC = 0x04;
-const qdropbox_request_type QDROPBOX_REQ_ACCTOKN = 0x05;
-const qdropbox_request_type QDROPBOX_REQ_ACCINFO = 0x06;
-const qdropbox_request_type QDROPBOX_REQ_RQBTOKN = 0x07;
-const qdropbox_request_type QDROPBOX_REQ_BACCTOK = 0x08;
-const qdropbox_request_type QDROPBOX_REQ_METADAT = 0x09;
-const qdropbox_request_type QDROPBOX_REQ_BACCINF = 0x0A;
-const qdropbox_request_type QDROPBOX_REQ_BMETADA = 0x0B;
-const qdropbox_request_type QDROPBOX_REQ_SHRDLNK = 0x0C;
-const qdropbox_request_type QDROPBOX_REQ_BSHRDLN = 0x0D;
-const qdropbox_request_type QDROPBOX_REQ_REVISIO = 0x0E;
-const qdropbox_request_type QDROPBOX_REQ_BREVISI = 0x0F;
-
-//! Internally used struct to handle network requests sent from QDropbox
+class QDropboxMetadataStream;
+class QDropboxReply;
+
+//! Internally used struct to pass a response to the parser and the parsed objects back
 /*!
-  This structure is used internally by QDropbox. It is used to connect network
-  requests that are sent to the Dropbox API server with the asynchronous queries
-  made to the QtDropbox API.
+  The response is parsed into the objects that are needed for the signals of its request.
+  If QDropbox parses responses in background this happens on a thread of its parser pool,
+  the structure is passed by value and shares nothing with QDropbox.
  */
-struct qdropbox_request{
-    qdropbox_request_type type; //!< Type of the request
-    QString method;             //!< Used method to send the request (POST/GET)
-    QString host;               //!< Host that received the request
-    int linked;                 //!< ID of any linked request (for forwarded requests)
+struct qdropbox_parsed_response{
+    int                     nr;          //!< Number of the request
+    qdropbox_request_type   type;        //!< Type of the request
+    QByteArray              response;    //!< Body of the response
+    bool                    needText;    //!< The response is converted to a string for the signals
+    bool                    needObjects; //!< Metadata, account or revisions are created from the JSON
+    QString                 text;        //!< The response as string (if needed)
+    QDropboxJson            json;        //!< The parsed response
+    QDropboxFileInfo        metadata;    //!< Metadata including the contents of a directory
+    QDropboxAccount         account;     //!< Account information
+    QList<QDropboxFileInfo> revisions;   //!< Revisions of a file
 };
 
 //! The main entry point of QtDropbox API. Provides various connection facilities and general information.
@@ -129,7 +129,20 @@ public:
         WrongHttpMethod,                /*!< The REST API request used a wrong HTTP method. Dropbox API error 405 */
         MaxRequestsExceeded,            /*!< The maximum amount of requests was exceeded. Dropbox API error 503 */
         UserOverQuota,                  /*!< The user exceeded his or her storage quota. Dropbox API error 507 */
-        TokenExpired                    /*!< The access token has expired. Dropbox API error 401*/
+        TokenExpired,                   /*!< The access token has expired. Dropbox API error 401*/
+        FileNotFound                    /*!< The requested file does not exist. Dropbox API error 404. Only reported
+                                             by QDropboxReply, fileNotFound() is emitted instead. */
+    };
+
+    //! Priority of requests
+    /*!
+      Requests wait in a queue of their priority until a connection to their host is
+      free. Queued requests of a higher priority are always sent first.
+     */
+    enum Priority{
+        InteractivePriority,            /*!< Requests a user waits for. One connection per host is kept free for them. */
+        NormalPriority,                 /*!< Default priority of requests */
+        BackgroundPriority              /*!< Requests that are only sent while no other requests wait (e.g. synchronization) */
     };
 
     /*!
@@ -158,6 +171,11 @@ public:
                       OAuthMethod method = QDropbox::Plaintext,
                       QString url = "api.dropbox.com", QObject *parent = 0);
 
+    /*!
+      Cleans up pending requests on destruction.
+     */
+    ~QDropbox();
+
     /*!
       If an error occured you can access the last error code by using this function.
      */
@@ -247,7 +265,7 @@ public:
 
       \param t token string
      */
-    void setToken(QString t);
+    Q_INVOKABLE void setToken(QString t);
     /*!
       Returns the used token. This function may be used to get an authorized token
       after iniating a new connection (e.g. to save it for later use).
@@ -262,7 +280,7 @@ public:
 
       \param s token secret string
      */
-    void setTokenSecret(QString s);
+    Q_INVOKABLE void setTokenSecret(QString s);
     /*!
       Returns the currently used token secret. This function may be used to get an
       authorized token secret after iniating a new connection (e.g. to save it).
@@ -378,6 +396,11 @@ public:
       API server answeres the request the signal QDropbox::metadataReceived() will be
       emitted.
 
+      If the signal QDropbox::metadataContentReceived() is connected the contents of a
+      directory are parsed while the metadata is received and every entry is emitted
+      as soon as it is complete. The response is only kept in memory if
+      QDropbox::metadataReceived() is connected as well.
+
       \param file The absoulte path of the file (e.g. <i>/dropbox/test.txt</i>)
       \param blocking <i>internal only</i> indidicates if the call should block
     */
@@ -431,6 +454,164 @@ public:
 	 */
 	QList<QDropboxFileInfo> requestRevisionsAndWait(QString file, int max = 10);
 
+    /*!
+      Requests the account information of the connected user like requestAccountInfo()
+      and returns a reply that receives the result of this request only. The signals
+      of QDropbox are emitted as well.
+     */
+    QDropboxReply *accountInfo();
+
+    /*!
+      Requests the metadata of a file or directory like requestMetadata() and returns
+      a reply that receives the result of this request only.
+
+      \param file The absoulte path of the file (e.g. <i>/dropbox/test.txt</i>)
+     */
+    QDropboxReply *metadata(QString file);
+
+    /*!
+      Requests the latest revisions of a file like requestRevisions() and returns a
+      reply that receives the result of this request only.
+
+      \param file The absoulte path of the file (e.g. <i>/dropbox/test.txt</i>)
+      \param max Defines the maximum amount of revisions to be requested.
+     */
+    QDropboxReply *revisions(QString file, int max = 10);
+
+    /*!
+      Requests a shared link like requestSharedLink() and returns a reply that receives
+      the result of this request only.
+
+      \param file The absoulte path of the file (e.g. <i>/dropbox/test.txt</i>)
+     */
+    QDropboxReply *sharedLink(QString file);
+
+    /*!
+      Enables or disables parsing of responses in background. By default a response is
+      parsed by the thread QDropbox lives in, which blocks that thread for as long as a
+      large directory listing or list of revisions takes to parse. In background mode the
+      responses of non-blocking requests are parsed by a pool of parser threads and the
+      results are emitted by the thread of QDropbox as soon as they are ready, so the
+      thread that does the network I/O only receives and dispatches data. As large responses
+      take longer to parse the results may be emitted in another order than the responses
+      were received, QDropbox::operationFinished() is emitted after the results of a request.
+
+      Responses of blocking requests are parsed by the calling thread in either mode.
+      Metadata that is streamed to QDropbox::metadataContentReceived() is parsed while it
+      is received. If QtDropbox is built with QTDROPBOX_NO_CONCURRENT (without the
+      QtConcurrent module) responses are always parsed by the thread of QDropbox.
+
+      \param enabled <i>true</i> to parse responses in background
+     */
+    void setParseInBackground(bool enabled);
+
+    /*!
+      Moves QDropbox to a network thread of its own. Requests are sent and their responses
+      are handled by this thread, the signals of QDropbox and of its replies are emitted
+      there as well. Any other thread may then call the blocking functions (e.g.
+      requestMetadataAndWait()) at the same time: the request is passed to the network
+      thread and the calling thread sleeps until its reply is finished, without running
+      an event loop.
+
+      Without a network thread the blocking functions may still be called by several
+      threads, but the thread of QDropbox has to run an event loop. Called by the thread
+      of QDropbox they wait in a local event loop that only ends with their own request,
+      so blocking calls may be nested (e.g. in a slot).
+
+      Call this function from the thread that created QDropbox. QDropbox must not have a
+      parent. Afterwards QDropbox has to be destroyed on the network thread: call
+      deleteLater() instead of deleting it. The thread is stopped when QDropbox is
+      destroyed, the owner waits for it and deletes it:
+      \code
+      QThread *networkThread = dropbox->thread();
+      dropbox->deleteLater();
+      networkThread->wait();
+      delete networkThread;
+      \endcode
+     */
+    void startNetworkThread();
+
+    /*!
+      Returns the number of requests in flight and sent so far. Finished requests and
+      their network replies are disposed right away, so the memory used for requests only
+      depends on the number of requests in flight. Call this function from the thread of
+      QDropbox.
+     */
+    qdropbox_request_statistics requestStatistics() const;
+
+    /*!
+      Sets the priority of requests sent from now on. Requests of a QDropboxClient use the
+      priority of the client instead.
+     */
+    void setPriority(Priority priority);
+
+    /*!
+      Returns the priority of requests sent by QDropbox.
+     */
+    Priority priority();
+
+    /*!
+      Limits the number of requests sent to a host at the same time, further requests are
+      queued. The limit of every host is 6 by default, the number of connections
+      QNetworkAccessManager opens per host. Call this function from the thread of QDropbox.
+
+      \param host Host name, e.g. <em>api.dropbox.com</em>
+      \param max Maximum number of running requests
+     */
+    void setMaxRequestsPerHost(QString host, int max);
+
+    /*!
+      Returns the maximum number of running requests of a host.
+     */
+    int maxRequestsPerHost(QString host);
+
+    /*!
+      Returns the number of requests of a priority that wait for a free connection.
+      Call this function from the thread of QDropbox.
+     */
+    int queuedRequests(Priority priority);
+
+    /*!
+      Limits the rate of requests. All requests of QDropbox (and of the clients of a
+      QDropboxSession) share the limit. When the server answers that its request cap is
+      exceeded (error 503) the rate is halved and then slowly raised again, so it settles
+      just below the cap. The rate never exceeds the limit, by default 20 requests per
+      second. After a pause up to one second worth of requests is sent at once. Call this
+      function from the thread of QDropbox.
+
+      \param requestsPerSecond Highest number of requests sent per second
+     */
+    void setRateLimit(double requestsPerSecond);
+
+    /*!
+      Returns the highest number of requests sent per second.
+     */
+    double rateLimit();
+
+    /*!
+      Returns the number of requests per second that are sent right now. It is lower than
+      rateLimit() after the request cap of the server was exceeded.
+     */
+    double currentRate();
+
+    /*!
+      Sets how often a GET request is retried when the server is unavailable or its
+      request cap is exceeded (error 500, 502, 503 or 504). Retries wait for the time of a
+      Retry-After header or back off exponentially. Only when the retries are used up the
+      error is reported. The default is 4 retries, 0 disables them.
+     */
+    void setMaxRetries(int retries);
+
+    /*!
+      Returns how often a request is retried.
+     */
+    int maxRetries();
+
+    /*!
+      Returns <i>true</i> if responses are parsed in background.
+     */
+    bool parseInBackground();
+
 signals:
     /*!
       This signal is emitted whenever an error occurs. The error is passed
@@ -499,6 +680,15 @@ signals:
     */
     void metadataReceived(QString metadataJson);
 
+    /*!
+      Emitted for every entry of the contents of a directory while its metadata is still
+      being received. All entries are emitted before QDropbox::metadataReceived(). Only
+      relevant for non-blocking use of requestMetadata().
+
+      \param entry Metadata of a file or directory in the requested directory
+    */
+    void metadataContentReceived(const QDropboxFileInfo &entry);
+
     /*!
     Emmited when shared link was received. Only relevant for non-blocking use of sharedLink()
     \param sharedLinkJson string than contains the share link information.
@@ -511,11 +701,39 @@ signals:
 	*/
 	void revisionsReceived(QString revisionJson);
 
+    /*!
+      Emitted with the parsed account information after a non-blocking
+      requestAccountInfo() was answered.
+
+      \param account The account information
+     */
+    void accountReceived(const QDropboxAccount &account);
+
+    /*!
+      Emitted with the parsed metadata after a non-blocking requestMetadata() was
+      answered. The contents of a directory are already listed, so calling
+      QDropboxFileInfo::contents() on it does not parse anything.
+
+      \param metadata Metadata of the requested file or directory
+     */
+    void fileInfoReceived(const QDropboxFileInfo &metadata);
+
+    /*!
+      Emitted with the parsed revisions after a non-blocking requestRevisions() was
+      answered.
+
+      \param revisions Metadata of every revision of the file
+     */
+    void revisionListReceived(const QList<QDropboxFileInfo> &revisions);
+
 public slots:
 
 private slots:
     void requestFinished(int nr, QNetworkReply* rply);
     void networkReplyFinished(QNetworkReply* rply);
+    void networkReplyReadyRead();
+    void backgroundParseFinished();
+    void dispatchRequests();
 
 private:
     enum {
@@ -541,42 +759,62 @@ private:
     QString oauthToken;
     QString oauthTokenSecret;
 
-    QMap <QNetworkReply*,int>  replynrMap;
+    QDropboxRequestTable _requests;
     int  lastreply;
-    QMap<int,qdropbox_request> requestMap;
     QMap<int,int> delayMap;
+    QMap<int,QDropboxMetadataStream*> streamMap;
+
+    // queue of requests waiting for a connection
+    QDropboxRequestScheduler _scheduler;
+    Priority _priority;
+    int      _callPriority;
+    int      _callCaller;
+
+    // rate of requests and retries after errors of the server
+    QDropboxRateLimiter _limiter;
+    QElapsedTimer       _clock;
+    QTimer              _dispatchTimer;
+    int                 _maxRetries;
+    QMultiMap<qint64,qdropbox_pending_request> _retries;
+    QMap<int,QPointer<QDropboxReply> > replyMap;
+
+    // parsing of responses in background
+    bool        _parseInBackground;
+    QThreadPool _parserPool;
 
     QString mail;
     QString password;
 
     // for blocked functions
-    QEventLoop *_evLoop;
-    void startEventLoop();
-    void stopEventLoop();
-
-    // temporary memory
-    QDropboxJson _tempJson;
-
-    QDropboxAccount _account;
+    QThread *_networkThread;
 
     QString hmacsha1(QString key, QString baseString);
     void prepareApiUrl();
-    int  sendRequest(QUrl request, QString type = "GET", QByteArray postdata = 0, QString host = "");
+    int  sendRequest(QUrl request, QString type = "GET", QByteArray postdata = 0, QString host = "", int priority = -1);
+    bool retryRequest(int nr, QNetworkReply *rply);
     void responseTokenRequest(QString response);
-    void responseBlockedTokenRequest(QString response);
     int  responseDropboxLogin(QString response, int reqnr);
     void responseAccessToken(QString response);
-    void responseBlockingAccessToken(QString response);
     void parseToken(QString response);
-    void parseAccountInfo(QString response);
-    void parseSharedLink(QString response);
-    void checkReleaseEventLoop(int reqnr);
-    void parseMetadata(QString response);
-    void parseBlockingAccountInfo(QString response);
-    void parseBlockingMetadata(QString response);
-    void parseBlockingSharedLink(QString response);
-	void parseRevisions(QString response);
-	void parseBlockingRevisions(QString response);
+    void startMetadataStream(int reqnr);
+    void attachMetadataStream(int reqnr, QDropboxMetadataStream *stream);
+    bool parseMetadataStream(int nr, QDropboxMetadataStream *stream, const QByteArray &response);
+    qdropbox_parsed_response parseJob(int nr, qdropbox_request_type type, const QByteArray &response);
+    bool parseResponseOf(int nr, qdropbox_request_type type, const QByteArray &response);
+#ifndef QTDROPBOX_NO_CONCURRENT
+    void startBackgroundParse(int nr, qdropbox_request_type type, const QByteArray &response);
+#endif
+    void responseParsed(const qdropbox_parsed_response &parsed);
+    void finishRequest(int nr);
+    QDropboxReply *createReply(int nr);
+    void finishReply(int nr);
+    void failRequest(int nr, Error error, const QString &text);
+    void waitForRequest(int nr);
+    QDropboxReply *call(int type, QString file = QString(), int max = 0, int priority = -1, int caller = 0);
+    QDropboxReply *callAndWait(int type, QString file = QString(), int max = 0, int priority = -1, int caller = 0);
+    Q_INVOKABLE QDropboxReply *startCall(int type, QString file, int max, int priority, int caller);
+
+    friend class QDropboxClient;
 };
 
 #endif // QDROPBOX_H
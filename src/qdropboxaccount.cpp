@@ -1,16 +1,43 @@
 #include "qdropboxaccount.h"
 
-QDropboxAccount::QDropboxAccount(QObject *parent) :
-    QDropboxJson(parent)
+//! The decoded fields of a QDropboxAccount, shared by its copies
+class QDropboxAccountData : public QSharedData
 {
-    _quotaShared = 0;
-    _quota       = 0;
-    _quotaNormal = 0;
-    _uid         = 0;
+public:
+    QDropboxAccountData() :
+        uid(0),
+        quotaShared(0),
+        quota(0),
+        quotaNormal(0)
+    {
+    }
+
+    QUrl    referralLink;
+    QString displayName;
+    quint64 uid;
+    QString country;
+    QString email;
+    quint64 quotaShared;
+    quint64 quota;
+    quint64 quotaNormal;
+};
+
+QDropboxAccount::QDropboxAccount() :
+    QDropboxJson(),
+    _d(new QDropboxAccountData())
+{
+}
+
+QDropboxAccount::QDropboxAccount(QString jsonString) :
+    QDropboxJson(jsonString),
+    _d(new QDropboxAccountData())
+{
+	_init();
 }
 
-QDropboxAccount::QDropboxAccount(QString jsonString, QObject *parent) :
-    QDropboxJson(jsonString, parent)
+QDropboxAccount::QDropboxAccount(const QDropboxJson &json) :
+    QDropboxJson(json),
+    _d(new QDropboxAccountData())
 {
 	_init();
 }
@@ -21,6 +48,19 @@ QDropboxAccount::QDropboxAccount(const QDropboxAccount& other) :
     copyFrom(other);
 }
 
+#ifdef Q_COMPILER_RVALUE_REFS
+QDropboxAccount::QDropboxAccount(QDropboxAccount &&other) :
+    QDropboxJson(),
+    _d(new QDropboxAccountData())
+{
+    swap(other);
+}
+#endif
+
+QDropboxAccount::~QDropboxAccount()
+{
+}
+
 void QDropboxAccount::_init()
 {
     if(!isValid())
@@ -55,28 +95,29 @@ void QDropboxAccount::_init()
         return;
     }
 
-    _referralLink.setUrl(getString("referral_link"), QUrl::StrictMode);
-    _displayName = getString("display_name");
-    _uid         = getInt("uid");
-    _country     = getString("country");
-    _email       = getString("email");
+    QDropboxAccountData *d = _d.data();
+    d->referralLink.setUrl(getString("referral_link"), QUrl::StrictMode);
+    d->displayName = getString("display_name");
+    d->uid         = getInt("uid");
+    d->country     = getString("country");
+    d->email       = getString("email");
 
-    _quotaShared = quota->getUInt("shared", true);
-    _quota       = quota->getUInt("quota", true);
-    _quotaNormal = quota->getUInt("normal", true);
+    d->quotaShared = quota->getUInt("shared", true);
+    d->quota       = quota->getUInt("quota", true);
+    d->quotaNormal = quota->getUInt("normal", true);
 
     valid = true;
 
 #ifdef QTDROPBOX_DEBUG
     qDebug() << "== account data ==" << endl;
-    qDebug() << "reflink: " << _referralLink << endl;
-    qDebug() << "displayname: " << _displayName << endl;
-    qDebug() << "uid: " << _uid << endl;
-    qDebug() << "country: " << _country << endl;
-    qDebug() << "email: " << _email << endl;
-    qDebug() << "quotaShared: " << _quotaShared << endl;
-    qDebug() << "quotaNormal: " << _quotaNormal << endl;
-    qDebug() << "quotaUsed: " << _quota << endl;
+    qDebug() << "reflink: " << d->referralLink << endl;
+    qDebug() << "displayname: " << d->displayName << endl;
+    qDebug() << "uid: " << d->uid << endl;
+    qDebug() << "country: " << d->country << endl;
+    qDebug() << "email: " << d->email << endl;
+    qDebug() << "quotaShared: " << d->quotaShared << endl;
+    qDebug() << "quotaNormal: " << d->quotaNormal << endl;
+    qDebug() << "quotaUsed: " << d->quota << endl;
     qDebug() << "== account data end ==" << endl;
 #endif
     return;
@@ -84,63 +125,82 @@ void QDropboxAccount::_init()
 
 QUrl QDropboxAccount::referralLink()  const
 {
-    return _referralLink;
+    return _d->referralLink;
 }
 
 QString QDropboxAccount::displayName()  const
 {
-    return _displayName;
+    return _d->displayName;
 }
 
 qint64 QDropboxAccount::uid()  const
 {
-    return _uid;
+    return _d->uid;
 }
 
 QString QDropboxAccount::country()  const
 {
-    return _country;
+    return _d->country;
 }
 
 QString QDropboxAccount::email()  const
 {
-    return _email;
+    return _d->email;
 }
 
 quint64 QDropboxAccount::quotaShared()  const
 {
-    return _quotaShared;
+    return _d->quotaShared;
 }
 
 quint64 QDropboxAccount::quota()  const
 {
-    return _quota;
+    return _d->quota;
 }
 
 quint64 QDropboxAccount::quotaNormal()  const
 {
-    return _quotaNormal;
+    return _d->quotaNormal;
 }
 
-QDropboxAccount &QDropboxAccount::operator =(QDropboxAccount &a)
+QDropboxAccount &QDropboxAccount::operator =(const QDropboxAccount &a)
 {
     copyFrom(a);
     return *this;
 }
 
+#ifdef Q_COMPILER_RVALUE_REFS
+QDropboxAccount &QDropboxAccount::operator =(QDropboxAccount &&other)
+{
+    swap(other);
+    return *this;
+}
+#endif
+
+void QDropboxAccount::swap(QDropboxAccount &other)
+{
+    QDropboxJson::swap(other);
+    _d.swap(other._d);
+}
+
+void QDropboxAccount::releaseJson()
+{
+    // the decoded fields stay, only the document is dropped
+    const bool wasValid = isValid();
+    QDropboxJson::operator=(QDropboxJson());
+    valid = wasValid;
+}
+
 void QDropboxAccount::copyFrom(const QDropboxAccount &other)
 {
-    this->setParent(other.parent());
+    if(&other == this)
+        return;
+
+    // neither the JSON nor the decoded fields are copied, both are shared with the original
+    QDropboxJson::operator=(other);
 #ifdef QTDROPBOX_DEBUG
     qDebug() << "creating account from account" << endl;
     qDebug() << "taken reflink: " << other.referralLink().toString() << endl;
 #endif
-    _referralLink = other.referralLink();
-    _displayName  = other.displayName();
-    _uid          = other.uid();
-    _country      = other.country();
-    _email        = other.email();
-    _quotaShared  = other.quotaShared();
-    _quota    = other.quota();
-    _quotaNormal  = other.quotaNormal();
+    _d = other._d;
 }
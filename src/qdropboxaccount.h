@@ -1,10 +1,13 @@
 #ifndef QDROPBOXACCOUNT_H
 #define QDROPBOXACCOUNT_H
 
-#include <QObject>
 #include <QUrl>
+#include <QSharedDataPointer>
+#include <QMetaType>
 #include "qdropboxjson.h"
 
+class QDropboxAccountData;
+
 //! Stores information about a user account
 /*!
   This class is used to store user account information retrieved by using
@@ -18,27 +21,34 @@
 
   See https://www.dropbox.com/developers/reference/api#account-info for details.
 
+  Like QDropboxJson a QDropboxAccount is implicitly shared, copies are cheap. The
+  fields are decoded once and shared by all copies. An account that is kept for a
+  long time may drop the JSON by calling releaseJson().
  */
 class QTDROPBOXSHARED_EXPORT QDropboxAccount : public QDropboxJson
 {
-    Q_OBJECT
 public:
     /*!
       Creates an empty instance of the object. It is automatically invalid
       and does not contain useful data.
-
-      \param parent Parent QObject.
      */
-    QDropboxAccount(QObject *parent = 0);
+    QDropboxAccount();
 
     /*!
       This constructor creates an object based on the data contained in the
       given string that is in valid JSON format.
 
       \param jsonString JSON data in string representation
-      \param parent Parent QObject.
      */
-    QDropboxAccount(QString jsonString, QObject *parent = 0);
+    QDropboxAccount(QString jsonString);
+
+    /*!
+      Creates an object based on an already parsed JSON. The data is shared,
+      not parsed again.
+
+      \param json account info JSON
+     */
+    explicit QDropboxAccount(const QDropboxJson &json);
 
     /*!
       Use this constructor to create a copy of an other QDropboxAccount.
@@ -47,6 +57,18 @@ public:
      */
     QDropboxAccount(const QDropboxAccount& other);
 
+#ifdef Q_COMPILER_RVALUE_REFS
+    /*!
+      Moves another QDropboxAccount, other is left empty.
+     */
+    QDropboxAccount(QDropboxAccount &&other);
+#endif
+
+    /*!
+      Cleans up the account on destruction.
+     */
+    ~QDropboxAccount();
+
     /*!
       Returns the referal link of the user.
      */
@@ -91,7 +113,26 @@ public:
       Overloaded operator to copy a QDropboxAccount by using =. Internally
       copyFrom() is called.
      */
-    QDropboxAccount& operator =(QDropboxAccount&);
+    QDropboxAccount& operator =(const QDropboxAccount&);
+
+#ifdef Q_COMPILER_RVALUE_REFS
+    /*!
+      Moves another QDropboxAccount to this one, other is left empty.
+     */
+    QDropboxAccount& operator =(QDropboxAccount &&other);
+#endif
+
+    /*!
+      Swaps this QDropboxAccount with other.
+     */
+    void swap(QDropboxAccount &other);
+
+    /*!
+      Releases the JSON the account information was read from. The accessors of
+      QDropboxAccount keep working and the account stays valid, but the functions
+      of QDropboxJson behave like the JSON was empty afterwards.
+     */
+    void releaseJson();
 
     /*!
       This function is used to copy the data from an other QDropboxAccount.
@@ -99,16 +140,11 @@ public:
     void copyFrom(const QDropboxAccount& a);
 
 private:  
-    QUrl    _referralLink;
-    QString _displayName;
-    quint64 _uid;
-    QString _country;
-    QString _email;
-    quint64 _quotaShared;
-    quint64 _quota;
-    quint64 _quotaNormal;
+    QSharedDataPointer<QDropboxAccountData> _d;
 
 	void _init();
 };
 
+Q_DECLARE_METATYPE(QDropboxAccount)
+
 #endif // QDROPBOXACCOUNT_H
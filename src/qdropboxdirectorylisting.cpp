@@ -0,0 +1,333 @@
+#include "qdropboxdirectorylisting.h"
+
+#include <algorithm>
+
+//! Stored for entries without a timestamp
+static const qint64 noTimestamp = Q_INT64_C(-0x7FFFFFFFFFFFFFFF) - 1;
+
+//! Compares two strings case insensitive without creating QStrings of them
+static int compareFolded(const QChar *a, int lengthA, const QChar *b, int lengthB)
+{
+    const int length = qMin(lengthA, lengthB);
+    for(int i = 0; i < length; ++i)
+    {
+        const ushort ca = a[i].toCaseFolded().unicode();
+        const ushort cb = b[i].toCaseFolded().unicode();
+        if(ca != cb)
+            return ca < cb ? -1 : 1;
+    }
+    return lengthA - lengthB;
+}
+
+//! Orders the indices of entries by a numeric column
+template<typename T> class columnLess
+{
+public:
+    columnLess(const T *column, bool descending) : _column(column), _descending(descending) {}
+
+    bool operator()(int a, int b) const
+    {
+        return _descending ? _column[b] < _column[a] : _column[a] < _column[b];
+    }
+
+private:
+    const T *_column;
+    bool     _descending;
+};
+
+//! Orders the indices of entries by their paths
+class pathLess
+{
+public:
+    pathLess(const QChar *strings, const qdropbox_listing_string *path, bool descending) :
+        _strings(strings), _path(path), _descending(descending) {}
+
+    bool operator()(int a, int b) const
+    {
+        const qdropbox_listing_string &pa = _path[_descending ? b : a];
+        const qdropbox_listing_string &pb = _path[_descending ? a : b];
+        return compareFolded(_strings + pa.offset, pa.length, _strings + pb.offset, pb.length) < 0;
+    }
+
+private:
+    const QChar                   *_strings;
+    const qdropbox_listing_string *_path;
+    bool                           _descending;
+};
+
+template<typename T> static QVector<T> permuted(const QVector<T> &column, const QVector<int> &permutation)
+{
+    QVector<T> result(permutation.size());
+    for(int i = 0; i < permutation.size(); ++i)
+        result[i] = column.at(permutation.at(i));
+    return result;
+}
+
+static QBitArray permuted(const QBitArray &column, const QVector<int> &permutation)
+{
+    QBitArray result(permutation.size());
+    for(int i = 0; i < permutation.size(); ++i)
+        result.setBit(i, column.testBit(permutation.at(i)));
+    return result;
+}
+
+QString QDropboxDirectoryListing::Entry::size() const
+{
+    return _listing->_symbols.at(_listing->_size.at(_i));
+}
+
+quint64 QDropboxDirectoryListing::Entry::revision() const
+{
+    return _listing->_revision.at(_i);
+}
+
+bool QDropboxDirectoryListing::Entry::thumbExists() const
+{
+    return _listing->_thumbExists.testBit(_i);
+}
+
+quint64 QDropboxDirectoryListing::Entry::bytes() const
+{
+    return _listing->_bytes.at(_i);
+}
+
+QDateTime QDropboxDirectoryListing::Entry::modified() const
+{
+    const qint64 msecs = _listing->_modified.at(_i);
+    return msecs == noTimestamp ? QDateTime() : QDateTime::fromMSecsSinceEpoch(msecs, Qt::UTC);
+}
+
+QDateTime QDropboxDirectoryListing::Entry::clientModified() const
+{
+    const qint64 msecs = _listing->_clientModified.at(_i);
+    return msecs == noTimestamp ? QDateTime() : QDateTime::fromMSecsSinceEpoch(msecs, Qt::UTC);
+}
+
+QString QDropboxDirectoryListing::Entry::icon() const
+{
+    return _listing->_symbols.at(_listing->_icon.at(_i));
+}
+
+QString QDropboxDirectoryListing::Entry::root() const
+{
+    return _listing->_symbols.at(_listing->_root.at(_i));
+}
+
+QString QDropboxDirectoryListing::Entry::path() const
+{
+    return _listing->string(_listing->_path.at(_i));
+}
+
+bool QDropboxDirectoryListing::Entry::isDir() const
+{
+    return _listing->_isDir.testBit(_i);
+}
+
+QString QDropboxDirectoryListing::Entry::mimeType() const
+{
+    return _listing->_symbols.at(_listing->_mimeType.at(_i));
+}
+
+bool QDropboxDirectoryListing::Entry::isDeleted() const
+{
+    return _listing->_isDeleted.testBit(_i);
+}
+
+QString QDropboxDirectoryListing::Entry::revisionHash() const
+{
+    return _listing->string(_listing->_revisionHash.at(_i));
+}
+
+QDropboxDirectoryListing::QDropboxDirectoryListing()
+{
+}
+
+QDropboxDirectoryListing::QDropboxDirectoryListing(const QDropboxFileInfo &directory)
+{
+    if(!directory.isDir())
+        return;
+
+    // the entries are read from the JSON directly, no QDropboxFileInfo list is created
+    *this = QDropboxDirectoryListing(directory.getJsonArray("contents"));
+}
+
+QDropboxDirectoryListing::QDropboxDirectoryListing(const QDropboxJsonArray &contents)
+{
+    reserve(contents.size());
+    for(QDropboxJsonArray::const_iterator it = contents.begin(); it != contents.end(); ++it)
+        append(QDropboxFileInfo(*it));
+
+#ifdef QTDROPBOX_DEBUG
+    qDebug() << "listing: " << size() << " entries, " << _strings.size() << " characters, "
+             << _symbols.size() << " symbols" << endl;
+#endif
+}
+
+void QDropboxDirectoryListing::append(const QDropboxFileInfo &entry)
+{
+    // the copy shares the data, isValid() is not available through a const QDropboxFileInfo
+    QDropboxFileInfo info(entry);
+    if(!info.isValid())
+        return;
+
+    const QDateTime modified       = info.modified();
+    const QDateTime clientModified = info.clientModified();
+
+    const int i = size();
+    _path.append(addString(info.path()));
+    _revisionHash.append(addString(info.revisionHash()));
+    _size.append(addSymbol(info.size()));
+    _icon.append(addSymbol(info.icon()));
+    _mimeType.append(addSymbol(info.mimeType()));
+    _root.append(addSymbol(info.root()));
+    _bytes.append(info.bytes());
+    _revision.append(info.revision());
+    _modified.append(modified.isValid() ? modified.toMSecsSinceEpoch() : noTimestamp);
+    _clientModified.append(clientModified.isValid() ? clientModified.toMSecsSinceEpoch() : noTimestamp);
+
+    // the bit arrays grow like the vectors do, size() is taken from _path
+    if(_isDir.size() <= i)
+    {
+        const int capacity = qMax(64, 2*_isDir.size());
+        _isDir.resize(capacity);
+        _isDeleted.resize(capacity);
+        _thumbExists.resize(capacity);
+    }
+    _isDir.setBit(i, info.isDir());
+    _isDeleted.setBit(i, info.isDeleted());
+    _thumbExists.setBit(i, info.thumbExists());
+}
+
+void QDropboxDirectoryListing::reserve(int size)
+{
+    _path.reserve(size);
+    _revisionHash.reserve(size);
+    _size.reserve(size);
+    _icon.reserve(size);
+    _mimeType.reserve(size);
+    _root.reserve(size);
+    _bytes.reserve(size);
+    _revision.reserve(size);
+    _modified.reserve(size);
+    _clientModified.reserve(size);
+    if(_isDir.size() < size)
+    {
+        _isDir.resize(size);
+        _isDeleted.resize(size);
+        _thumbExists.resize(size);
+    }
+}
+
+int QDropboxDirectoryListing::size() const
+{
+    return _path.size();
+}
+
+bool QDropboxDirectoryListing::isEmpty() const
+{
+    return _path.isEmpty();
+}
+
+void QDropboxDirectoryListing::clear()
+{
+    *this = QDropboxDirectoryListing();
+}
+
+QDropboxDirectoryListing::Entry QDropboxDirectoryListing::at(int i) const
+{
+    return Entry(this, i);
+}
+
+QDropboxDirectoryListing::Entry QDropboxDirectoryListing::operator[](int i) const
+{
+    return Entry(this, i);
+}
+
+int QDropboxDirectoryListing::indexOf(const QString &path) const
+{
+    const QChar *strings = _strings.constData();
+    for(int i = 0; i < _path.size(); ++i)
+    {
+        const qdropbox_listing_string &p = _path.at(i);
+        if(p.length == path.size() && compareFolded(strings + p.offset, p.length, path.constData(), path.size()) == 0)
+            return i;
+    }
+    return -1;
+}
+
+void QDropboxDirectoryListing::sort(SortKey key, Qt::SortOrder order)
+{
+    const bool descending = (order == Qt::DescendingOrder);
+
+    // the indices are sorted by one column, then every column is rearranged once
+    QVector<int> permutation(size());
+    for(int i = 0; i < permutation.size(); ++i)
+        permutation[i] = i;
+
+    switch(key)
+    {
+    case SortByPath:
+        std::stable_sort(permutation.begin(), permutation.end(),
+                         pathLess(_strings.constData(), _path.constData(), descending));
+        break;
+    case SortByBytes:
+        std::stable_sort(permutation.begin(), permutation.end(), columnLess<quint64>(_bytes.constData(), descending));
+        break;
+    case SortByModified:
+        std::stable_sort(permutation.begin(), permutation.end(), columnLess<qint64>(_modified.constData(), descending));
+        break;
+    case SortByRevision:
+        std::stable_sort(permutation.begin(), permutation.end(), columnLess<quint64>(_revision.constData(), descending));
+        break;
+    }
+
+    _path           = permuted(_path, permutation);
+    _revisionHash   = permuted(_revisionHash, permutation);
+    _size           = permuted(_size, permutation);
+    _icon           = permuted(_icon, permutation);
+    _mimeType       = permuted(_mimeType, permutation);
+    _root           = permuted(_root, permutation);
+    _bytes          = permuted(_bytes, permutation);
+    _revision       = permuted(_revision, permutation);
+    _modified       = permuted(_modified, permutation);
+    _clientModified = permuted(_clientModified, permutation);
+    _isDir          = permuted(_isDir, permutation);
+    _isDeleted      = permuted(_isDeleted, permutation);
+    _thumbExists    = permuted(_thumbExists, permutation);
+}
+
+QDropboxDirectoryListing::const_iterator QDropboxDirectoryListing::begin() const
+{
+    return const_iterator(this, 0);
+}
+
+QDropboxDirectoryListing::const_iterator QDropboxDirectoryListing::end() const
+{
+    return const_iterator(this, size());
+}
+
+qdropbox_listing_string QDropboxDirectoryListing::addString(const QString &string)
+{
+    qdropbox_listing_string s;
+    s.offset = _strings.size();
+    s.length = string.size();
+    _strings.append(string);
+    return s;
+}
+
+qint32 QDropboxDirectoryListing::addSymbol(const QString &symbol)
+{
+    QHash<QString,qint32>::const_iterator it = _symbolIndex.constFind(symbol);
+    if(it != _symbolIndex.constEnd())
+        return it.value();
+
+    const qint32 index = _symbols.size();
+    _symbols.append(symbol);
+    _symbolIndex.insert(symbol, index);
+    return index;
+}
+
+QString QDropboxDirectoryListing::string(const qdropbox_listing_string &string) const
+{
+    return _strings.mid(string.offset, string.length);
+}
@@ -0,0 +1,237 @@
+#ifndef QDROPBOXDIRECTORYLISTING_H
+#define QDROPBOXDIRECTORYLISTING_H
+
+#include "qtdropbox_global.h"
+#include "qdropboxjsonarray.h"
+#include "qdropboxfileinfo.h"
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QBitArray>
+#include <QDateTime>
+
+#ifdef QTDROPBOX_DEBUG
+#include <QDebug>
+#endif
+
+//! A string stored in the string pool of a QDropboxDirectoryListing
+struct qdropbox_listing_string{
+    qint32 offset; //!< Offset of the first character in the pool
+    qint32 length; //!< Number of characters
+};
+
+//! The entries of a directory stored column by column
+/*!
+  A QList<QDropboxFileInfo> keeps the JSON of every entry and a copy of each of its fields.
+  QDropboxDirectoryListing stores only the fields, and stores them by column. The paths and
+  revision hashes of all entries share one string pool. Sizes, revisions and timestamps are
+  kept in flat arrays and the flags in bit arrays. Icons, mime types, roots and
+  human readable sizes repeat a lot, so each distinct value is stored once and the entries
+  refer to it by an index. A large directory takes a fraction of the memory of the
+  QDropboxFileInfo list, and scanning or sorting a single column touches only that column.
+
+  Entries are accessed by lightweight views (QDropboxDirectoryListing::Entry) that read the
+  columns, nothing is copied until a value is requested.
+
+  \code
+  QDropboxDirectoryListing listing(dropbox.requestMetadataAndWait("/dropbox/photos"));
+  listing.sort(QDropboxDirectoryListing::SortByModified, Qt::DescendingOrder);
+  for(QDropboxDirectoryListing::const_iterator it = listing.begin(); it != listing.end(); ++it)
+      qDebug() << (*it).path() << (*it).bytes();
+  \endcode
+
+  The listing is not connected to the JSON it was created from. Like the other containers
+  of Qt it is implicitly shared, copies are cheap.
+ */
+class QTDROPBOXSHARED_EXPORT QDropboxDirectoryListing
+{
+public:
+    //! Column a QDropboxDirectoryListing is sorted by
+    enum SortKey{
+        SortByPath,     //!< Path, compared case insensitive like Dropbox does
+        SortByBytes,    //!< Size in bytes
+        SortByModified, //!< Timestamp of last modification
+        SortByRevision  //!< Revision number
+    };
+
+    //! A view of a single entry of a QDropboxDirectoryListing
+    /*!
+      The functions match those of QDropboxFileInfo. An entry refers to its listing, do not
+      use it after the listing was modified or destroyed.
+     */
+    class QTDROPBOXSHARED_EXPORT Entry
+    {
+    public:
+        /*!
+          Creates an invalid entry.
+         */
+        Entry() : _listing(NULL), _i(0) {}
+
+        /*!
+          Returns true if the entry refers to a listing.
+         */
+        bool isValid() const { return _listing != NULL; }
+
+        /*!
+          Index of the entry in its listing.
+         */
+        int index() const { return _i; }
+
+        QString   size() const;           //!< See QDropboxFileInfo::size()
+        quint64   revision() const;       //!< See QDropboxFileInfo::revision()
+        bool      thumbExists() const;    //!< See QDropboxFileInfo::thumbExists()
+        quint64   bytes() const;          //!< See QDropboxFileInfo::bytes()
+        QDateTime modified() const;       //!< See QDropboxFileInfo::modified()
+        QDateTime clientModified() const; //!< See QDropboxFileInfo::clientModified()
+        QString   icon() const;           //!< See QDropboxFileInfo::icon()
+        QString   root() const;           //!< See QDropboxFileInfo::root()
+        QString   path() const;           //!< See QDropboxFileInfo::path()
+        bool      isDir() const;          //!< See QDropboxFileInfo::isDir()
+        QString   mimeType() const;       //!< See QDropboxFileInfo::mimeType()
+        bool      isDeleted() const;      //!< See QDropboxFileInfo::isDeleted()
+        QString   revisionHash() const;   //!< See QDropboxFileInfo::revisionHash()
+
+    private:
+        Entry(const QDropboxDirectoryListing *listing, int i) : _listing(listing), _i(i) {}
+
+        const QDropboxDirectoryListing *_listing;
+        int                             _i;
+
+        friend class QDropboxDirectoryListing;
+    };
+
+    //! Iterates the entries of a QDropboxDirectoryListing
+    class const_iterator
+    {
+    public:
+        const_iterator() : _listing(NULL), _i(0) {}
+
+        Entry operator*() const { return Entry(_listing, _i); }
+
+        const_iterator &operator++() { ++_i; return *this; }
+        const_iterator operator++(int) { const_iterator it = *this; ++_i; return it; }
+
+        bool operator==(const const_iterator &other) const { return _i == other._i; }
+        bool operator!=(const const_iterator &other) const { return _i != other._i; }
+
+    private:
+        const_iterator(const QDropboxDirectoryListing *listing, int i) : _listing(listing), _i(i) {}
+
+        const QDropboxDirectoryListing *_listing;
+        int                             _i;
+
+        friend class QDropboxDirectoryListing;
+    };
+
+    /*!
+      Creates an empty listing.
+     */
+    QDropboxDirectoryListing();
+
+    /*!
+      Creates the listing of the contents of a directory. The listing is empty if the
+      metadata does not belong to a directory.
+
+      \param directory Metadata of a directory
+     */
+    explicit QDropboxDirectoryListing(const QDropboxFileInfo &directory);
+
+    /*!
+      Creates a listing from the elements of a JSON array of metadata (e.g. the
+      <i>contents</i> of a directory). Elements that are not valid metadata are skipped.
+
+      \param contents Array of metadata
+     */
+    explicit QDropboxDirectoryListing(const QDropboxJsonArray &contents);
+
+    /*!
+      Appends an entry. This may be used to collect the entries emitted by
+      QDropbox::metadataContentReceived() without keeping their JSONs.
+
+      \param entry Metadata of a file or directory
+     */
+    void append(const QDropboxFileInfo &entry);
+
+    /*!
+      Reserves memory for size entries.
+     */
+    void reserve(int size);
+
+    /*!
+      Returns the number of entries.
+     */
+    int size() const;
+
+    /*!
+      Returns true if the listing has no entries.
+     */
+    bool isEmpty() const;
+
+    /*!
+      Removes all entries.
+     */
+    void clear();
+
+    /*!
+      Returns the entry at index i. i must be a valid index (0 <= i < size()).
+     */
+    Entry at(int i) const;
+
+    /*!
+      Same as at().
+     */
+    Entry operator[](int i) const;
+
+    /*!
+      Returns the index of the entry with the given path (compared case insensitive) or -1
+      if there is none.
+     */
+    int indexOf(const QString &path) const;
+
+    /*!
+      Sorts the entries by a column. The sort is stable, entries that are equal in the
+      column keep their order.
+
+      \param key Column to sort by
+      \param order Sort order
+     */
+    void sort(SortKey key, Qt::SortOrder order = Qt::AscendingOrder);
+
+    /*!
+      Returns an iterator pointing to the first entry.
+     */
+    const_iterator begin() const;
+
+    /*!
+      Returns an iterator pointing behind the last entry.
+     */
+    const_iterator end() const;
+
+private:
+    QString                            _strings;
+    QStringList                        _symbols;
+    QHash<QString,qint32>              _symbolIndex;
+    QVector<qdropbox_listing_string>   _path;
+    QVector<qdropbox_listing_string>   _revisionHash;
+    QVector<qint32>                    _size;
+    QVector<qint32>                    _icon;
+    QVector<qint32>                    _mimeType;
+    QVector<qint32>                    _root;
+    QVector<quint64>                   _bytes;
+    QVector<quint64>                   _revision;
+    QVector<qint64>                    _modified;
+    QVector<qint64>                    _clientModified;
+    QBitArray                          _isDir;
+    QBitArray                          _isDeleted;
+    QBitArray                          _thumbExists;
+
+    qdropbox_listing_string addString(const QString &string);
+    qint32  addSymbol(const QString &symbol);
+    QString string(const qdropbox_listing_string &string) const;
+
+    friend class Entry;
+};
+
+#endif // QDROPBOXDIRECTORYLISTING_H
@@ -32,6 +32,8 @@ QDropboxFile::~QDropboxFile()
         delete _buffer;
     if(_evLoop != NULL)
         delete _evLoop;
+    if(_metadata != NULL)
+        delete _metadata;
 }
 
 bool QDropboxFile::isSequential() const
@@ -241,6 +243,9 @@ void QDropboxFile::networkRequestFinished(QNetworkReply *rply)
 #endif
         break;
     }
+
+    // the response was read completely, the reply is not needed anymore
+    rply->deleteLater();
 }
 
 void QDropboxFile::obtainToken()
@@ -320,11 +325,10 @@ void QDropboxFile::rplyFileContent(QNetworkReply *rply)
     lastErrorCode = 0;
 
     QByteArray response = rply->readAll();
-    QString resp_str;
     QDropboxJson json;
 
 #ifdef QTDROPBOX_DEBUG
-    resp_str = QString(response.toHex());
+    QString resp_str = QString(response.toHex());
     qDebug() << "QDropboxFile::rplyFileContent response = " << resp_str << endl;
 
 #endif
@@ -338,8 +342,7 @@ void QDropboxFile::rplyFileContent(QNetworkReply *rply)
     case QDROPBOX_ERROR_WRONG_METHOD:
     case QDROPBOX_ERROR_REQUEST_CAP:
     case QDROPBOX_ERROR_USER_OVER_QUOTA:
-        resp_str = QString(response);
-        json.parseString(response.trimmed());
+        json.parseUtf8(response);
         lastErrorCode = rply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
 #ifdef QTDROPBOX_DEBUG
     qDebug() << "QDropboxFile::rplyFileContent jason.valid = " << json.isValid() << endl;
@@ -369,11 +372,10 @@ void QDropboxFile::rplyFileWrite(QNetworkReply *rply)
     lastErrorCode = 0;
 
     QByteArray response = rply->readAll();
-    QString resp_str;
     QDropboxJson json;
 
 #ifdef QTDROPBOX_DEBUG
-    resp_str = response;
+    QString resp_str = response;
     qDebug() << "QDropboxFile::rplyFileWrite response = " << resp_str << endl;
 
 #endif
@@ -387,8 +389,7 @@ void QDropboxFile::rplyFileWrite(QNetworkReply *rply)
     case QDROPBOX_ERROR_WRONG_METHOD:
     case QDROPBOX_ERROR_REQUEST_CAP:
     case QDROPBOX_ERROR_USER_OVER_QUOTA:
-        resp_str = QString(response);
-        json.parseString(response.trimmed());
+        json.parseUtf8(response);
         lastErrorCode = rply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
 #ifdef QTDROPBOX_DEBUG
     qDebug() << "QDropboxFile::rplyFileWrite jason.valid = " << json.isValid() << endl;
@@ -524,8 +525,9 @@ bool QDropboxFile::hasChanged()
 
 void QDropboxFile::obtainMetadata()
 {
-	// get metadata of this file
-	_metadata = new QDropboxFileInfo(_api->requestMetadataAndWait(_filename).strContent(), this);
+	// get metadata of this file, the metadata of a previous open() is replaced
+	delete _metadata;
+	_metadata = new QDropboxFileInfo(_api->requestMetadataAndWait(_filename));
 	if(!_metadata->isValid())
 		_metadata->clear();
 	return;
@@ -1,36 +1,125 @@
 #include "qdropboxfileinfo.h"
 
-QDropboxFileInfo::QDropboxFileInfo(QObject *parent) :
-    QDropboxJson(parent)
+#include <QThread>
+#ifndef QTDROPBOX_NO_CONCURRENT
+#include <QtConcurrentMap>
+#endif
+
+//! Directories with fewer entries are listed by the calling thread
+static const int parallelContentsThreshold = 2048;
+//! Minimum number of entries a worker thread lists at once
+static const int parallelContentsRange     = 512;
+
+//! Creates the entries of (a range of) a directory listing
+static QList<QDropboxFileInfo> contentsOf(const QDropboxJsonArray &array)
+{
+    QList<QDropboxFileInfo> list;
+    list.reserve(array.size());
+    for(QDropboxJsonArray::const_iterator it = array.begin(); it != array.end(); ++it)
+    {
+        QDropboxFileInfo info(*it);
+        if(!info.isValid())
+            continue;
+
+        list.append(info);
+    }
+    return list;
+}
+
+//! The decoded fields of a QDropboxFileInfo, shared by its copies
+class QDropboxFileInfoData : public QSharedData
+{
+public:
+    QDropboxFileInfoData() :
+        revision(0),
+        thumbExists(false),
+        bytes(0),
+        modified(QDateTime::currentDateTime()),
+        clientModified(modified),
+        isDir(false),
+        isDeleted(false)
+    {
+    }
+
+    QString   size;
+    quint64   revision;
+    bool      thumbExists;
+    quint64   bytes;
+    QDateTime modified;
+    QDateTime clientModified;
+    QString   icon;
+    QString   root;
+    QString   path;
+    bool      isDir;
+    QString   mimeType;
+    bool      isDeleted;
+    QString   revisionHash;
+};
+
+QDropboxFileInfo::QDropboxFileInfo() :
+    QDropboxJson()
 {
   _init();
 }
 
-QDropboxFileInfo::QDropboxFileInfo(QString jsonStr, QObject *parent) :
-    QDropboxJson(jsonStr, parent)
+QDropboxFileInfo::QDropboxFileInfo(QString jsonStr) :
+    QDropboxJson(jsonStr)
 {
     _init();
     dataFromJson();
 }
 
-QDropboxFileInfo::QDropboxFileInfo(const QDropboxFileInfo &other) :
-    QDropboxJson(0)
+QDropboxFileInfo::QDropboxFileInfo(const QDropboxJsonValue &value) :
+    QDropboxJson(value)
+{
+    _init();
+    dataFromJson();
+}
+
+QDropboxFileInfo::QDropboxFileInfo(const QDropboxJson &json) :
+    QDropboxJson(json)
 {
     _init();
+    dataFromJson();
+}
+
+QDropboxFileInfo::QDropboxFileInfo(const QDropboxFileInfo &other) :
+    QDropboxJson()
+{
+    _content.store(NULL);
     copyFrom(other);
 }
 
+#ifdef Q_COMPILER_RVALUE_REFS
+QDropboxFileInfo::QDropboxFileInfo(QDropboxFileInfo &&other) :
+    QDropboxJson()
+{
+    _init();
+    swap(other);
+}
+#endif
+
 QDropboxFileInfo::~QDropboxFileInfo()
 {
-  if(_content != NULL)
-    delete _content;
+  delete _content.load();
 }
 
 void QDropboxFileInfo::copyFrom(const QDropboxFileInfo &other)
 {
-	parseString(other.strContent());
-	dataFromJson();
-	setParent(other.parent());
+	if(&other == this)
+		return;
+
+	delete _content.load();
+	_content.store(NULL);
+
+	// neither the JSON nor the decoded fields are copied, both are shared with the original
+	QDropboxJson::operator=(other);
+	_d = other._d;
+
+	// a listing that was already created is shared as well
+	const QList<QDropboxFileInfo> *content = other._content.loadAcquire();
+	if(content != NULL)
+		_content.store(new QList<QDropboxFileInfo>(*content));
 	return;
 }
 
@@ -40,139 +129,188 @@ QDropboxFileInfo &QDropboxFileInfo::operator=(const QDropboxFileInfo &other)
     return *this;
 }
 
+#ifdef Q_COMPILER_RVALUE_REFS
+QDropboxFileInfo &QDropboxFileInfo::operator=(QDropboxFileInfo &&other)
+{
+    swap(other);
+    return *this;
+}
+#endif
+
+void QDropboxFileInfo::swap(QDropboxFileInfo &other)
+{
+    QDropboxJson::swap(other);
+    _d.swap(other._d);
+    QList<QDropboxFileInfo> *content = _content.load();
+    _content.store(other._content.load());
+    other._content.store(content);
+}
+
+void QDropboxFileInfo::releaseJson()
+{
+    delete _content.load();
+    _content.store(NULL);
+
+    // the decoded fields stay, only the document is dropped
+    const bool wasValid = isValid();
+    QDropboxJson::operator=(QDropboxJson());
+    valid = wasValid;
+}
+
 void QDropboxFileInfo::dataFromJson()
 {
 	if(!isValid())
 		return;
 
-	_size         = getString("size");
-	_revision     = getUInt("revision");
-	_thumbExists  = getBool("thumb_exists");
-	_bytes        = getUInt("bytes");
-	_icon         = getString("icon");
-	_root         = getString("root");
-	_path         = getString("path");
-	_isDir        = getBool("is_dir");
-	_mimeType     = getString("mime_type");
-	_isDeleted    = getBool("is_deleted");
-	_revisionHash = getString("rev");
-	_modified     = getTimestamp("modified");
-	_clientModified = getTimestamp("client_modified");
-	
-	// create content list
-	if(_isDir)
-	{
-#ifdef QTDROPBOX_DEBUG
-	  qDebug() << "fileinfo: generating contents list";
-#endif
-	  _content = new QList<QDropboxFileInfo>();
-	  QStringList contentsArray = getArray("contents");
-	  for(qint32 i = 0; i<contentsArray.size(); ++i)
-	  {
-	    QDropboxFileInfo contentInfo(contentsArray.at(i));
-		if(!contentInfo.isValid())
-		  continue;
-		
-		_content->append(contentInfo);
-	  }
-	}
+	QDropboxFileInfoData *d = _d.data();
+	d->size           = getString("size");
+	d->revision       = getUInt("revision");
+	d->thumbExists    = getBool("thumb_exists");
+	d->bytes          = getUInt("bytes");
+	d->icon           = getString("icon");
+	d->root           = getString("root");
+	d->path           = getString("path");
+	d->isDir          = getBool("is_dir");
+	d->mimeType       = getString("mime_type");
+	d->isDeleted      = getBool("is_deleted");
+	d->revisionHash   = getString("rev");
+	d->modified       = getTimestamp("modified");
+	d->clientModified = getTimestamp("client_modified");
 
+	// the content list is created by contents() when it is requested
 	return;
 }
 
 void QDropboxFileInfo::_init()
 {
-    _size           = "";
-    _revision       = 0;
-    _thumbExists    = false;
-    _bytes          = 0;
-    _modified       = QDateTime::currentDateTime();
-    _clientModified = QDateTime::currentDateTime();
-    _icon           = "";
-    _root           = "";
-	_path           = "";
-	_isDir          = false;
-	_mimeType       = "";
-	_isDeleted      = false;
-	_revisionHash   = "";
-	_content        = NULL;
+	_d       = new QDropboxFileInfoData();
+	_content.store(NULL);
     return;
 }
 
 QString QDropboxFileInfo::revisionHash()  const
 {
-	return _revisionHash;
+	return _d->revisionHash;
 }
 
 bool QDropboxFileInfo::isDeleted()  const
 {
-	return _isDeleted;
+	return _d->isDeleted;
 }
 
 
 QString QDropboxFileInfo::mimeType()  const
 {
-	return _mimeType;
+	return _d->mimeType;
 }
 
 bool QDropboxFileInfo::isDir()  const
 {
-	return _isDir;
+	return _d->isDir;
 }
 
 QString QDropboxFileInfo::path()  const
 {
-	return _path;
+	return _d->path;
 }
 
 QString QDropboxFileInfo::root()  const
 {
-	return _root;
+	return _d->root;
 }
 
 QString QDropboxFileInfo::icon()  const
 {
-	return _icon;
+	return _d->icon;
 }
 
-QDateTime QDropboxFileInfo::clientModified()
+QDateTime QDropboxFileInfo::clientModified() const
 {
-	return _clientModified;
+	return _d->clientModified;
 }
 
-QDateTime QDropboxFileInfo::modified()
+QDateTime QDropboxFileInfo::modified() const
 {
-	return _modified;
+	return _d->modified;
 }
 
 quint64 QDropboxFileInfo::bytes()  const
 {
-	return _bytes;
+	return _d->bytes;
 }
 
 bool QDropboxFileInfo::thumbExists()  const
 {
-	return _thumbExists;
+	return _d->thumbExists;
 }
 
 quint64 QDropboxFileInfo::revision() const
 {
-	return _revision;
+	return _d->revision;
 }
 
 QString QDropboxFileInfo::size() const
 {
-	return _size;
+	return _d->size;
 }
 
 QList<QDropboxFileInfo> QDropboxFileInfo::contents() const
 {
-   if(_content == NULL || !isDir())
+   if(!isDir())
    {
      QList<QDropboxFileInfo> l;
 	 l.clear();
      return l;
    }
-   
-   return *_content;
+
+   // the contents are only parsed on first access, threads that list them at the same
+   // time keep the list that was published first
+   QList<QDropboxFileInfo> *content = _content.loadAcquire();
+   if(content == NULL)
+   {
+#ifdef QTDROPBOX_DEBUG
+	  qDebug() << "fileinfo: generating contents list";
+#endif
+	  QList<QDropboxFileInfo> *listed = new QList<QDropboxFileInfo>();
+	  QDropboxJsonArray contentsArray = getJsonArray("contents");
+#ifdef QTDROPBOX_NO_CONCURRENT
+	  *listed = contentsOf(contentsArray);
+#else
+	  const int         count         = contentsArray.size();
+	  const int         threads       = QThread::idealThreadCount();
+	  if(count < parallelContentsThreshold || threads < 2)
+	  {
+	    *listed = contentsOf(contentsArray);
+	  }
+	  else
+	  {
+	    // every range is copied to a document of its own, the workers share nothing but the source
+	    const int rangeSize = qMax(parallelContentsRange, count/(threads*4) + 1);
+	    QList<QDropboxJsonArray> ranges;
+	    for(int pos = 0; pos < count; pos += rangeSize)
+	      ranges.append(contentsArray.mid(pos, rangeSize));
+
+	    const QList<QList<QDropboxFileInfo> > parts =
+	        QtConcurrent::blockingMapped<QList<QList<QDropboxFileInfo> > >(ranges, contentsOf);
+
+	    // the results are in the order of the ranges
+	    listed->reserve(count);
+	    QList<QList<QDropboxFileInfo> >::const_iterator it = parts.constBegin();
+	    for(; it != parts.constEnd(); ++it)
+	      listed->append(*it);
+	  }
+#endif
+
+	  if(_content.testAndSetOrdered(NULL, listed))
+	  {
+	    content = listed;
+	  }
+	  else
+	  {
+	    delete listed;
+	    content = _content.loadAcquire();
+	  }
+   }
+
+   return *content;
 }
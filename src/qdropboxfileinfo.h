@@ -1,16 +1,21 @@
 #ifndef QDROPBOXFILEINFO_H
 #define QDROPBOXFILEINFO_H
 
-#include <QObject>
 #include <QDateTime>
 #include <QString>
 #include <QList>
+#include <QSharedDataPointer>
+#include <QAtomicPointer>
+#include <QMetaType>
 
 #ifdef QTDROPBOX_DEBUG
 #include <QDebug>
 #endif
 
 #include "qdropboxjson.h"
+#include "qdropboxjsonarray.h"
+
+class QDropboxFileInfoData;
 
 //! Provides information and metadata about files and directories
 /*!
@@ -32,29 +37,45 @@
   query the metadata of a subdirectory again by using QDropbox::requestMetadata() or 
   QDropbox::requestMetadataAndWait().
 
-  \bug modified() and clientModified() are currently not working due to a bug in 
-  QDropboxJson
+  Like QDropboxJson a QDropboxFileInfo is implicitly shared, copies are cheap. The
+  fields are decoded once and shared by all copies. A QDropboxFileInfo read from a
+  directory listing keeps the document of the whole listing alive, metadata that is
+  kept for a long time (e.g. in a cache) should drop it by calling releaseJson().
  */
 class QTDROPBOXSHARED_EXPORT QDropboxFileInfo : public QDropboxJson
 {
-    Q_OBJECT
 public:
 
 	/*!
 	  Creates an empty instance of QDropboxFileInfo.
 	  \warning internal use only
-	  \param parent parent QObject
 	*/
-    QDropboxFileInfo(QObject *parent = 0);
+    QDropboxFileInfo();
 
 	/*!
 	  Creates an instance of QDropboxFileInfo based on the data provided
 	  in the JSON in string representation.
 
 	  \param jsonStr metadata JSON in string representation
-	  \param parent pointer to the parent QObject
 	*/
-    QDropboxFileInfo(QString jsonStr, QObject *parent = 0);
+    QDropboxFileInfo(QString jsonStr);
+
+	/*!
+	  Creates an instance of QDropboxFileInfo based on an element of a
+	  parsed JSON array (e.g. the contents of a directory). The metadata
+	  is read from the array without parsing it again.
+
+	  \param value metadata JSON as element of an array
+	*/
+    QDropboxFileInfo(const QDropboxJsonValue &value);
+
+	/*!
+	  Creates an instance of QDropboxFileInfo based on an already parsed
+	  metadata JSON. The data is shared, not parsed again.
+
+	  \param json metadata JSON
+	*/
+    explicit QDropboxFileInfo(const QDropboxJson &json);
 
 	/*!
 	   Creates a copy of an other QDropboxFileInfo instance.
@@ -63,6 +84,13 @@ public:
 	 */
     QDropboxFileInfo(const QDropboxFileInfo &other);
 
+#ifdef Q_COMPILER_RVALUE_REFS
+	/*!
+	  Moves another QDropboxFileInfo, other is left empty.
+	 */
+    QDropboxFileInfo(QDropboxFileInfo &&other);
+#endif
+
 	/*!
 	  Default destructor. Takes care of cleaning up when the object is destroyed.
 	*/
@@ -83,6 +111,25 @@ public:
 	*/
     QDropboxFileInfo& operator=(const QDropboxFileInfo& other);
 
+#ifdef Q_COMPILER_RVALUE_REFS
+	/*!
+	  Moves another QDropboxFileInfo to this one, other is left empty.
+	*/
+    QDropboxFileInfo& operator=(QDropboxFileInfo &&other);
+#endif
+
+	/*!
+	  Swaps this QDropboxFileInfo with other.
+	*/
+    void swap(QDropboxFileInfo &other);
+
+	/*!
+	  Releases the JSON the metadata was read from. The accessors of QDropboxFileInfo
+	  keep working and the metadata stays valid, but the functions of QDropboxJson and
+	  contents() behave like the JSON was empty afterwards.
+	*/
+    void releaseJson();
+
 	/*!
 	  Human readable file size.
 	*/
@@ -105,14 +152,13 @@ public:
 
 	/*!
 	  Timestamp of last modification.
-	  \bug Currently not working
 	 */
-    QDateTime modified();
+    QDateTime modified() const;
 
 	/*!
 	  Timestamp of desktop client upload.
 	 */
-    QDateTime clientModified();
+    QDateTime clientModified() const;
 
 	/*!
 	  Icon name.
@@ -152,32 +198,21 @@ public:
 	/*!
 	  Returns the content of a directory.
 	  This function will return a list with length 0 (zero) if the item is no
-	  directory.
+	  directory. The list is created when this function is called for the first time.
+	  The entries of large directories are created by the threads of QThreadPool (unless
+	  QtDropbox is built with QTDROPBOX_NO_CONCURRENT). Like the other const functions
+	  of a frozen QDropboxFileInfo it may be called by several threads at the same time.
 	*/
 	QList<QDropboxFileInfo> contents() const;
 
-signals:
-    
-public slots:
-
 private:
     void dataFromJson();
     void _init();
 
-    QString   _size;
-    quint64   _revision;
-    bool      _thumbExists;
-    quint64   _bytes;
-    QDateTime _modified;
-    QDateTime _clientModified;
-    QString   _icon;
-    QString   _root;
-	QString   _path;
-	bool      _isDir;
-	QString   _mimeType;
-	bool      _isDeleted;
-	QString   _revisionHash;
-	QList<QDropboxFileInfo>* _content;
+	QSharedDataPointer<QDropboxFileInfoData> _d;
+	mutable QAtomicPointer<QList<QDropboxFileInfo> > _content;
 };
 
+Q_DECLARE_METATYPE(QDropboxFileInfo)
+
 #endif // QDROPBOXFILEINFO_H
@@ -1,250 +1,101 @@
 #include "qdropboxjson.h"
+#include "qdropboxjsonarray.h"
 
-QDropboxJson::QDropboxJson(QObject *parent) :
-    QObject(parent)
+#include <QHash>
+#include <QBitArray>
+
+//! Document of empty QDropboxJson instances, it is shared and never modified
+struct qdropboxjson_shared_empty{
+    QExplicitlySharedDataPointer<QDropboxJsonDocument> doc;
+
+    qdropboxjson_shared_empty() :
+        doc(new QDropboxJsonDocument())
+    {
+    }
+};
+
+Q_GLOBAL_STATIC(qdropboxjson_shared_empty, sharedEmpty)
+
+static QExplicitlySharedDataPointer<QDropboxJsonDocument> emptyDocument()
+{
+    // static QDropboxJson instances may still be created while static data is destroyed
+    qdropboxjson_shared_empty *empty = sharedEmpty();
+    if(empty == NULL)
+        return QExplicitlySharedDataPointer<QDropboxJsonDocument>(new QDropboxJsonDocument());
+    return empty->doc;
+}
+
+QDropboxJson::QDropboxJson()
 {
     _init();
 }
 
-QDropboxJson::QDropboxJson(QString strJson, QObject *parent) :
-    QObject(parent)
+QDropboxJson::QDropboxJson(QString strJson)
 {
     _init();
     parseString(strJson);
 }
 
 QDropboxJson::QDropboxJson(const QDropboxJson &other) :
-    QObject(other.parent())
+    valid(other.valid),
+    _doc(other._doc),
+    _node(other._node),
+    _parent(NULL)
+{
+    // the document is shared until either JSON is modified, see detach()
+}
+
+#ifdef Q_COMPILER_RVALUE_REFS
+QDropboxJson::QDropboxJson(QDropboxJson &&other)
 {
     _init();
-    parseString(other.strContent());
+    swap(other);
+}
+#endif
+
+QDropboxJson::QDropboxJson(const QDropboxJsonValue &value)
+{
+    _init();
+    if(!value.isValid())
+        return;
+
+    const qdropboxjson_entry_type type = value._doc->node(value._node).type;
+    if(type != QDROPBOXJSON_TYPE_JSON && type != QDROPBOXJSON_TYPE_ARRAY)
+        return;
+
+    _doc  = value._doc;
+    _node = value._node;
+    valid = _doc->materialize(_node);
 }
 
 QDropboxJson::~QDropboxJson()
 {
-    emptyList();
+    qDeleteAll(_children);
 }
 
 void QDropboxJson::_init()
 {
-	valid          = false;
-	_anonymousArray = false;
+	valid   = false;
+	_doc    = emptyDocument();
+	_node   = 0;
+	_parent = NULL;
 }
 
 void QDropboxJson::parseString(QString strJson)
+{
+    parseUtf8(strJson.toUtf8());
+}
+
+void QDropboxJson::parseUtf8(const QByteArray &json)
 {
 #ifdef QTDROPBOX_DEBUG
-    qDebug() << "parse string = " << strJson << endl;
+    qDebug() << "parse json = " << json << endl;
 #endif
 
     // clear all existing data
     emptyList();
-
-    // basically a json is valid until it is invalidated
-    valid = true;
-
-    if(!strJson.startsWith("{") ||
-            !strJson.endsWith("}"))
-    {
-#ifdef QTDROPBOX_DEBUG
-    qDebug() << "string does not start with { " << endl;
-#endif
-
-		if(strJson.startsWith("[") && strJson.endsWith("]"))
-		{
-#ifdef QTDROPBOX_DEBUG
-			qDebug() << "JSON is anonymous array" << endl;
-#endif
-			_anonymousArray = true;
-			// fix json to be parseable by the algorithm below
-			strJson = "{\"_anonArray\":"+strJson+"}";
-		}
-		else
-		{
-			valid = false;
-			return;
-		}
-    }
-
-    QString buffer   = "";
-    QString key      = "";
-    QString value    = "";
-
-    bool isKey       = true;
-    bool insertValue = false;
-    bool isJson      = false;
-    bool isArray     = false;
-    bool openQuotes  = false;
-
-
-    for(int i=0; i<strJson.size(); ++i)
-    {
-        switch(strJson.at(i).toLatin1())
-        {
-        case '"':
-            if(!isKey)
-            {
-                buffer += "\"";
-                openQuotes = !openQuotes;
-            }
-            continue;
-            break;
-        case ' ':
-            if(!isKey)
-                buffer += " ";
-            continue;
-            break;
-        case '}':
-	    if(openQuotes)
-	      buffer += "}";
-            continue;
-            break;
-        case ':':
-            if(!isKey)
-            {
-                buffer += ":";
-                continue;
-            }
-#ifdef QTDROPBOX_DEBUG
-            qDebug() << "key = " << buffer << endl;
-#endif
-
-            key    = buffer.trimmed();
-            buffer = "";
-            isKey  = false;
-            break;
-        case ',':
-            if(openQuotes)
-			{
-				buffer += ',';
-                continue;
-			}
-#ifdef QTDROPBOX_DEBUG
-            qDebug() << "value = " << buffer << endl;
-#endif
-            value       = buffer.trimmed();
-            buffer      = "";
-            isKey       = true;
-            insertValue = true;
-            break;
-        case '{':
-            if(i == 0)
-                continue;
-	    if(!openQuotes)
-              isJson  = true;
-            buffer += '{';
-            break;
-        case '[':
-	    if(!openQuotes)
-              isArray = true;
-            buffer += '[';
-            break;
-        default:
-            buffer += strJson.at(i);
-            break;
-        }
-
-        if(isJson)
-        {
-            // create new json object with data until }
-            qdropboxjson_entry e;
-			int offset = parseSubJson(strJson, i, &e);
-            valueMap[key] = e;
-            key = "";
-
-            // ignore next ,
-            i = offset+1;
-            buffer      = "";
-            isJson      = false;
-            insertValue = false;
-            isKey       = true;
-            //continue;
-        }
-
-		 if(isArray)
-         {
-			 // value is an array value -> parse array
-			 bool inString    = false;
-			 bool arrayEnd    = false;
-			 int j = i+1;
-			 buffer = "[";
-			 for(;!arrayEnd && j<strJson.size();++j)
-			 {
-				 QChar arrC = strJson.at(j);
-				 switch(arrC.toLatin1())
-				 {
-				 case '"': 
-					 inString = !inString;
-					 buffer += arrC;
-					 break;
-				 case ']':
-					 buffer += "]";
-					 if(!inString)
-						 arrayEnd = true;
-					 break;
-				 case '\\':
-					 if(strJson.at(j+1) == '"') // escaped double quote
-					 {
-						 buffer += "\"";
-						 j++;
-					 }
-					 else
-						 buffer += "\\";
-					 break;
-				 default:
-					 buffer += arrC;
-					 break;
-				 }
-			 }
-			 
-			 // save array value string (buffer)
-			 value       = buffer;
-			 buffer      = "";
-			 i           = j;
-			 insertValue = true;
-			 isArray     = false;
-			 isKey       = true; // next element is started
-		 }
-
-        if(insertValue)
-        {
-#ifdef QTDROPBOX_DEBUG
-            qDebug() << "insert value " << key << " with content = " << value.trimmed() << " and type = " << interpretType(value.trimmed()) << endl;
-#endif
-            qdropboxjson_entry e;
-			QString *valuePointer = new QString(value.trimmed());
-			e.value.value = valuePointer;
-            e.type        = interpretType(value.trimmed());
-            valueMap[key] = e;
-
-            key   = "";
-            value = "";
-            insertValue = false;
-        }
-    }
-
-    // there's some key left
-    if(key.compare(""))
-    {
-#ifdef QTDROPBOX_DEBUG
-            qDebug() << "rest value = " << buffer << endl;
-#endif
-        // but no value in the buffer -> json is invalid because a value is missing
-        if(!buffer.compare(""))
-        {
-            valid = false;
-        }
-        else
-        {
-            // if there's a value left we store it
-            qdropboxjson_entry e;
-            e.value.value = new QString(buffer.trimmed());
-            e.type        = interpretType(buffer.trimmed());
-            valueMap[key] = e;
-        }
-
-    }
-
+    _doc  = new QDropboxJsonDocument();
+    valid = _doc->parse(json);
     return;
 }
 
@@ -261,483 +112,379 @@ bool QDropboxJson::isValid()
 
 bool QDropboxJson::hasKey(QString key)
 {
-    return valueMap.contains(key);
+    return find(key) != NULL;
 }
 
 QDropboxJson::DataType QDropboxJson::type(QString key)
 {
-    if(!valueMap.contains(key))
+    const qdropboxjson_node *n = find(key);
+    if(n == NULL)
         return UnknownType;
 
-    qdropboxjson_entry_type t;
-    t = valueMap.value(key).type;
-
-    switch(t)
-    {
-    case QDROPBOXJSON_TYPE_NUM:
-        return NumberType;
-    case QDROPBOXJSON_TYPE_STR:
-        return StringType;
-    case QDROPBOXJSON_TYPE_JSON:
-        return JsonType;
-    case QDROPBOXJSON_TYPE_ARRAY:
-        return ArrayType;
-    case QDROPBOXJSON_TYPE_FLOAT:
-        return FloatType;
-    case QDROPBOXJSON_TYPE_BOOL:
-        return BoolType;
-    case QDROPBOXJSON_TYPE_UINT:
-        return UnsignedIntType;
-    default:
-        return UnknownType;
-    }
-    return UnknownType;
+    return dataType(n->type);
 }
 
 qint64 QDropboxJson::getInt(QString key, bool force)
 {
-    if(!valueMap.contains(key))
+    int index;
+    if(find(key, &index) == NULL)
         return 0;
 
-    qdropboxjson_entry e;
-    e = valueMap.value(key);
-
-    if(!force && e.type != QDROPBOXJSON_TYPE_NUM)
-        return 0;
-
-    return e.value.value->toInt();
+    return _doc->toInt(index, force);
 }
 
 void QDropboxJson::setInt(QString key, qint64 value)
 {
-    if(valueMap.contains(key)){
-        valueMap[key].value.value->setNum(value);
-    }else{
-        qdropboxjson_entry e;
-        QString *valuePointer = new QString();
-        valuePointer->setNum(value);
-        e.value.value = valuePointer;
-        e.type        = QDROPBOXJSON_TYPE_NUM;
-        valueMap[key] = e;
-    }
+    qdropboxjson_node n;
+    n.type           = QDROPBOXJSON_TYPE_NUM;
+    n.flags          = 0;
+    n.value.intValue = value;
+    setValue(key, n);
 }
 
 quint64 QDropboxJson::getUInt(QString key, bool force)
 {
-    if(!valueMap.contains(key))
+    int index;
+    if(find(key, &index) == NULL)
         return 0;
 
-    qdropboxjson_entry e;
-    e = valueMap.value(key);
-
-    if(!force && e.type != QDROPBOXJSON_TYPE_UINT)
-        return 0;
-
-    return e.value.value->toUInt();
+    return _doc->toUInt(index, force);
 }
 
 void QDropboxJson::setUInt(QString key, quint64 value)
 {
-    if(valueMap.contains(key)){
-        valueMap[key].value.value->setNum(value);
-    }else{
-        qdropboxjson_entry e;
-        QString *valuePointer = new QString();
-        valuePointer->setNum(value);
-        e.value.value = valuePointer;
-        e.type        = QDROPBOXJSON_TYPE_UINT;
-        valueMap[key] = e;
-    }
+    qdropboxjson_node n;
+    n.type            = QDROPBOXJSON_TYPE_UINT;
+    n.flags           = 0;
+    n.value.uintValue = value;
+    setValue(key, n);
 }
 
 QString QDropboxJson::getString(QString key, bool force)
 {
-    if(!valueMap.contains(key))
-        return "";
-
-    qdropboxjson_entry e;
-    e = valueMap.value(key);
-
-    if(!force && e.type != QDROPBOXJSON_TYPE_STR)
+    int index;
+    if(find(key, &index) == NULL)
         return "";
 
-	QString value = e.value.value->mid(1, e.value.value->size()-2);
-    return value;
+    return _doc->toString(index, force);
 }
 
 void QDropboxJson::setString(QString key, QString value)
 {
-    if(valueMap.contains(key)){
-        *(valueMap[key].value.value) = value;
-    }else{
-        qdropboxjson_entry e;
-        QString *valuePointer = new QString(value);
-        e.value.value = valuePointer;
-        e.type        = QDROPBOXJSON_TYPE_STR;
-        valueMap[key] = e;
-    }
+    detach();
+    _doc->setString(_node, key.toUtf8(), value.toUtf8());
+    rebindChildren();
 }
 
 QDropboxJson* QDropboxJson::getJson(QString key)
 {
-    if(!valueMap.contains(key))
-        return NULL;
-
-    qdropboxjson_entry e;
-    e = valueMap.value(key);
-
-    if(e.type != QDROPBOXJSON_TYPE_JSON)
+    int index;
+    const qdropboxjson_node *n = find(key, &index);
+    if(n == NULL || n->type != QDROPBOXJSON_TYPE_JSON)
         return NULL;
 
+    // sub jsons are views of the same document and live as long as this QDropboxJson
+    QDropboxJson *json = _children.value(key, NULL);
+    if(json == NULL)
+    {
+        json          = new QDropboxJson();
+        json->_doc    = _doc;
+        json->_parent = this;
+        _children.insert(key, json);
+    }
+    json->_node = index;
+    json->valid = _doc->materialize(index);
 
-    return e.value.json;
+    return json;
 }
 
 void QDropboxJson::setJson(QString key, QDropboxJson value)
 {
-    if(valueMap.contains(key)){
-        *(valueMap[key].value.json) = value;
-    }else{
-        qdropboxjson_entry e;
-        QDropboxJson *valuePointer = new QDropboxJson(value);
-        e.value.json = valuePointer;
-        e.type        = QDROPBOXJSON_TYPE_JSON;
-        valueMap[key] = e;
-    }
+    detach();
+    _doc->setNode(_node, key.toUtf8(), *value._doc, value._node);
+    rebindChildren();
 }
 
 double QDropboxJson::getDouble(QString key, bool force)
 {
-    if(!valueMap.contains(key))
+    int index;
+    if(find(key, &index) == NULL)
         return 0.0f;
 
-    qdropboxjson_entry e;
-    e = valueMap.value(key);
-
-    if(!force && e.type != QDROPBOXJSON_TYPE_FLOAT)
-        return 0.0f;
-
-    return e.value.value->toDouble();
+    return _doc->toDouble(index, force);
 }
 
 void QDropboxJson::setDouble(QString key, double value)
 {
-    if(valueMap.contains(key)){
-        valueMap[key].value.value->setNum(value);
-    }else{
-        qdropboxjson_entry e;
-        QString *valuePointer = new QString();
-        valuePointer->setNum(value);
-        e.value.value = valuePointer;
-        e.type        = QDROPBOXJSON_TYPE_FLOAT;
-        valueMap[key] = e;
-    }
+    qdropboxjson_node n;
+    n.type              = QDROPBOXJSON_TYPE_FLOAT;
+    n.flags             = 0;
+    n.value.doubleValue = value;
+    setValue(key, n);
 }
 
 bool QDropboxJson::getBool(QString key, bool force)
 {
-    if(!valueMap.contains(key))
-        return false;
-
-    qdropboxjson_entry e;
-    e = valueMap.value(key);
-
-    if(!force && e.type != QDROPBOXJSON_TYPE_BOOL)
-        return false;
-
-    if(!e.value.value->compare("false"))
+    int index;
+    if(find(key, &index) == NULL)
         return false;
 
-    return true;
+    return _doc->toBool(index, force);
 }
 
 void QDropboxJson::setBool(QString key, bool value)
 {
-    if(valueMap.contains(key)){
-        *(valueMap[key].value.value) = value ? "true" : "false";
-    }else{
-        qdropboxjson_entry e;
-        QString *valuePointer = new QString(value ? "true" : "false");
-        e.value.value = valuePointer;
-        e.type        = QDROPBOXJSON_TYPE_BOOL;
-        valueMap[key] = e;
-    }
+    qdropboxjson_node n;
+    n.type            = QDROPBOXJSON_TYPE_BOOL;
+    n.flags           = 0;
+    n.value.boolValue = value;
+    setValue(key, n);
 }
 
 QDateTime QDropboxJson::getTimestamp(QString key, bool force)
 {
-	if(!valueMap.contains(key))
-		return QDateTime();
-
-	qdropboxjson_entry e;
-	e = valueMap.value(key);
+    // only strings can hold a timestamp, so force makes no difference
+    Q_UNUSED(force);
 
-	if(!force && e.type != QDROPBOXJSON_TYPE_STR)
+	int index;
+	if(find(key, &index) == NULL)
 		return QDateTime();
 
     // Dropbox date time format "Sat, 21 Aug 2010 22:31:20 +0000"
-    QString day   = e.value.value->mid(1, 3);
-    QString part1 = e.value.value->mid(6, 2);
-    QString month = e.value.value->mid(9, 3);
-    QString part2 = e.value.value->mid(13,13);
-	        month = translateMonth(month);
-            day   = translateDay(day);
-    QString dval = QString("%1 %2 %3 %4").arg(day).arg(part1).arg(month).arg(part2);
+    qint64 msecs;
+    if(!_doc->toTimestamp(index, &msecs))
+        return QDateTime();
 
-    return QDateTime::fromString(dval, "ddd dd MMM yyyy hh:mm:ss");
+    return QDateTime::fromMSecsSinceEpoch(msecs, Qt::UTC);
 }
 
 void QDropboxJson::setTimestamp(QString key, QDateTime value)
 {
-    QString valueToSave;
-    valueToSave += translateDay(value.date().dayOfWeek()) + " ";
-    valueToSave += QString::number(value.date().day()) + " ";
-    valueToSave += translateMonth(value.date().month()) + " ";
-    valueToSave += QString::number(value.date().year()) + " ";
-    valueToSave += value.toString("hh:mm:ss");
-
-    if(valueMap.contains(key)){
-        *(valueMap[key].value.value) = valueToSave;
-    }else{
-        qdropboxjson_entry e;
-        QString *valuePointer = new QString(valueToSave);
-        e.value.value = valuePointer;
-        e.type        = QDROPBOXJSON_TYPE_STR;
-        valueMap[key] = e;
-    }
+    char buffer[QDROPBOXJSON_TIMESTAMP_LENGTH];
+    int  length = 0;
+    if(value.isValid())
+        length = QDropboxJsonDocument::formatTimestamp(value.toMSecsSinceEpoch(), buffer);
+
+    detach();
+    _doc->setString(_node, key.toUtf8(), QByteArray::fromRawData(buffer, length));
+    rebindChildren();
 }
 
 QString QDropboxJson::strContent() const
 {
-	if(valueMap.size() == 0)
-		return "";
+    _doc->materialize(_node);
 
-    QString content = "{";
-	QList<QString> keys = valueMap.keys();
-	for(int i=0; i<keys.size(); ++i)
-	{
-		QString value = "";
-		qdropboxjson_entry e = valueMap.value(keys.at(i));
-
-		if(e.type != QDROPBOXJSON_TYPE_JSON)
-			value = *e.value.value;
-		else
-			value = e.value.json->strContent();
+    const qdropboxjson_node &n = _doc->node(_node);
+    if(n.type == QDROPBOXJSON_TYPE_JSON && n.value.children.count == 0)
+        return "";
 
-		content.append(QString("\"%1\": %2").arg(keys.at(i)).arg(value));
-		if(i != keys.size()-1)
-			content.append(", ");
-	}
-	content.append("}");
-	return content;
+    return QString::fromUtf8(_doc->text(_node));
 }
 
 void QDropboxJson::emptyList()
 {
-    QList<QString> keys = valueMap.keys();
-    for(qint32 i=0; i<keys.size(); ++i)
-    {
-        qdropboxjson_entry e = valueMap.value(keys.at(i));
-        if(e.type == QDROPBOXJSON_TYPE_JSON)
-            delete e.value.json;
-        else
-            delete e.value.value;
-		valueMap.remove(keys.at(i));
-    }
-    valueMap.empty();
+    qDeleteAll(_children);
+    _children.clear();
+    _doc  = emptyDocument();
+    _node = 0;
     return;
 }
 
-qdropboxjson_entry_type QDropboxJson::interpretType(QString value)
+QDropboxJson::DataType QDropboxJson::dataType(qdropboxjson_entry_type type)
 {
-    // check for string
-    if(value.startsWith("\"") && value.endsWith("\""))
-        return QDROPBOXJSON_TYPE_STR;
-
-    // check for integer
-    bool ok;
-    value.toInt(&ok);
-    if(ok)
-        return QDROPBOXJSON_TYPE_NUM;
-
-    // check for uint
-    value.toUInt(&ok);
-    if(ok)
-        return QDROPBOXJSON_TYPE_UINT;
-
-    // check for bool
-    if(!value.compare("true") || !value.compare("false"))
-        return QDROPBOXJSON_TYPE_BOOL;
-
-    // check for array
-    if(value.startsWith("[") && value.endsWith("]"))
-        return QDROPBOXJSON_TYPE_ARRAY;
+    switch(type)
+    {
+    case QDROPBOXJSON_TYPE_NUM:
+        return NumberType;
+    case QDROPBOXJSON_TYPE_STR:
+        return StringType;
+    case QDROPBOXJSON_TYPE_JSON:
+        return JsonType;
+    case QDROPBOXJSON_TYPE_ARRAY:
+        return ArrayType;
+    case QDROPBOXJSON_TYPE_FLOAT:
+        return FloatType;
+    case QDROPBOXJSON_TYPE_BOOL:
+        return BoolType;
+    case QDROPBOXJSON_TYPE_UINT:
+        return UnsignedIntType;
+    default:
+        return UnknownType;
+    }
+    return UnknownType;
+}
 
-    value.toDouble(&ok);
-    if(ok)
-        return QDROPBOXJSON_TYPE_FLOAT;
+QDropboxJson& QDropboxJson::operator=(const QDropboxJson& other)
+{
+	if(this == &other)
+		return *this;
 
-    return QDROPBOXJSON_TYPE_UNKNOWN;
+	qDeleteAll(_children);
+	_children.clear();
+	_doc  = other._doc;
+	_node = other._node;
+	valid = other.valid;
+	return *this;
 }
 
-QString QDropboxJson::translateMonth(QString month)
+#ifdef Q_COMPILER_RVALUE_REFS
+QDropboxJson& QDropboxJson::operator=(QDropboxJson &&other)
 {
-	QStringList months;
-	months << "Jan" << "Feb" << "Mar" << "Apr" << "May" << "Jun"
-		   << "Jul" << "Aug" << "Sep" << "Oct" << "Nov" << "Dec";
+    swap(other);
+    return *this;
+}
+#endif
 
-	for(int i=1; i<=12; ++i)
-	{
-		if(months.at(i-1).compare(month) == 0)
-			return QDate::shortMonthName(i);
-	}
+void QDropboxJson::swap(QDropboxJson &other)
+{
+    // sub JSONs stay with their data, only the parents themselves keep their place
+    _doc.swap(other._doc);
+    qSwap(_node, other._node);
+    qSwap(valid, other.valid);
+    _children.swap(other._children);
 
-    return "<unknown>";
+    QMap<QString, QDropboxJson*>::const_iterator it = _children.constBegin();
+    for(; it != _children.constEnd(); ++it)
+        it.value()->_parent = this;
+    for(it = other._children.constBegin(); it != other._children.constEnd(); ++it)
+        it.value()->_parent = &other;
 }
 
-QString QDropboxJson::translateMonth(int month)
+QStringList QDropboxJson::getArray(QString key, bool force) const
 {
-    QStringList months;
-    months << "Jan" << "Feb" << "Mar" << "Apr" << "May" << "Jun"
-           << "Jul" << "Aug" << "Sep" << "Oct" << "Nov" << "Dec";
+	QStringList list;
+	int index;
+	const qdropboxjson_node *n = find(key, &index);
+	if(n == NULL)
+        return list;
 
-    if(month > 0 && (month-1) < months.size()){
-        return months.at(month-1);
+    if(n->type != QDROPBOXJSON_TYPE_ARRAY)
+    {
+        // a forced conversion of a single value results in a single item
+        if(force)
+            list.append(n->type == QDROPBOXJSON_TYPE_STR ? _doc->string(index) : QString::fromUtf8(_doc->text(index)));
+        return list;
     }
 
-    return "<unknown>";
+    return arrayItems(index);
 }
 
-QString QDropboxJson::translateDay(QString day)
+QDropboxJsonArray QDropboxJson::getJsonArray(QString key) const
 {
-	QStringList days;
-	days << "Mon" << "Tue" << "Wed" << "Thu" << "Fri" << "Sat" << "Sun";
-
-	for(int i=1; i<=7; ++i)
-	{
-		if(days.at(i-1).compare(day) == 0)
-			return QDate::shortDayName(i);
-	}
+	int index;
+	const qdropboxjson_node *n = find(key, &index);
+	if(n == NULL || n->type != QDROPBOXJSON_TYPE_ARRAY)
+		return QDropboxJsonArray();
 
-    return "<unknown>";
+	return QDropboxJsonArray(_doc, index);
 }
 
-QString QDropboxJson::translateDay(int day)
+QDropboxJsonArray QDropboxJson::getJsonArray() const
 {
-    QStringList days;
-    days << "Mon" << "Tue" << "Wed" << "Thu" << "Fri" << "Sat" << "Sun";
+	if(_doc->node(_node).type != QDROPBOXJSON_TYPE_ARRAY)
+		return QDropboxJsonArray();
 
-    if(day > 0 && (day-1) < days.size()){
-        return days.at(day-1);
-    }
+	return QDropboxJsonArray(_doc, _node);
+}
+
+const qdropboxjson_node *QDropboxJson::find(QString key, int *index) const
+{
+    int i = _doc->findChild(_node, key);
+    if(index != NULL)
+        *index = i;
+    if(i < 0)
+        return NULL;
 
-    return "<unknown>";
+    return &_doc->node(i);
 }
 
-QDropboxJson& QDropboxJson::operator=(QDropboxJson& other)
+void QDropboxJson::setValue(QString key, const qdropboxjson_node &value)
 {
-	/*!< \todo use toString() */
-	parseString(other.strContent());
-	return *this;
+    detach();
+    _doc->setValue(_node, key.toUtf8(), value);
+    rebindChildren();
 }
 
-QStringList QDropboxJson::getArray(QString key, bool force)
+void QDropboxJson::detach()
 {
-	QStringList list;
-	if(!valueMap.contains(key))
-        return list;
+    // sub JSONs are views of the document of their parent, changes are made for all of them
+    QDropboxJson *root = this;
+    while(root->_parent != NULL && root->_parent->_doc == _doc)
+        root = root->_parent;
 
-    qdropboxjson_entry e;
-    e = valueMap.value(key);
+    // the document is only copied if anything else (a copy, an array, ...) refers to it
+    if(_doc->ref.load() <= root->views(_doc.data()))
+        return;
 
-    if(!force && e.type != QDROPBOXJSON_TYPE_ARRAY)
-        return list;
+#ifdef QTDROPBOX_DEBUG
+    qDebug() << "json: detaching shared document" << endl;
+#endif
 
-	QString arrayStr = e.value.value->mid(1, e.value.value->length()-2);
-	QString buffer = "";
-	bool inString = false;
-	int  inJson   = 0;
-	for(int i=0; i<arrayStr.size(); ++i)
-	{
-		QChar c = arrayStr.at(i);
-		if( ((c != ',' && c != ' ') || inString || inJson) &&
-			(c != '"' || inJson > 0))
-			buffer += c;
-		switch(c.toLatin1())
-		{
-		case '"':
-			if(i > 0 && arrayStr.at(i-1).toLatin1() == '\\')
-			{
-				buffer += c;
-				break;
-			}
-			else
-				inString = !inString;
-			break;
-		case '{':
-			inJson++;
-			break;
-		case '}':
-			inJson--;
-			break;
-		case ',':
-			if(inJson == 0 && !inString)
-			{
-				list.append(buffer);
-				buffer = "";
-			}
-			break;
-		}
-	}
-
-	if(!buffer.isEmpty())
-		list.append(buffer);
+    QExplicitlySharedDataPointer<QDropboxJsonDocument> copy(new QDropboxJsonDocument(*_doc));
+    root->rebind(_doc.data(), copy);
+}
 
-    return list;
+int QDropboxJson::views(const QDropboxJsonDocument *doc) const
+{
+    if(_doc.data() != doc)
+        return 0;
+
+    int count = 1;
+    QMap<QString, QDropboxJson*>::const_iterator it = _children.constBegin();
+    for(; it != _children.constEnd(); ++it)
+        count += it.value()->views(doc);
+    return count;
 }
 
-int QDropboxJson::parseSubJson(QString strJson, int start, qdropboxjson_entry *jsonEntry)
+void QDropboxJson::rebind(const QDropboxJsonDocument *doc, const QExplicitlySharedDataPointer<QDropboxJsonDocument> &copy)
 {
-	int openBrackets = 1;
-	QString buffer = "";
-    QDropboxJson* jsonValue = NULL;
+    if(_doc.data() != doc)
+        return;
 
-	int j;
-	for(j=start+1; openBrackets > 0 && j < strJson.size(); ++j)
-	{
-		if(strJson.at(j).toLatin1() == '{')
-			openBrackets++;
-		else if(strJson.at(j).toLatin1() == '}')
-			openBrackets--;
-	}
+    // the copy keeps all node indices
+    _doc = copy;
+    QMap<QString, QDropboxJson*>::const_iterator it = _children.constBegin();
+    for(; it != _children.constEnd(); ++it)
+        it.value()->rebind(doc, copy);
+}
 
-	buffer = strJson.mid(start, j-start);
-#ifdef QTDROPBOX_DEBUG
-	qDebug() << "brackets = " << openBrackets << endl;
-	qDebug() << "json data(" << start << ":" << j-start << ") = " << buffer << endl;
-#endif
-	jsonValue = new QDropboxJson();
-	jsonValue->parseString(buffer);
+void QDropboxJson::rebindChildren()
+{
+    // setters may move the nodes of an object, already returned sub jsons have to follow
+    QMap<QString, QDropboxJson*>::const_iterator it = _children.constBegin();
+    for(; it != _children.constEnd(); ++it)
+    {
+        int index = _doc->findChild(_node, it.key());
+        if(index >= 0 && _doc->node(index).type == QDROPBOXJSON_TYPE_JSON)
+            it.value()->_node = index;
+    }
+}
 
-	// invalid sub json means invalid json
-	if(!jsonValue->isValid())
-	{
-#ifdef QTDROPBOX_DEBUG
-		qDebug() << "subjson invalid!" << endl;
-#endif
-		valid = false;
-		return j;
-	}
+QStringList QDropboxJson::arrayItems(int index) const
+{
+    _doc->materialize(index);
+
+    // writing nested objects as JSON may materialize them and move the array node
+    const int first = _doc->node(index).value.children.first;
+    const int count = _doc->node(index).value.children.count;
+
+    // strings are returned without quotes, everything else as JSON
+    QStringList list;
+    list.reserve(count);
+    for(int i=first; i<first+count; ++i)
+    {
+        if(_doc->node(i).type == QDROPBOXJSON_TYPE_STR)
+            list.append(_doc->string(i));
+        else
+            list.append(QString::fromUtf8(_doc->text(i)));
+    }
 
-	// insert new
-	jsonEntry->value.json = jsonValue;
-	jsonEntry->type       = QDROPBOXJSON_TYPE_JSON;
-	return j;
+    return list;
 }
 
 bool QDropboxJson::isAnonymousArray()
 {
-	return _anonymousArray;
+	return _doc->node(_node).type == QDROPBOXJSON_TYPE_ARRAY;
 }
 
 QStringList QDropboxJson::getArray()
@@ -745,40 +492,136 @@ QStringList QDropboxJson::getArray()
 	if(!isAnonymousArray())
 		return QStringList();
 
-	return getArray("_anonArray");
+	return arrayItems(_node);
 }
 
 int QDropboxJson::compare(const QDropboxJson& other)
 {
-	if(valueMap.size() != other.valueMap.size())
-		return 1;
-
-	QMap<QString, qdropboxjson_entry> yourMap = other.valueMap;
-
-	QList<QString> keys = valueMap.keys();
-	for(int i=0; i<keys.size(); ++i)
-	{
-		QString key = keys.at(i);
-		if(!yourMap.contains(key))
-			return 1;
-
-		qdropboxjson_entry myEntry = valueMap.value(key);
-		qdropboxjson_entry yourEntry = yourMap.value(key);
-		
-		if(myEntry.type != yourEntry.type)
-			return 1;
-
-		if(myEntry.type == QDROPBOXJSON_TYPE_JSON)
-		{
-			if(myEntry.value.json->compare(*yourEntry.value.json) != 0)
-				return 1;
-		}
-		else
-		{
-			if(myEntry.value.value->compare(yourEntry.value.value) != 0)
-				return 1;
-		}
-	}
-
-	return 0;
+	return _doc->equals(_node, *other._doc, other._node) ? 0 : 1;
+}
+
+quint64 QDropboxJson::hash() const
+{
+    return _doc->hash(_node);
+}
+
+void QDropboxJson::freeze() const
+{
+    _doc->freeze();
+}
+
+QList<QDropboxJsonChange> QDropboxJson::diff(const QDropboxJson &other) const
+{
+    QList<QDropboxJsonChange> changes;
+    diff(_node, other, other._node, QString(), changes);
+    return changes;
+}
+
+void QDropboxJson::diff(int index, const QDropboxJson &other, int otherIndex, const QString &path,
+                        QList<QDropboxJsonChange> &changes) const
+{
+    const QDropboxJsonDocument &a = *_doc;
+    const QDropboxJsonDocument &b = *other._doc;
+    if(a.equals(index, b, otherIndex))
+        return;
+
+    QDropboxJsonChange change;
+    const qdropboxjson_entry_type type = a.node(index).type;
+    if(type != b.node(otherIndex).type || (type != QDROPBOXJSON_TYPE_JSON && type != QDROPBOXJSON_TYPE_ARRAY))
+    {
+        change.type = QDropboxJsonChange::Modified;
+        change.path = path;
+        changes.append(change);
+        return;
+    }
+
+    // equals() computed the hashes, so both are parsed already
+    const int first      = a.node(index).value.children.first;
+    const int count      = a.node(index).value.children.count;
+    const int otherFirst = b.node(otherIndex).value.children.first;
+    const int otherCount = b.node(otherIndex).value.children.count;
+
+    if(type == QDROPBOXJSON_TYPE_JSON)
+    {
+        // both objects are looked up once, of duplicated keys only the last one counts
+        QHash<QByteArray, int> members;
+        QHash<QByteArray, int> otherMembers;
+        members.reserve(count);
+        otherMembers.reserve(otherCount);
+        for(int i=first; i<first+count; ++i)
+            members.insert(a.key(i), i);
+        for(int j=otherFirst; j<otherFirst+otherCount; ++j)
+            otherMembers.insert(b.key(j), j);
+
+        const QString prefix = path.isEmpty() ? path : path + ".";
+        for(int i=first; i<first+count; ++i)
+        {
+            const QByteArray key = a.key(i);
+            if(members.value(key) != i)
+                continue;
+
+            const int j = otherMembers.value(key, -1);
+            if(j < 0)
+            {
+                change.type = QDropboxJsonChange::Removed;
+                change.path = prefix + QString::fromUtf8(key);
+                changes.append(change);
+            }
+            else
+                diff(i, other, j, prefix + QString::fromUtf8(key), changes);
+        }
+        for(int j=otherFirst; j<otherFirst+otherCount; ++j)
+        {
+            const QByteArray key = b.key(j);
+            if(otherMembers.value(key) == j && !members.contains(key))
+            {
+                change.type = QDropboxJsonChange::Added;
+                change.path = prefix + QString::fromUtf8(key);
+                changes.append(change);
+            }
+        }
+        return;
+    }
+
+    // elements are looked up by their hashes, equal elements may move; a hash only names
+    // candidates, equals() confirms the match
+    QHash<quint64, QList<int> > unmatched;
+    for(int j=otherFirst; j<otherFirst+otherCount; ++j)
+        unmatched[b.hash(j)].append(j);
+
+    QBitArray matched(otherCount);
+    for(int i=0; i<count; ++i)
+    {
+        bool found = false;
+        QHash<quint64, QList<int> >::iterator it = unmatched.find(a.hash(first+i));
+        if(it != unmatched.end())
+        {
+            QList<int> &candidates = it.value();
+            for(int k=0; k<candidates.size() && !found; ++k)
+            {
+                if(a.equals(first+i, b, candidates.at(k)))
+                {
+                    matched.setBit(candidates.at(k)-otherFirst);
+                    candidates.removeAt(k);
+                    found = true;
+                }
+            }
+        }
+        if(found)
+            continue;
+
+        change.type = QDropboxJsonChange::Removed;
+        change.path = path + "[" + QString::number(i) + "]";
+        changes.append(change);
+    }
+
+    for(int j=0; j<otherCount; ++j)
+    {
+        if(matched.testBit(j))
+            continue;
+
+        change.type = QDropboxJsonChange::Added;
+        change.path = path + "[" + QString::number(j) + "]";
+        changes.append(change);
+    }
 }
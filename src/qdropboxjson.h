@@ -2,9 +2,10 @@
 #define QDROPBOXJSON_H
 
 #include "qtdropbox_global.h"
+#include "qdropboxjsondocument.h"
 
-#include <QObject>
 #include <QMap>
+#include <QExplicitlySharedDataPointer>
 #include <QList>
 #include <QDateTime>
 #include <QStringList>
@@ -13,29 +14,20 @@
 #include <QDebug>
 #endif
 
-typedef char qdropboxjson_entry_type;
+class QDropboxJsonArray;
+class QDropboxJsonValue;
 
-const qdropboxjson_entry_type QDROPBOXJSON_TYPE_NUM     = 'N';
-const qdropboxjson_entry_type QDROPBOXJSON_TYPE_STR     = 'S';
-const qdropboxjson_entry_type QDROPBOXJSON_TYPE_JSON    = 'J';
-const qdropboxjson_entry_type QDROPBOXJSON_TYPE_ARRAY   = 'A';
-const qdropboxjson_entry_type QDROPBOXJSON_TYPE_FLOAT   = 'F';
-const qdropboxjson_entry_type QDROPBOXJSON_TYPE_BOOL    = 'B';
-const qdropboxjson_entry_type QDROPBOXJSON_TYPE_UINT    = 'U';
-const qdropboxjson_entry_type QDROPBOXJSON_TYPE_UNKNOWN = '?';
-
-class QDropboxJson;
-
-//! Keeps values of a JSON
-union qdropboxjson_value{
-    QDropboxJson  *json; //!< Used to store subjsons (JSON in JSON)
-    QString       *value; //!< used to store a real value, all values are converted from QString
-};
+//! A difference between two JSONs found by QDropboxJson::diff()
+struct QDropboxJsonChange{
+    //! Kinds of differences
+    enum Type{
+        Added,   //!< The value exists only in the new JSON
+        Removed, //!< The value exists only in the old JSON
+        Modified //!< The value exists in both JSONs but differs
+    };
 
-//! Keeps keys of a JSON
-struct qdropboxjson_entry{
-    qdropboxjson_entry_type type; //!< Datatype of value
-    qdropboxjson_value      value; //!< Reference to the value struct
+    Type    type; //!< Kind of the difference
+    QString path; //!< Path of the value in the syntax of QDropboxJsonPath (e.g. "contents[3]")
 };
 
 //! Used to store JSON data that is returned from Dropbox.
@@ -49,41 +41,67 @@ struct qdropboxjson_entry{
   constructor or using parseString(). If any error occurs the QDropboxJson will be marked as
   invalid (see isValid()).
 
+  The parsed data is kept in a QDropboxJsonDocument. Sub JSONs returned by getJson() are
+  views of the same document, so a whole JSON consists of a few buffers regardless of its size.
+
+  QDropboxJson is an implicitly shared value class: copies share the document, so copying
+  (e.g. returning a QDropboxFileInfo or appending it to a QList) takes constant time. The
+  document is copied when a setter is called while it is shared (copy-on-write).
+
+  Nested objects and arrays are parsed when they are read, which modifies the shared
+  document. Copies that are read by several threads at the same time therefore have to be
+  frozen first (see freeze()). QDropbox freezes all results it emits or hands to a
+  QDropboxReply, so these can be passed to other threads as they are.
+
   The data of a valid QDropboxJson can be accessed by using one of the get-functions. If the
   value you want to access is not mapped to the datatype you requested an empty value will be
   returned. You can always set a force flag. If you do the returned value will be converted but
   may return nonsense data. Use this flag with care and only if you know what you're doing.
 
-  \warning Currently arrays in JSONs are not supported.
+  Arrays can be accessed by getJsonArray(), which returns the parsed elements as typed
+  values (see QDropboxJsonArray).
+
   \todo Implemement setter functions and toString() for JSON generation (altough not necessary it
         would be a nice feature)
  */
-class QTDROPBOXSHARED_EXPORT QDropboxJson : public QObject
+class QTDROPBOXSHARED_EXPORT QDropboxJson
 {
-    Q_OBJECT
 public:
     /*!
       Creates an empty JSON object.
-
-      \param parent Pointer to the parent QObject.
      */
-    QDropboxJson(QObject *parent = 0);
+    QDropboxJson();
 
     /*!
       This constructor interprets the given string as JSON.
 
       \param strJson JSON as string.
-      \param parent Parent QObject.
      */
-    QDropboxJson(QString strJson, QObject *parent = 0);
+    QDropboxJson(QString strJson);
 
     /*!
-      Copies the data of another QDropboxJSon.
+      Copies another QDropboxJson. The data is shared until either of them is modified.
 
       \param other The QDropboxJson to be copied.
      */
     QDropboxJson(const QDropboxJson &other);
 
+#ifdef Q_COMPILER_RVALUE_REFS
+    /*!
+      Moves the data of another QDropboxJson, other is left empty.
+     */
+    QDropboxJson(QDropboxJson &&other);
+#endif
+
+    /*!
+      Creates a QDropboxJson for an element of an array that is an object (or array). The
+      data is not copied, the QDropboxJson is a view of the same document. If the element
+      is not an object or array the QDropboxJson is invalid.
+
+      \param value Element of a QDropboxJsonArray.
+     */
+    QDropboxJson(const QDropboxJsonValue &value);
+
     /*!
       Cleans up the JSON on destruction.
      */
@@ -93,13 +111,13 @@ public:
       This enum is used to categorize the data type of JSON values.
      */
     enum DataType{
-        NumberType, //!< Number based type (interpreted as qint64)
+        NumberType, //!< Number based type (stored as qint64)
         StringType, //!< String based type of variable length
         JsonType,   //!< A subjson
-        ArrayType,  //!< Array data type (currently not supported!)
+        ArrayType,  //!< Array data type (see getJsonArray())
         FloatType,  //!< Floating point based datatype
         BoolType,   //!< Boolean based types.
-        UnsignedIntType, //!< Number based type unsigned (only applied if NumberType does not match)
+        UnsignedIntType, //!< Number based type unsigned (only applied if the value exceeds qint64)
         UnknownType //!< Data type could not be identified.
     };
 
@@ -111,6 +129,15 @@ public:
      */
     void parseString(QString strJson);
 
+    /*!
+      Interprets UTF-8 encoded data (e.g. the body of a network reply) as JSON. The data
+      is not converted to QString: the QDropboxJson keeps an implicitly shared reference to
+      the given buffer and values are only decoded when they are requested.
+
+      \param json JSON in UTF-8 representation.
+     */
+    void parseUtf8(const QByteArray &json);
+
     /*!
       Drops all stored JSON data.
      */
@@ -137,8 +164,9 @@ public:
 
     /*!
       Returns a stored integer value identified by the given key. If the key does
-      not map 0 is returned. If the force flag is set the check of the data type
-      is omitted and it is tried to convert the value regardless of the real data type.
+      not map 0 is returned. Unsigned values are returned if they fit into qint64.
+      If the force flag is set the check of the data type is omitted and it is tried
+      to convert the value regardless of the real data type.
      */
     qint64 getInt(QString key, bool force = false);
 
@@ -146,8 +174,9 @@ public:
 
     /*!
       Returns a stored unsigned integer value identified by the given key. If the key does
-      not map 0 is returned. If the force flag is set the check of the data type
-      is omitted and it is tried to convert the value regardless of the real data type.
+      not map 0 is returned. Non-negative values of NumberType are returned as well.
+      If the force flag is set the check of the data type is omitted and it is tried to
+      convert the value regardless of the real data type.
      */
     quint64       getUInt(QString key, bool force = false);
 
@@ -172,8 +201,9 @@ public:
 
     /*!
       Returns a stored floating point value identified by the given key. If the key does
-      not map 0.0 is returned. If the force flag is set the check of the data type
-      is omitted and it is tried to convert the value regardless of the real data type.
+      not map 0.0 is returned. Integer values are converted to double. If the force flag
+      is set the check of the data type is omitted and it is tried to convert the value
+      regardless of the real data type.
      */
     double        getDouble(QString key, bool force = false);
 
@@ -189,16 +219,21 @@ public:
     void setBool(QString key, bool value);
 
     /*!
-      Returns the stored JSON's string representation.
+      Returns the stored JSON's string representation in compact format. Use QDropboxJsonWriter
+      to get UTF-8 directly, a canonical representation or to write to a QIODevice.
      */
     QString strContent() const;
 
 	/*!
-	  Returns a stored string values as QDateTime timestamp. The timestamp will be invalid
+	  Returns a stored string values as QDateTime timestamp in UTC. The timestamp will be invalid
 	  if the string could not be converted.
 	*/
     QDateTime getTimestamp(QString key, bool force = false);
 
+    /*!
+      Stores a timestamp in the format used by Dropbox (e.g. "Sat, 21 Aug 2010 22:31:20 +0000").
+      The time is converted to UTC, an invalid timestamp is stored as empty string.
+     */
     void setTimestamp(QString key, QDateTime value);
 
 	/*!
@@ -206,7 +241,7 @@ public:
 	  stored as array the function returns an empty list. If you need the items in a specific
 	  data type you have to do equivalent casting your self!
 	*/
-	QStringList getArray(QString key, bool force = false);
+	QStringList getArray(QString key, bool force = false) const;
 
 	/*!
 	  Returns the content of a stored array as a list of string items <i>if the JSON contains
@@ -215,10 +250,36 @@ public:
 	*/
 	QStringList getArray();
 
+    /*!
+      Returns the array mapped to the key. The elements are parsed once and can be accessed
+      as typed values without converting them to strings. If the key does not exist or is
+      not stored as array an empty array is returned.
+    */
+    QDropboxJsonArray getJsonArray(QString key) const;
+
+    /*!
+      Returns the elements of the JSON <i>if the JSON is an anonymous array</i> (see also
+      isAnonymousArray()). Otherwise an empty array is returned.
+    */
+    QDropboxJsonArray getJsonArray() const;
+
 	/**!
-	  Overloaded operator to copy a QDropboxJson.
+	  Overloaded operator to copy a QDropboxJson. The data is shared until either of them
+	  is modified.
 	*/
-    QDropboxJson& operator =(QDropboxJson&);
+    QDropboxJson& operator =(const QDropboxJson&);
+
+#ifdef Q_COMPILER_RVALUE_REFS
+    /*!
+      Moves the data of another QDropboxJson.
+     */
+    QDropboxJson& operator =(QDropboxJson &&other);
+#endif
+
+    /*!
+      Swaps the data of two QDropboxJson instances.
+     */
+    void swap(QDropboxJson &other);
 
 	/**!
 	  A JSON may be an anonymous array like this:
@@ -238,26 +299,67 @@ public:
 	  Compares two JSON objects if they are the same.
 	  This means that they have the same keys with the same values.
 
+	  Objects and arrays with different structural hashes (see hash()) are unequal right
+	  away, equal hashes are confirmed by comparing the values.
+
 	  \param other the JSON you wish to compare to
 	  \returns 0 if the JSON objects are equals
 	*/
 	int compare(const QDropboxJson& other);
+
+    /*!
+      Returns a 64-bit structural hash of the JSON. Equal JSONs (see compare()) have equal
+      hashes regardless of the order of their keys.
+     */
+    quint64 hash() const;
+
+    /*!
+      Lists the differences between this (old) JSON and another (new) one. Subtrees with
+      equal hashes are skipped, only changed keys are visited. Nested objects are compared
+      key by key. Elements of arrays are matched by their values (looked up by their hashes):
+      an element that changed is reported as removed at its old index and added at its new
+      index.
+
+      \param other the new JSON
+     */
+    QList<QDropboxJsonChange> diff(const QDropboxJson &other) const;
+
+    /*!
+      Parses the whole document of the JSON at once. Afterwards reading the JSON or any of
+      its copies does not modify the document anymore, so the copies may be read by
+      several threads at the same time. Calling a setter ends this state for the modified
+      copy only.
+     */
+    void freeze() const;
     
 protected:
 		bool valid;
 
 private:
-    QMap<QString, qdropboxjson_entry> valueMap;
-	bool _anonymousArray;
+    QExplicitlySharedDataPointer<QDropboxJsonDocument> _doc;
+    int _node;
+    QMap<QString, QDropboxJson*> _children;
+    QDropboxJson *_parent;
 
     void emptyList();
-    qdropboxjson_entry_type interpretType(QString value);
-	QString translateMonth(QString month);
-    QString translateMonth(int month);
-	QString translateDay(QString day);
-    QString translateDay(int day);
-	int parseSubJson(QString str, int start, qdropboxjson_entry *jsonEntry);
 	void _init();
+    void detach();
+    int  views(const QDropboxJsonDocument *doc) const;
+    void rebind(const QDropboxJsonDocument *doc, const QExplicitlySharedDataPointer<QDropboxJsonDocument> &copy);
+
+    const qdropboxjson_node *find(QString key, int *index = NULL) const;
+    void setValue(QString key, const qdropboxjson_node &value);
+    void rebindChildren();
+    QStringList arrayItems(int index) const;
+    void diff(int index, const QDropboxJson &other, int otherIndex, const QString &path,
+              QList<QDropboxJsonChange> &changes) const;
+
+    static DataType dataType(qdropboxjson_entry_type type);
+
+    friend class QDropboxJsonValue;
+    friend class QDropboxJsonWriter;
+    friend class QDropboxJsonPath;
+    friend class QDropboxJsonSnapshot;
 };
 
 #endif // QDROPBOXJSON_H
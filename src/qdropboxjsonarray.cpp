@@ -0,0 +1,135 @@
+#include "qdropboxjsonarray.h"
+
+QDropboxJsonValue::QDropboxJsonValue() :
+    _node(-1)
+{
+}
+
+QDropboxJsonValue::QDropboxJsonValue(const QExplicitlySharedDataPointer<QDropboxJsonDocument> &doc, int node) :
+    _doc(doc),
+    _node(node)
+{
+}
+
+bool QDropboxJsonValue::isValid() const
+{
+    return _doc && _node >= 0;
+}
+
+QDropboxJson::DataType QDropboxJsonValue::type() const
+{
+    if(!isValid())
+        return QDropboxJson::UnknownType;
+
+    return QDropboxJson::dataType(_doc->node(_node).type);
+}
+
+qint64 QDropboxJsonValue::toInt(bool force) const
+{
+    if(!isValid())
+        return 0;
+
+    return _doc->toInt(_node, force);
+}
+
+quint64 QDropboxJsonValue::toUInt(bool force) const
+{
+    if(!isValid())
+        return 0;
+
+    return _doc->toUInt(_node, force);
+}
+
+QString QDropboxJsonValue::toString(bool force) const
+{
+    if(!isValid())
+        return "";
+
+    return _doc->toString(_node, force);
+}
+
+double QDropboxJsonValue::toDouble(bool force) const
+{
+    if(!isValid())
+        return 0.0;
+
+    return _doc->toDouble(_node, force);
+}
+
+bool QDropboxJsonValue::toBool(bool force) const
+{
+    if(!isValid())
+        return false;
+
+    return _doc->toBool(_node, force);
+}
+
+QDropboxJsonArray QDropboxJsonValue::toArray() const
+{
+    if(!isValid() || _doc->node(_node).type != QDROPBOXJSON_TYPE_ARRAY)
+        return QDropboxJsonArray();
+
+    return QDropboxJsonArray(_doc, _node);
+}
+
+QDropboxJsonArray::QDropboxJsonArray() :
+    _first(0),
+    _count(0)
+{
+}
+
+QDropboxJsonArray::QDropboxJsonArray(const QExplicitlySharedDataPointer<QDropboxJsonDocument> &doc, int node) :
+    _doc(doc),
+    _first(0),
+    _count(0)
+{
+    // the elements are parsed once, the range of the nodes does not change afterwards
+    if(!_doc->materialize(node))
+        return;
+
+    const qdropboxjson_node &array = _doc->node(node);
+    _first = array.value.children.first;
+    _count = array.value.children.count;
+}
+
+int QDropboxJsonArray::size() const
+{
+    return _count;
+}
+
+bool QDropboxJsonArray::isEmpty() const
+{
+    return _count == 0;
+}
+
+QDropboxJsonValue QDropboxJsonArray::at(int i) const
+{
+    Q_ASSERT_X(i >= 0 && i < _count, "QDropboxJsonArray::at", "index out of range");
+    return QDropboxJsonValue(_doc, _first + i);
+}
+
+QDropboxJsonValue QDropboxJsonArray::operator[](int i) const
+{
+    return at(i);
+}
+
+QDropboxJsonArray QDropboxJsonArray::mid(int pos, int length) const
+{
+    if(!_doc || pos < 0 || pos > _count)
+        return QDropboxJsonArray();
+    if(length < 0 || length > _count - pos)
+        length = _count - pos;
+
+    QExplicitlySharedDataPointer<QDropboxJsonDocument> doc(_doc->copyRange(_first + pos, length));
+    return QDropboxJsonArray(doc, 0);
+}
+
+QDropboxJsonArray::const_iterator QDropboxJsonArray::begin() const
+{
+    return const_iterator(this, 0);
+}
+
+QDropboxJsonArray::const_iterator QDropboxJsonArray::end() const
+{
+    return const_iterator(this, _count);
+}
@@ -0,0 +1,178 @@
+#ifndef QDROPBOXJSONARRAY_H
+#define QDROPBOXJSONARRAY_H
+
+#include "qtdropbox_global.h"
+#include "qdropboxjsondocument.h"
+#include "qdropboxjson.h"
+
+#include <QExplicitlySharedDataPointer>
+#include <QString>
+
+class QDropboxJsonArray;
+
+//! A single element of a JSON array
+/*!
+  QDropboxJsonValue is a lightweight view of one element of a parsed JSON array (or of a value
+  selected by QDropboxJsonPath). It shares the document of the QDropboxJson it was obtained
+  from, nothing is copied or parsed again when it is created. Values are converted like the
+  get-functions of QDropboxJson do. An element that is an object can be accessed by passing
+  the value to the constructor of QDropboxJson (or QDropboxFileInfo), a nested array by
+  using toArray().
+
+  A value reflects the state of the document at the time it was obtained. Do not use it
+  after keys of the QDropboxJson it belongs to have been modified.
+ */
+class QTDROPBOXSHARED_EXPORT QDropboxJsonValue
+{
+public:
+    /*!
+      Creates an invalid value.
+     */
+    QDropboxJsonValue();
+
+    /*!
+      Returns true if the value refers to an element of an array.
+     */
+    bool isValid() const;
+
+    /*!
+      Returns the data type of the element.
+     */
+    QDropboxJson::DataType type() const;
+
+    /*!
+      Returns the element as integer. See QDropboxJson::getInt().
+     */
+    qint64 toInt(bool force = false) const;
+
+    /*!
+      Returns the element as unsigned integer. See QDropboxJson::getUInt().
+     */
+    quint64 toUInt(bool force = false) const;
+
+    /*!
+      Returns the element as string. See QDropboxJson::getString().
+     */
+    QString toString(bool force = false) const;
+
+    /*!
+      Returns the element as floating point value. See QDropboxJson::getDouble().
+     */
+    double toDouble(bool force = false) const;
+
+    /*!
+      Returns the element as boolean value. See QDropboxJson::getBool().
+     */
+    bool toBool(bool force = false) const;
+
+    /*!
+      Returns the element as array. The array is empty if the element is not an array.
+     */
+    QDropboxJsonArray toArray() const;
+
+private:
+    QDropboxJsonValue(const QExplicitlySharedDataPointer<QDropboxJsonDocument> &doc, int node);
+
+    QExplicitlySharedDataPointer<QDropboxJsonDocument> _doc;
+    int _node;
+
+    friend class QDropboxJson;
+    friend class QDropboxJsonArray;
+    friend class QDropboxJsonStreamReader;
+    friend class QDropboxJsonPath;
+};
+
+//! Provides indexed access to a parsed JSON array
+/*!
+  QDropboxJsonArray is a lightweight view of an array stored in a QDropboxJson. The elements
+  are parsed once when the array is obtained (see QDropboxJson::getJsonArray()) and are
+  returned as QDropboxJsonValue without converting them to strings:
+
+  \code
+  QDropboxJsonArray contents = json.getJsonArray("contents");
+  for(int i=0; i<contents.size(); ++i)
+      qDebug() << contents.at(i).toString();
+  \endcode
+
+  The array can be traversed with STL style iterators (and range based for loops) as well.
+ */
+class QTDROPBOXSHARED_EXPORT QDropboxJsonArray
+{
+public:
+    //! Iterates the elements of a QDropboxJsonArray
+    class const_iterator
+    {
+    public:
+        const_iterator() : _array(NULL), _i(0) {}
+
+        QDropboxJsonValue operator*() const { return _array->at(_i); }
+
+        const_iterator &operator++() { ++_i; return *this; }
+        const_iterator operator++(int) { const_iterator it = *this; ++_i; return it; }
+
+        bool operator==(const const_iterator &other) const { return _i == other._i; }
+        bool operator!=(const const_iterator &other) const { return _i != other._i; }
+
+    private:
+        const_iterator(const QDropboxJsonArray *array, int i) : _array(array), _i(i) {}
+
+        const QDropboxJsonArray *_array;
+        int                      _i;
+
+        friend class QDropboxJsonArray;
+    };
+
+    /*!
+      Creates an empty array.
+     */
+    QDropboxJsonArray();
+
+    /*!
+      Returns the number of elements.
+     */
+    int size() const;
+
+    /*!
+      Returns true if the array has no elements.
+     */
+    bool isEmpty() const;
+
+    /*!
+      Returns the element at index i. i must be a valid index (0 <= i < size()).
+     */
+    QDropboxJsonValue at(int i) const;
+
+    /*!
+      Same as at().
+     */
+    QDropboxJsonValue operator[](int i) const;
+
+    /*!
+      Returns an array of length elements starting at pos (all remaining elements if length
+      is -1). The elements are copied to a new document that shares nothing but the source
+      text with this array, so arrays returned by mid() can be read by different threads.
+     */
+    QDropboxJsonArray mid(int pos, int length = -1) const;
+
+    /*!
+      Returns an iterator pointing to the first element.
+     */
+    const_iterator begin() const;
+
+    /*!
+      Returns an iterator pointing behind the last element.
+     */
+    const_iterator end() const;
+
+private:
+    QDropboxJsonArray(const QExplicitlySharedDataPointer<QDropboxJsonDocument> &doc, int node);
+
+    QExplicitlySharedDataPointer<QDropboxJsonDocument> _doc;
+    int _first;
+    int _count;
+
+    friend class QDropboxJson;
+    friend class QDropboxJsonValue;
+};
+
+#endif // QDROPBOXJSONARRAY_H
@@ -0,0 +1,1440 @@
+#include "qdropboxjsondocument.h"
+#include "qdropboxjsonscanner.h"
+#include "qdropboxjsonwriter.h"
+
+#include <QHash>
+
+#include <cstring>
+#include <limits>
+
+//! Keys of the Dropbox API, the id of a key is its position in the list plus one
+static const char *const knownKeys[] = {
+    // metadata
+    "size", "rev", "revision", "thumb_exists", "bytes", "modified", "client_modified", "path",
+    "is_dir", "icon", "root", "mime_type", "hash", "contents", "is_deleted", "photo_info",
+    "video_info", "read_only", "parent_shared_folder_id", "modifier", "shared_folder",
+    // account info
+    "uid", "display_name", "referral_link", "country", "email", "quota_info", "quota", "shared",
+    "normal", "team", "locale", "is_paired", "name_details",
+    // shares, delta and errors
+    "url", "expires", "error", "entries", "reset", "cursor", "has_more"
+};
+
+static inline uint keyChar(char c)
+{
+    return uchar(c);
+}
+
+static inline uint keyChar(QChar c)
+{
+    return c.unicode();
+}
+
+template<typename Char>
+static inline uint keyHash(const Char *key, int length)
+{
+    // free of collisions for the known keys, this is checked when the table is built
+    return (uint(length) + keyChar(key[0]) + keyChar(key[length-1])*27 + keyChar(key[length/2])*7) & 127;
+}
+
+//! Perfect hash table of the known keys
+struct qdropboxjson_key_table{
+    quint16 ids[128];
+
+    qdropboxjson_key_table()
+    {
+        memset(ids, 0, sizeof(ids));
+        for(int i=0; i<int(sizeof(knownKeys)/sizeof(knownKeys[0])); ++i)
+        {
+            const uint slot = keyHash(knownKeys[i], int(strlen(knownKeys[i])));
+            Q_ASSERT_X(ids[slot] == 0, "qdropboxjson_key_table", "hash collision");
+            ids[slot] = quint16(i+1);
+        }
+    }
+
+    template<typename Char>
+    int find(const Char *key, int length) const
+    {
+        if(length <= 0)
+            return 0;
+
+        const int id = ids[keyHash(key, length)];
+        if(id == 0)
+            return 0;
+
+        // the slot only says which known key it could be
+        const char *known = knownKeys[id-1];
+        for(int i=0; i<length; ++i)
+        {
+            if(known[i] == '\0' || keyChar(key[i]) != uchar(known[i]))
+                return 0;
+        }
+        return known[length] == '\0' ? id : 0;
+    }
+};
+
+Q_GLOBAL_STATIC(qdropboxjson_key_table, keyTable)
+
+//! Finalizer of MurmurHash3, every bit of the input affects every bit of the result
+static inline quint64 mixHash(quint64 h)
+{
+    h ^= h >> 33;
+    h *= Q_UINT64_C(0xff51afd7ed558ccd);
+    h ^= h >> 33;
+    h *= Q_UINT64_C(0xc4ceb9fe1a85ec53);
+    h ^= h >> 33;
+    return h;
+}
+
+//! MurmurHash64A of a string of bytes
+static quint64 hashBytes(const char *data, int size, quint64 seed)
+{
+    const quint64 m = Q_UINT64_C(0xc6a4a7935bd1e995);
+    quint64       h = seed ^ (quint64(size) * m);
+
+    int i = 0;
+    for(; i+8 <= size; i += 8)
+    {
+        quint64 k;
+        memcpy(&k, data+i, sizeof(k));
+        k *= m;
+        k ^= k >> 47;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+    if(i < size)
+    {
+        quint64 k = 0;
+        memcpy(&k, data+i, size-i);
+        h ^= k;
+        h *= m;
+    }
+
+    h ^= h >> 47;
+    h *= m;
+    h ^= h >> 47;
+    return h;
+}
+
+//! Seed of the structural hash of a type, so values of different types do not collide
+static inline quint64 typeSeed(qdropboxjson_entry_type type)
+{
+    return mixHash(quint64(uchar(type)) * Q_UINT64_C(0x9e3779b97f4a7c15));
+}
+
+static const char monthNames[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+static const char dayNames[]   = "MonTueWedThuFriSatSun";
+
+//! Days since 1970-01-01 of a date in the proleptic Gregorian calendar
+static qint64 daysFromCivil(qint64 year, int month, int day)
+{
+    // years start in March, so the leap day is the last day of the year
+    year -= (month <= 2) ? 1 : 0;
+    const qint64 era = (year >= 0 ? year : year-399) / 400;
+    const qint64 yoe = year - era*400;
+    const qint64 doy = (153*(month > 2 ? month-3 : month+9) + 2)/5 + day-1;
+    const qint64 doe = yoe*365 + yoe/4 - yoe/100 + doy;
+    return era*146097 + doe - 719468;
+}
+
+//! Date of a number of days since 1970-01-01, inverse of daysFromCivil()
+static void civilFromDays(qint64 days, qint64 *year, int *month, int *day)
+{
+    days += 719468;
+    const qint64 era = (days >= 0 ? days : days-146096) / 146097;
+    const qint64 doe = days - era*146097;
+    const qint64 yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+    const qint64 doy = doe - (365*yoe + yoe/4 - yoe/100);
+    const qint64 mp  = (5*doy + 2)/153;
+    *day   = int(doy - (153*mp + 2)/5 + 1);
+    *month = int(mp < 10 ? mp+3 : mp-9);
+    *year  = yoe + era*400 + (*month <= 2 ? 1 : 0);
+}
+
+static bool parseDigits(const char *data, int size, int &pos, int minDigits, int maxDigits, int *value)
+{
+    int digits = 0;
+    *value = 0;
+    for(; pos < size && digits < maxDigits && data[pos] >= '0' && data[pos] <= '9'; ++pos, ++digits)
+        *value = *value*10 + (data[pos]-'0');
+    return digits >= minDigits;
+}
+
+static bool skipSpaces(const char *data, int size, int &pos)
+{
+    const int start = pos;
+    while(pos < size && data[pos] == ' ')
+        ++pos;
+    return pos > start;
+}
+
+static void writeDigits(char *out, int value, int digits)
+{
+    for(int i=digits-1; i>=0; --i)
+    {
+        out[i] = char('0' + value%10);
+        value /= 10;
+    }
+}
+
+QDropboxJsonDocument::QDropboxJsonDocument() :
+    QSharedData()
+{
+    clear();
+}
+
+QDropboxJsonDocument::QDropboxJsonDocument(const QDropboxJsonDocument &other) :
+    QSharedData(other),
+    _source(other._source),
+    _pool(other._pool),
+    _nodes(other._nodes),
+    _hashes(other._hashes),
+    _modified(other._modified),
+    _frozen(other._frozen),
+    _snapshot(other._snapshot),
+    _mapping(other._mapping)
+{
+}
+
+bool QDropboxJsonDocument::parse(const QByteArray &json)
+{
+    clear();
+
+    // values without escape sequences are kept as spans into the (implicitly shared) buffer
+    _source = json;
+
+    const char *data = _source.constData();
+    const int   size = _source.size();
+    int         pos  = 0;
+
+    skipWhitespace(data, size, pos);
+
+    qdropboxjson_node root = _nodes.at(0);
+    root.offset = pos;
+    bool valid = pos < size && (data[pos] == '{' || data[pos] == '[');
+    if(valid)
+        valid = parseContainer(pos, &root);
+    root.length = pos - root.offset;
+
+    // nothing but whitespace may follow the JSON
+    skipWhitespace(data, size, pos);
+    if(valid && pos != size)
+        valid = false;
+
+    if(!valid)
+    {
+#ifdef QTDROPBOX_DEBUG
+        qDebug() << "json invalid at position " << pos << endl;
+#endif
+        clear();
+        return false;
+    }
+
+    _nodes[0] = root;
+
+#ifdef QTDROPBOX_DEBUG
+    qDebug() << "json parsed: " << _nodes.size() << " nodes, " << _pool.size() << " bytes pool" << endl;
+#endif
+    return true;
+}
+
+void QDropboxJsonDocument::clear()
+{
+    _source.clear();
+    _pool.clear();
+    _nodes.clear();
+    _hashes.clear();
+    _modified = false;
+    _frozen   = false;
+    _snapshot.clear();
+    _mapping.clear();
+
+    qdropboxjson_node root;
+    root.type                 = QDROPBOXJSON_TYPE_JSON;
+    root.flags                = 0;
+    root.keyId                = 0;
+    root.keyOffset            = 0;
+    root.keyLength            = 0;
+    root.offset               = -1;
+    root.length               = 0;
+    root.value.children.first = 1;
+    root.value.children.count = 0;
+    _nodes.append(root);
+}
+
+const qdropboxjson_node &QDropboxJsonDocument::node(int index) const
+{
+    return _nodes.at(index);
+}
+
+bool QDropboxJsonDocument::materialize(int index) const
+{
+    if(!(_nodes.at(index).flags & QDROPBOXJSON_NODE_LAZY))
+        return !(_nodes.at(index).flags & QDROPBOXJSON_NODE_INVALID);
+
+#ifdef QTDROPBOX_DEBUG
+    qDebug() << "json: materializing node " << index << endl;
+#endif
+
+    qdropboxjson_node n     = _nodes.at(index);
+    const int         nodes = _nodes.size();
+    const int         pool  = _pool.size();
+    int               pos   = n.offset;
+
+    n.flags &= ~QDROPBOXJSON_NODE_LAZY;
+
+    // the span was found by QDropboxJsonScanner::skipContainer(), parsing has to end at the same position
+    if(!parseContainer(pos, &n) || pos != n.offset + n.length)
+    {
+#ifdef QTDROPBOX_DEBUG
+        qDebug() << "json: node " << index << " invalid at position " << pos << endl;
+#endif
+        _nodes.resize(nodes);
+        _pool.resize(pool);
+        n.flags |= QDROPBOXJSON_NODE_INVALID;
+        n.value.children.first = nodes;
+        n.value.children.count = 0;
+    }
+
+    _nodes[index] = n;
+    return !(n.flags & QDROPBOXJSON_NODE_INVALID);
+}
+
+int QDropboxJsonDocument::findChild(int object, const QByteArray &key) const
+{
+    return findChild(object, internKey(key.constData(), key.size()), key.constData(), key.size());
+}
+
+int QDropboxJsonDocument::findChild(int object, const QString &key) const
+{
+    const int keyId = internKey(key.constData(), key.size());
+    if(keyId != 0)
+        return findChild(object, keyId, NULL, 0);
+
+    const QByteArray utf8 = key.toUtf8();
+    return findChild(object, 0, utf8.constData(), utf8.size());
+}
+
+QByteArray QDropboxJsonDocument::key(int index) const
+{
+    const qdropboxjson_node &n = _nodes.at(index);
+    return QByteArray(keyData(n), n.keyLength);
+}
+
+QString QDropboxJsonDocument::string(int index) const
+{
+    const qdropboxjson_node &n = _nodes.at(index);
+    if(n.type != QDROPBOXJSON_TYPE_STR)
+        return "";
+
+    return QString::fromUtf8(stringData(n), n.value.string.length);
+}
+
+qint64 QDropboxJsonDocument::toInt(int index, bool force) const
+{
+    const qdropboxjson_node &n = _nodes.at(index);
+    switch(n.type)
+    {
+    case QDROPBOXJSON_TYPE_NUM:
+        return n.value.intValue;
+    case QDROPBOXJSON_TYPE_UINT:
+        if(!force && n.value.uintValue > quint64(std::numeric_limits<qint64>::max()))
+            return 0;
+        return qint64(n.value.uintValue);
+    default:
+        break;
+    }
+
+    if(!force)
+        return 0;
+
+    switch(n.type)
+    {
+    case QDROPBOXJSON_TYPE_FLOAT:
+        return qint64(n.value.doubleValue);
+    case QDROPBOXJSON_TYPE_BOOL:
+        return n.value.boolValue ? 1 : 0;
+    case QDROPBOXJSON_TYPE_STR:
+        return string(index).toLongLong();
+    default:
+        return 0;
+    }
+}
+
+quint64 QDropboxJsonDocument::toUInt(int index, bool force) const
+{
+    const qdropboxjson_node &n = _nodes.at(index);
+    switch(n.type)
+    {
+    case QDROPBOXJSON_TYPE_UINT:
+        return n.value.uintValue;
+    case QDROPBOXJSON_TYPE_NUM:
+        // most unsigned values (e.g. bytes) fit into qint64 and are stored as such
+        if(!force && n.value.intValue < 0)
+            return 0;
+        return quint64(n.value.intValue);
+    default:
+        break;
+    }
+
+    if(!force)
+        return 0;
+
+    switch(n.type)
+    {
+    case QDROPBOXJSON_TYPE_FLOAT:
+        return quint64(n.value.doubleValue);
+    case QDROPBOXJSON_TYPE_BOOL:
+        return n.value.boolValue ? 1 : 0;
+    case QDROPBOXJSON_TYPE_STR:
+        return string(index).toULongLong();
+    default:
+        return 0;
+    }
+}
+
+double QDropboxJsonDocument::toDouble(int index, bool force) const
+{
+    const qdropboxjson_node &n = _nodes.at(index);
+    switch(n.type)
+    {
+    case QDROPBOXJSON_TYPE_FLOAT:
+        return n.value.doubleValue;
+    case QDROPBOXJSON_TYPE_NUM:
+        return double(n.value.intValue);
+    case QDROPBOXJSON_TYPE_UINT:
+        return double(n.value.uintValue);
+    default:
+        break;
+    }
+
+    if(!force)
+        return 0.0;
+
+    switch(n.type)
+    {
+    case QDROPBOXJSON_TYPE_BOOL:
+        return n.value.boolValue ? 1.0 : 0.0;
+    case QDROPBOXJSON_TYPE_STR:
+        return string(index).toDouble();
+    default:
+        return 0.0;
+    }
+}
+
+bool QDropboxJsonDocument::toBool(int index, bool force) const
+{
+    const qdropboxjson_node &n = _nodes.at(index);
+    if(n.type == QDROPBOXJSON_TYPE_BOOL)
+        return n.value.boolValue;
+
+    if(!force)
+        return false;
+
+    switch(n.type)
+    {
+    case QDROPBOXJSON_TYPE_NUM:
+        return n.value.intValue != 0;
+    case QDROPBOXJSON_TYPE_UINT:
+        return n.value.uintValue != 0;
+    case QDROPBOXJSON_TYPE_FLOAT:
+        return n.value.doubleValue != 0.0;
+    case QDROPBOXJSON_TYPE_STR:
+        return string(index) == "true";
+    default:
+        return false;
+    }
+}
+
+QString QDropboxJsonDocument::toString(int index, bool force) const
+{
+    if(_nodes.at(index).type == QDROPBOXJSON_TYPE_STR)
+        return string(index);
+
+    if(!force)
+        return "";
+
+    return QString::fromUtf8(text(index));
+}
+
+bool QDropboxJsonDocument::toTimestamp(int index, qint64 *msecs) const
+{
+    const qdropboxjson_node &n = _nodes.at(index);
+    if(n.type != QDROPBOXJSON_TYPE_STR)
+        return false;
+
+    return parseTimestamp(stringData(n), n.value.string.length, msecs);
+}
+
+QByteArray QDropboxJsonDocument::text(int index) const
+{
+    QByteArray out;
+    QDropboxJsonWriter().write(*this, index, out);
+    return out;
+}
+
+int QDropboxJsonDocument::setValue(int object, const QByteArray &key, const qdropboxjson_node &value)
+{
+    // the hashes of the object and all of its parents change, nodes do not know their parents
+    _modified = true;
+    _frozen   = false;
+    _hashes.clear();
+
+    qdropboxjson_node n = value;
+    n.offset = -1;
+    n.length = 0;
+
+    int index = findChild(object, key);
+    if(index >= 0)
+    {
+        // the node is replaced in place and keeps its key
+        const qdropboxjson_node &old = _nodes.at(index);
+        n.flags     = (n.flags & ~QDROPBOXJSON_NODE_KEY_POOL) | (old.flags & QDROPBOXJSON_NODE_KEY_POOL);
+        n.keyId     = old.keyId;
+        n.keyOffset = old.keyOffset;
+        n.keyLength = old.keyLength;
+        _nodes[index] = n;
+        return index;
+    }
+
+    n.flags    |= QDROPBOXJSON_NODE_KEY_POOL;
+    n.keyId     = quint16(internKey(key.constData(), key.size()));
+    n.keyOffset = _pool.size();
+    n.keyLength = key.size();
+    _pool.append(key);
+
+    return appendChild(object, n);
+}
+
+int QDropboxJsonDocument::setString(int object, const QByteArray &key, const QByteArray &value)
+{
+    qdropboxjson_node n;
+    n.type                = QDROPBOXJSON_TYPE_STR;
+    n.flags               = QDROPBOXJSON_NODE_STRING_POOL;
+    n.value.string.offset = _pool.size();
+    n.value.string.length = value.size();
+    _pool.append(value);
+
+    return setValue(object, key, n);
+}
+
+int QDropboxJsonDocument::setNode(int object, const QByteArray &key, const QDropboxJsonDocument &other, int index)
+{
+    // importing from this document would read from buffers that are modified meanwhile
+    if(&other == this)
+    {
+        QDropboxJsonDocument copy(other);
+        return setNode(object, key, copy, index);
+    }
+
+    return setValue(object, key, importNode(other, index));
+}
+
+QDropboxJsonDocument *QDropboxJsonDocument::copyRange(int first, int count) const
+{
+    QDropboxJsonDocument *doc = new QDropboxJsonDocument();
+    doc->_source   = _source;
+    doc->_modified = _modified;
+
+    // the slots of the elements are reserved first, imported children are appended behind them
+    doc->_nodes[0].value.children.first = 1;
+    doc->_nodes[0].value.children.count = count;
+    doc->_nodes.resize(1 + count);
+
+    for(int i=0; i<count; ++i)
+    {
+        const qdropboxjson_node &n = _nodes.at(first+i);
+        const bool container = (n.type == QDROPBOXJSON_TYPE_JSON || n.type == QDROPBOXJSON_TYPE_ARRAY);
+
+        qdropboxjson_node element;
+        if((container && !(n.flags & (QDROPBOXJSON_NODE_LAZY | QDROPBOXJSON_NODE_INVALID))) ||
+           (n.flags & QDROPBOXJSON_NODE_STRING_POOL))
+        {
+            // parsed containers and decoded strings refer to buffers that are not shared
+            element = doc->importNode(*this, first+i);
+        }
+        else
+        {
+            // everything else refers to the source only
+            element           = n;
+            element.flags    &= ~QDROPBOXJSON_NODE_KEY_POOL;
+            element.keyId     = 0;
+            element.keyOffset = 0;
+            element.keyLength = 0;
+        }
+        doc->_nodes[1+i] = element;
+    }
+
+    return doc;
+}
+
+bool QDropboxJsonDocument::equals(int index, const QDropboxJsonDocument &other, int otherIndex) const
+{
+    if(this == &other && index == otherIndex)
+        return true;
+
+    // objects and arrays that were not accessed yet are equal if their sources are
+    if((_nodes.at(index).flags & QDROPBOXJSON_NODE_LAZY) &&
+       (other._nodes.at(otherIndex).flags & QDROPBOXJSON_NODE_LAZY) &&
+       _nodes.at(index).length == other._nodes.at(otherIndex).length &&
+       memcmp(_source.constData() + _nodes.at(index).offset,
+              other._source.constData() + other._nodes.at(otherIndex).offset,
+              _nodes.at(index).length) == 0)
+        return true;
+
+    materialize(index);
+    other.materialize(otherIndex);
+
+    const qdropboxjson_node &a = _nodes.at(index);
+    const qdropboxjson_node &b = other._nodes.at(otherIndex);
+
+    // integers are equal regardless of their signedness
+    if(a.type == QDROPBOXJSON_TYPE_NUM && b.type == QDROPBOXJSON_TYPE_UINT)
+        return a.value.intValue >= 0 && quint64(a.value.intValue) == b.value.uintValue;
+    if(a.type == QDROPBOXJSON_TYPE_UINT && b.type == QDROPBOXJSON_TYPE_NUM)
+        return b.value.intValue >= 0 && quint64(b.value.intValue) == a.value.uintValue;
+
+    if(a.type != b.type)
+        return false;
+
+    switch(a.type)
+    {
+    case QDROPBOXJSON_TYPE_NUM:
+        return a.value.intValue == b.value.intValue;
+    case QDROPBOXJSON_TYPE_UINT:
+        return a.value.uintValue == b.value.uintValue;
+    case QDROPBOXJSON_TYPE_FLOAT:
+        return a.value.doubleValue == b.value.doubleValue;
+    case QDROPBOXJSON_TYPE_BOOL:
+        return a.value.boolValue == b.value.boolValue;
+    case QDROPBOXJSON_TYPE_STR:
+        return a.value.string.length == b.value.string.length &&
+               memcmp(stringData(a), other.stringData(b), a.value.string.length) == 0;
+    case QDROPBOXJSON_TYPE_JSON:
+    case QDROPBOXJSON_TYPE_ARRAY:
+        // objects with duplicated keys may differ in their number of children and still be equal
+        if(a.type == QDROPBOXJSON_TYPE_ARRAY && a.value.children.count != b.value.children.count)
+            return false;
+
+        // the cached hashes tell most unequal values apart, equal hashes may still collide
+        if(hash(index) != other.hash(otherIndex))
+            return false;
+        return equalChildren(index, other, otherIndex);
+    default:
+        return text(index) == other.text(otherIndex);
+    }
+}
+
+void QDropboxJsonDocument::freeze() const
+{
+    if(_frozen)
+        return;
+
+    // children are appended behind the nodes they belong to, so the loop reaches them as well
+    for(int i=0; i<_nodes.size(); ++i)
+        materialize(i);
+
+    for(int i=0; i<_nodes.size(); ++i)
+    {
+        const qdropboxjson_entry_type type = _nodes.at(i).type;
+        if(type == QDROPBOXJSON_TYPE_JSON || type == QDROPBOXJSON_TYPE_ARRAY)
+            hash(i);
+    }
+    _frozen = true;
+}
+
+bool QDropboxJsonDocument::isFrozen() const
+{
+    return _frozen;
+}
+
+quint64 QDropboxJsonDocument::hash(int index) const
+{
+    const qdropboxjson_node &n = _nodes.at(index);
+    switch(n.type)
+    {
+    case QDROPBOXJSON_TYPE_NUM:
+        // non-negative values are equal to unsigned ones (see equals())
+        if(n.value.intValue < 0)
+            return mixHash(typeSeed(QDROPBOXJSON_TYPE_NUM) ^ quint64(n.value.intValue));
+        return mixHash(typeSeed(QDROPBOXJSON_TYPE_UINT) ^ quint64(n.value.intValue));
+    case QDROPBOXJSON_TYPE_UINT:
+        return mixHash(typeSeed(QDROPBOXJSON_TYPE_UINT) ^ n.value.uintValue);
+    case QDROPBOXJSON_TYPE_FLOAT:
+    {
+        // 0.0 and -0.0 are equal
+        const double value = (n.value.doubleValue == 0.0) ? 0.0 : n.value.doubleValue;
+        quint64 bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return mixHash(typeSeed(QDROPBOXJSON_TYPE_FLOAT) ^ bits);
+    }
+    case QDROPBOXJSON_TYPE_BOOL:
+        return mixHash(typeSeed(QDROPBOXJSON_TYPE_BOOL) ^ quint64(n.value.boolValue ? 1 : 0));
+    case QDROPBOXJSON_TYPE_STR:
+        return hashBytes(stringData(n), n.value.string.length, typeSeed(QDROPBOXJSON_TYPE_STR));
+    case QDROPBOXJSON_TYPE_JSON:
+    case QDROPBOXJSON_TYPE_ARRAY:
+        break;
+    default:
+    {
+        const QByteArray value = text(index);
+        return hashBytes(value.constData(), value.size(), typeSeed(n.type));
+    }
+    }
+
+    if(index < _hashes.size() && _hashes.at(index) != 0)
+        return _hashes.at(index);
+
+    // the node may be moved by materializing it or its children
+    materialize(index);
+    const qdropboxjson_entry_type type  = _nodes.at(index).type;
+    const int                     first = _nodes.at(index).value.children.first;
+    const int                     count = _nodes.at(index).value.children.count;
+
+    // members hidden by a later member with the same key are not part of the value
+    QVarLengthArray<bool, 32> shadowed;
+    if(type == QDROPBOXJSON_TYPE_JSON)
+        markShadowed(first, count, shadowed);
+
+    quint64 h       = 0;
+    int     members = 0;
+    for(int i=first; i<first+count; ++i)
+    {
+        if(type == QDROPBOXJSON_TYPE_JSON && shadowed[i-first])
+            continue;
+
+        ++members;
+        const quint64 value = hash(i);
+        if(type == QDROPBOXJSON_TYPE_JSON)
+        {
+            // members are summed up, so the order of the keys does not matter
+            const qdropboxjson_node &child = _nodes.at(i);
+            h += mixHash(hashBytes(keyData(child), child.keyLength, value));
+        }
+        else
+            h = mixHash(h + value);
+    }
+    h = mixHash(h ^ typeSeed(type) ^ quint64(members));
+
+    // 0 marks hashes that were not computed yet
+    if(h == 0)
+        h = 1;
+    if(_hashes.size() < _nodes.size())
+        _hashes.resize(_nodes.size());
+    _hashes[index] = h;
+    return h;
+}
+
+int QDropboxJsonDocument::internKey(const char *key, int length)
+{
+    return keyTable()->find(key, length);
+}
+
+int QDropboxJsonDocument::internKey(const QChar *key, int length)
+{
+    return keyTable()->find(key, length);
+}
+
+bool QDropboxJsonDocument::parseTimestamp(const char *data, int size, qint64 *msecs)
+{
+    int pos = 0;
+    skipSpaces(data, size, pos);
+
+    // the day of the week follows from the date
+    if(size-pos >= 4 && data[pos+3] == ',')
+    {
+        pos += 4;
+        skipSpaces(data, size, pos);
+    }
+
+    int day;
+    if(!parseDigits(data, size, pos, 1, 2, &day) || !skipSpaces(data, size, pos) || size-pos < 3)
+        return false;
+
+    int month = 1;
+    while(month <= 12 && memcmp(monthNames + 3*(month-1), data+pos, 3) != 0)
+        ++month;
+    if(month > 12)
+        return false;
+    pos += 3;
+
+    int year, hour, minute, second;
+    if(!skipSpaces(data, size, pos) || !parseDigits(data, size, pos, 4, 4, &year) ||
+       !skipSpaces(data, size, pos) || !parseDigits(data, size, pos, 2, 2, &hour) ||
+       pos >= size || data[pos++] != ':' || !parseDigits(data, size, pos, 2, 2, &minute))
+        return false;
+
+    // seconds are optional
+    second = 0;
+    if(pos < size && data[pos] == ':')
+    {
+        ++pos;
+        if(!parseDigits(data, size, pos, 2, 2, &second))
+            return false;
+    }
+
+    // the zone is +hhmm or -hhmm, the obsolete names for UTC are accepted as well
+    int offset = 0;
+    if(!skipSpaces(data, size, pos) || pos >= size)
+        return false;
+    if(data[pos] == '+' || data[pos] == '-')
+    {
+        const int sign = (data[pos++] == '-') ? -1 : 1;
+        int zone;
+        if(!parseDigits(data, size, pos, 4, 4, &zone) || zone%100 >= 60)
+            return false;
+        offset = sign * ((zone/100)*60 + zone%100);
+    }
+    else if(size-pos >= 3 && memcmp(data+pos, "GMT", 3) == 0)
+        pos += 3;
+    else if(size-pos >= 2 && memcmp(data+pos, "UT", 2) == 0)
+        pos += 2;
+    else
+        return false;
+
+    skipSpaces(data, size, pos);
+    if(pos != size)
+        return false;
+
+    // a leap second (60) is counted as the first second of the next minute
+    static const int monthDays[] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    const bool leapYear = (year%4 == 0 && year%100 != 0) || year%400 == 0;
+    if(day < 1 || day > monthDays[month-1] || (month == 2 && day == 29 && !leapYear) ||
+       hour > 23 || minute > 59 || second > 60)
+        return false;
+
+    const qint64 seconds = ((daysFromCivil(year, month, day)*24 + hour)*60 + minute - offset)*60 + second;
+    *msecs = seconds * 1000;
+    return true;
+}
+
+int QDropboxJsonDocument::formatTimestamp(qint64 msecs, char *out)
+{
+    // rounded towards the past, also before 1970
+    qint64 seconds = msecs / 1000;
+    if(msecs % 1000 < 0)
+        --seconds;
+    qint64 days   = seconds / 86400;
+    int    inDay  = int(seconds % 86400);
+    if(inDay < 0)
+    {
+        inDay += 86400;
+        --days;
+    }
+
+    qint64 year;
+    int    month, day;
+    civilFromDays(days, &year, &month, &day);
+    if(year < 0 || year > 9999)
+        return 0;
+
+    // 1970-01-01 was a Thursday
+    const int weekday = int((days%7 + 10) % 7);
+
+    memcpy(out, dayNames + 3*weekday, 3);
+    out[3] = ',';
+    out[4] = ' ';
+    writeDigits(out+5, day, 2);
+    out[7] = ' ';
+    memcpy(out+8, monthNames + 3*(month-1), 3);
+    out[11] = ' ';
+    writeDigits(out+12, int(year), 4);
+    out[16] = ' ';
+    writeDigits(out+17, inDay/3600, 2);
+    out[19] = ':';
+    writeDigits(out+20, (inDay/60)%60, 2);
+    out[22] = ':';
+    writeDigits(out+23, inDay%60, 2);
+    memcpy(out+25, " +0000", 6);
+    return QDROPBOXJSON_TIMESTAMP_LENGTH;
+}
+
+const char *QDropboxJsonDocument::keyData(const qdropboxjson_node &node) const
+{
+    if(node.flags & QDROPBOXJSON_NODE_KEY_POOL)
+        return _pool.constData() + node.keyOffset;
+    return _source.constData() + node.keyOffset;
+}
+
+const char *QDropboxJsonDocument::stringData(const qdropboxjson_node &node) const
+{
+    if(node.flags & QDROPBOXJSON_NODE_STRING_POOL)
+        return _pool.constData() + node.value.string.offset;
+    return _source.constData() + node.value.string.offset;
+}
+
+int QDropboxJsonDocument::findChild(int object, int keyId, const char *key, int length) const
+{
+    if(!materialize(object))
+        return -1;
+
+    const qdropboxjson_node &o = _nodes.at(object);
+    if(o.type != QDROPBOXJSON_TYPE_JSON)
+        return -1;
+
+    const int first = o.value.children.first;
+    for(int i = first + o.value.children.count - 1; i >= first; --i)
+    {
+        const qdropboxjson_node &child = _nodes.at(i);
+        if(keyId != 0)
+        {
+            // known keys are equal if their ids are
+            if(child.keyId == keyId)
+                return i;
+        }
+        else if(child.keyId == 0 && child.keyLength == length &&
+                memcmp(keyData(child), key, length) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+void QDropboxJsonDocument::markShadowed(int first, int count, QVarLengthArray<bool, 32> &shadowed) const
+{
+    shadowed.resize(count);
+    for(int i=0; i<count; ++i)
+        shadowed[i] = false;
+
+    // small objects are compared pairwise, that is cheaper than building a hash
+    if(count <= 32)
+    {
+        for(int i=0; i<count; ++i)
+        {
+            const qdropboxjson_node &a = _nodes.at(first+i);
+            for(int j=i+1; j<count && !shadowed[i]; ++j)
+            {
+                const qdropboxjson_node &b = _nodes.at(first+j);
+                shadowed[i] = a.keyLength == b.keyLength && memcmp(keyData(a), keyData(b), a.keyLength) == 0;
+            }
+        }
+        return;
+    }
+
+    // the keys are not copied, nothing is parsed while the hash is in use
+    QHash<QByteArray, int> last;
+    last.reserve(count);
+    for(int i=0; i<count; ++i)
+    {
+        const qdropboxjson_node &n = _nodes.at(first+i);
+        last.insert(QByteArray::fromRawData(keyData(n), n.keyLength), i);
+    }
+    for(int i=0; i<count; ++i)
+    {
+        const qdropboxjson_node &n = _nodes.at(first+i);
+        shadowed[i] = last.value(QByteArray::fromRawData(keyData(n), n.keyLength)) != i;
+    }
+}
+
+bool QDropboxJsonDocument::equalChildren(int index, const QDropboxJsonDocument &other, int otherIndex) const
+{
+    // comparing the children may parse them, which moves the nodes
+    const qdropboxjson_node a          = _nodes.at(index);
+    const qdropboxjson_node b          = other._nodes.at(otherIndex);
+    const int               first      = a.value.children.first;
+    const int               count      = a.value.children.count;
+    const int               otherFirst = b.value.children.first;
+    const int               otherCount = b.value.children.count;
+
+    if(a.type == QDROPBOXJSON_TYPE_ARRAY)
+    {
+        for(int i=0; i<count; ++i)
+        {
+            if(!equals(first+i, other, otherFirst+i))
+                return false;
+        }
+        return true;
+    }
+
+    // the members are paired by their keys before anything is parsed, so the keys are not copied
+    QVarLengthArray<bool, 32> shadowed;
+    QVarLengthArray<bool, 32> otherShadowed;
+    markShadowed(first, count, shadowed);
+    other.markShadowed(otherFirst, otherCount, otherShadowed);
+
+    QHash<QByteArray, int> otherMembers;
+    otherMembers.reserve(otherCount);
+    for(int j=0; j<otherCount; ++j)
+    {
+        const qdropboxjson_node &n = other._nodes.at(otherFirst+j);
+        if(!otherShadowed[j])
+            otherMembers.insert(QByteArray::fromRawData(other.keyData(n), n.keyLength), otherFirst+j);
+    }
+
+    QVarLengthArray<int, 64> pairs;
+    for(int i=0; i<count; ++i)
+    {
+        if(shadowed[i])
+            continue;
+
+        const qdropboxjson_node &n = _nodes.at(first+i);
+        const int j = otherMembers.value(QByteArray::fromRawData(keyData(n), n.keyLength), -1);
+        if(j < 0)
+            return false;
+        pairs.append(first+i);
+        pairs.append(j);
+    }
+    if(pairs.size()/2 != otherMembers.size())
+        return false;
+
+    for(int k=0; k<pairs.size(); k+=2)
+    {
+        if(!equals(pairs[k], other, pairs[k+1]))
+            return false;
+    }
+    return true;
+}
+
+bool QDropboxJsonDocument::parseValue(int &pos, qdropboxjson_node *node) const
+{
+    const char *data  = _source.constData();
+    const int   size  = _source.size();
+    const int   start = pos;
+
+    if(pos >= size)
+        return false;
+
+    node->offset = start;
+
+    switch(data[pos])
+    {
+    case '{':
+    case '[':
+        // nested objects and arrays are only skipped, see materialize()
+        if(!QDropboxJsonScanner::skipContainer(data, size, pos))
+            return false;
+        node->type   = (data[start] == '{') ? QDROPBOXJSON_TYPE_JSON : QDROPBOXJSON_TYPE_ARRAY;
+        node->flags |= QDROPBOXJSON_NODE_LAZY;
+        node->value.children.first = 0;
+        node->value.children.count = 0;
+        break;
+    case '"':
+    {
+        bool inPool;
+        if(!parseString(pos, &node->value.string.offset, &node->value.string.length, &inPool))
+            return false;
+        node->type = QDROPBOXJSON_TYPE_STR;
+        if(inPool)
+            node->flags |= QDROPBOXJSON_NODE_STRING_POOL;
+        break;
+    }
+    default:
+        // numbers, booleans and null
+        scanLiteral(data, size, pos);
+        if(pos == start)
+            return false;
+        decodeLiteral(data+start, pos-start, node);
+        break;
+    }
+
+    node->length = pos-start;
+    return true;
+}
+
+bool QDropboxJsonDocument::parseContainer(int &pos, qdropboxjson_node *node) const
+{
+    const char *data   = _source.constData();
+    const int   size   = _source.size();
+    const bool  object = (data[pos] == '{');
+    const char  close  = object ? '}' : ']';
+
+    // nested containers are not parsed, so the children are appended contiguously
+    node->type                 = object ? QDROPBOXJSON_TYPE_JSON : QDROPBOXJSON_TYPE_ARRAY;
+    node->value.children.first = _nodes.size();
+    node->value.children.count = 0;
+
+    ++pos; // skip { or [
+    skipWhitespace(data, size, pos);
+
+    if(pos < size && data[pos] == close)
+    {
+        ++pos;
+        return true;
+    }
+
+    while(pos < size)
+    {
+        qdropboxjson_node child;
+        child.flags     = 0;
+        child.keyId     = 0;
+        child.keyOffset = 0;
+        child.keyLength = 0;
+
+        if(object)
+        {
+            bool inPool;
+            if(data[pos] != '"' || !parseString(pos, &child.keyOffset, &child.keyLength, &inPool))
+                return false;
+            if(inPool)
+                child.flags |= QDROPBOXJSON_NODE_KEY_POOL;
+            child.keyId = quint16(internKey(keyData(child), child.keyLength));
+
+            skipWhitespace(data, size, pos);
+            if(pos >= size || data[pos] != ':')
+                return false;
+            ++pos;
+            skipWhitespace(data, size, pos);
+        }
+
+        if(!parseValue(pos, &child))
+            return false;
+        _nodes.append(child);
+        ++node->value.children.count;
+
+        skipWhitespace(data, size, pos);
+        if(pos >= size)
+            return false;
+        if(data[pos] == close)
+        {
+            ++pos;
+            return true;
+        }
+        if(data[pos] != ',')
+            return false;
+        ++pos;
+        skipWhitespace(data, size, pos);
+    }
+
+    return false;
+}
+
+bool QDropboxJsonDocument::parseString(int &pos, int *offset, int *length, bool *inPool) const
+{
+    const char *data  = _source.constData();
+    const int   begin = pos+1;
+    bool        escaped;
+
+    if(!scanString(data, _source.size(), pos, &escaped))
+        return false;
+
+    // only strings with escape sequences have to be decoded into the pool
+    if(!escaped)
+    {
+        *offset = begin;
+        *length = pos-1-begin;
+        *inPool = false;
+        return true;
+    }
+
+    *offset = _pool.size();
+    unescapeString(data, begin, pos-1, _pool);
+    *length = _pool.size() - *offset;
+    *inPool = true;
+    return true;
+}
+
+int QDropboxJsonDocument::appendChild(int container, const qdropboxjson_node &child)
+{
+    const int first = _nodes.at(container).value.children.first;
+    const int count = _nodes.at(container).value.children.count;
+    int       moved = first;
+
+    // unless they are the last nodes the children are moved to the end to stay contiguous
+    if(count == 0 || first+count != _nodes.size())
+    {
+        moved = _nodes.size();
+        for(int i=0; i<count; ++i)
+            _nodes.append(_nodes.at(first+i));
+    }
+
+    _nodes.append(child);
+    _nodes[container].value.children.first = moved;
+    _nodes[container].value.children.count = count+1;
+    return _nodes.size()-1;
+}
+
+qdropboxjson_node QDropboxJsonDocument::importNode(const QDropboxJsonDocument &other, int index)
+{
+    const qdropboxjson_node &source = other._nodes.at(index);
+
+    qdropboxjson_node n = source;
+    n.flags     = 0;
+    n.keyId     = 0;
+    n.keyOffset = 0;
+    n.keyLength = 0;
+    n.offset    = -1;
+    n.length    = 0;
+
+    switch(source.type)
+    {
+    case QDROPBOXJSON_TYPE_STR:
+        n.flags               = QDROPBOXJSON_NODE_STRING_POOL;
+        n.value.string.offset = _pool.size();
+        _pool.append(other.stringData(source), source.value.string.length);
+        break;
+    case QDROPBOXJSON_TYPE_JSON:
+    case QDROPBOXJSON_TYPE_ARRAY:
+    {
+        other.materialize(index);
+        const int first = other._nodes.at(index).value.children.first;
+        const int count = other._nodes.at(index).value.children.count;
+
+        QVector<qdropboxjson_node> children;
+        children.reserve(count);
+        for(int i=first; i<first+count; ++i)
+        {
+            qdropboxjson_node child = importNode(other, i);
+            if(n.type == QDROPBOXJSON_TYPE_JSON)
+            {
+                const qdropboxjson_node &key = other._nodes.at(i);
+                child.flags    |= QDROPBOXJSON_NODE_KEY_POOL;
+                child.keyId     = key.keyId;
+                child.keyOffset = _pool.size();
+                child.keyLength = key.keyLength;
+                _pool.append(other.keyData(key), key.keyLength);
+            }
+            children.append(child);
+        }
+
+        n.value.children.first = _nodes.size();
+        n.value.children.count = count;
+        _nodes += children;
+        break;
+    }
+    default:
+        break;
+    }
+
+    return n;
+}
+
+void QDropboxJsonDocument::decodeLiteral(const char *data, int size, qdropboxjson_node *node)
+{
+    node->type = QDROPBOXJSON_TYPE_UNKNOWN;
+
+    if(size == 4 && qstrncmp(data, "true", 4) == 0)
+    {
+        node->type            = QDROPBOXJSON_TYPE_BOOL;
+        node->value.boolValue = true;
+        return;
+    }
+    if(size == 5 && qstrncmp(data, "false", 5) == 0)
+    {
+        node->type            = QDROPBOXJSON_TYPE_BOOL;
+        node->value.boolValue = false;
+        return;
+    }
+
+    // integers are accumulated directly, everything else is left to toDouble()
+    const quint64 maxInt   = quint64(std::numeric_limits<qint64>::max());
+    const bool    negative = (data[0] == '-');
+    int           pos      = negative ? 1 : 0;
+    const int     digits   = pos;
+    quint64       value    = 0;
+    bool          overflow = false;
+
+    for(; pos < size && data[pos] >= '0' && data[pos] <= '9'; ++pos)
+    {
+        uint digit = data[pos] - '0';
+        if(value > (std::numeric_limits<quint64>::max() - digit) / 10)
+            overflow = true;
+        else
+            value = value*10 + digit;
+    }
+
+    if(pos == digits)
+        return; // null or garbage
+
+    if(pos == size && !overflow)
+    {
+        if(!negative && value <= maxInt)
+        {
+            node->type           = QDROPBOXJSON_TYPE_NUM;
+            node->value.intValue = qint64(value);
+            return;
+        }
+        if(!negative)
+        {
+            node->type            = QDROPBOXJSON_TYPE_UINT;
+            node->value.uintValue = value;
+            return;
+        }
+        if(value <= maxInt+1)
+        {
+            node->type           = QDROPBOXJSON_TYPE_NUM;
+            node->value.intValue = value == 0 ? 0 : -qint64(value-1) - 1;
+            return;
+        }
+    }
+
+    // fraction, exponent or out of 64 bit range
+    bool   ok;
+    double d = QByteArray::fromRawData(data, size).toDouble(&ok);
+    if(ok)
+    {
+        node->type              = QDROPBOXJSON_TYPE_FLOAT;
+        node->value.doubleValue = d;
+    }
+}
+
+void QDropboxJsonDocument::skipWhitespace(const char *data, int size, int &pos)
+{
+    while(pos < size)
+    {
+        switch(data[pos])
+        {
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+            ++pos;
+            break;
+        default:
+            return;
+        }
+    }
+}
+
+bool QDropboxJsonDocument::scanString(const char *data, int size, int &pos, bool *escaped)
+{
+    // pos points to the opening quote
+    *escaped = false;
+    for(++pos; pos < size; ++pos)
+    {
+        if(data[pos] == '\\')
+        {
+            *escaped = true;
+            ++pos; // skip escaped character
+        }
+        else if(data[pos] == '"')
+        {
+            ++pos;
+            return true;
+        }
+    }
+    return false;
+}
+
+void QDropboxJsonDocument::scanLiteral(const char *data, int size, int &pos)
+{
+    while(pos < size)
+    {
+        switch(data[pos])
+        {
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+        case ',':
+        case ':':
+        case '}':
+        case ']':
+            return;
+        default:
+            ++pos;
+            break;
+        }
+    }
+}
+
+void QDropboxJsonDocument::unescapeString(const char *data, int begin, int end, QByteArray &out)
+{
+    for(int i=begin; i < end; ++i)
+    {
+        if(data[i] != '\\')
+        {
+            out += data[i];
+            continue;
+        }
+
+        if(++i >= end)
+            break;
+
+        switch(data[i])
+        {
+        case 'b':
+            out += '\b';
+            break;
+        case 'f':
+            out += '\f';
+            break;
+        case 'n':
+            out += '\n';
+            break;
+        case 'r':
+            out += '\r';
+            break;
+        case 't':
+            out += '\t';
+            break;
+        case 'u':
+        {
+            uint code;
+            if(!decodeHex(data+i+1, end-i-1, &code))
+            {
+                out += 'u';
+                break;
+            }
+            i += 4;
+
+            // a high surrogate followed by an escaped low surrogate is one code point
+            uint low;
+            if(code >= 0xD800 && code <= 0xDBFF &&
+               i+2 < end && data[i+1] == '\\' && data[i+2] == 'u' &&
+               decodeHex(data+i+3, end-i-3, &low) && low >= 0xDC00 && low <= 0xDFFF)
+            {
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                i += 6;
+            }
+            appendUtf8(out, code);
+            break;
+        }
+        default:
+            // \" \\ \/ and unknown escapes stand for the character itself
+            out += data[i];
+            break;
+        }
+    }
+}
+
+bool QDropboxJsonDocument::decodeHex(const char *data, int size, uint *code)
+{
+    if(size < 4)
+        return false;
+
+    *code = 0;
+    for(int i=0; i<4; ++i)
+    {
+        char c = data[i];
+        if(c >= '0' && c <= '9')
+            *code = *code*16 + (c-'0');
+        else if(c >= 'a' && c <= 'f')
+            *code = *code*16 + (c-'a'+10);
+        else if(c >= 'A' && c <= 'F')
+            *code = *code*16 + (c-'A'+10);
+        else
+            return false;
+    }
+    return true;
+}
+
+void QDropboxJsonDocument::appendUtf8(QByteArray &buffer, uint code)
+{
+    // unpaired surrogates can not be represented in UTF-8
+    if(code >= 0xD800 && code <= 0xDFFF)
+        code = 0xFFFD;
+
+    if(code < 0x80)
+    {
+        buffer += char(code);
+    }
+    else if(code < 0x800)
+    {
+        buffer += char(0xC0 | (code >> 6));
+        buffer += char(0x80 | (code & 0x3F));
+    }
+    else if(code < 0x10000)
+    {
+        buffer += char(0xE0 | (code >> 12));
+        buffer += char(0x80 | ((code >> 6) & 0x3F));
+        buffer += char(0x80 | (code & 0x3F));
+    }
+    else
+    {
+        buffer += char(0xF0 | (code >> 18));
+        buffer += char(0x80 | ((code >> 12) & 0x3F));
+        buffer += char(0x80 | ((code >> 6) & 0x3F));
+        buffer += char(0x80 | (code & 0x3F));
+    }
+}
@@ -0,0 +1,313 @@
+#ifndef QDROPBOXJSONDOCUMENT_H
+#define QDROPBOXJSONDOCUMENT_H
+
+#include "qtdropbox_global.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QVarLengthArray>
+#include <QSharedData>
+#include <QSharedPointer>
+
+#ifdef QTDROPBOX_DEBUG
+#include <QDebug>
+#endif
+
+class QFile;
+
+typedef char qdropboxjson_entry_type;
+
+const qdropboxjson_entry_type QDROPBOXJSON_TYPE_NUM     = 'N';
+const qdropboxjson_entry_type QDROPBOXJSON_TYPE_STR     = 'S';
+const qdropboxjson_entry_type QDROPBOXJSON_TYPE_JSON    = 'J';
+const qdropboxjson_entry_type QDROPBOXJSON_TYPE_ARRAY   = 'A';
+const qdropboxjson_entry_type QDROPBOXJSON_TYPE_FLOAT   = 'F';
+const qdropboxjson_entry_type QDROPBOXJSON_TYPE_BOOL    = 'B';
+const qdropboxjson_entry_type QDROPBOXJSON_TYPE_UINT    = 'U';
+const qdropboxjson_entry_type QDROPBOXJSON_TYPE_UNKNOWN = '?';
+
+//! Length of a timestamp written by QDropboxJsonDocument::formatTimestamp()
+const int QDROPBOXJSON_TIMESTAMP_LENGTH = 31;
+
+//! The key of the node is stored in the pool of the document instead of the source
+const quint8 QDROPBOXJSON_NODE_KEY_POOL    = 0x01;
+//! The string value of the node is stored in the pool of the document instead of the source
+const quint8 QDROPBOXJSON_NODE_STRING_POOL = 0x02;
+//! The object or array has not been parsed yet, only its span in the source is known
+const quint8 QDROPBOXJSON_NODE_LAZY        = 0x04;
+//! Parsing the object or array failed when it was accessed
+const quint8 QDROPBOXJSON_NODE_INVALID     = 0x08;
+
+//! Keeps the decoded value of a JSON node
+/*!
+  Numbers and booleans are decoded once while parsing and stored inline. Strings refer
+  to decoded UTF-8 data, objects and arrays to a contiguous range of child nodes.
+ */
+union qdropboxjson_value{
+    qint64  intValue;    //!< Value of QDROPBOXJSON_TYPE_NUM
+    quint64 uintValue;   //!< Value of QDROPBOXJSON_TYPE_UINT
+    double  doubleValue; //!< Value of QDROPBOXJSON_TYPE_FLOAT
+    bool    boolValue;   //!< Value of QDROPBOXJSON_TYPE_BOOL
+    struct {
+        int offset;      //!< Start of the decoded string in source or pool
+        int length;      //!< Length of the decoded string
+    } string;            //!< Value of QDROPBOXJSON_TYPE_STR
+    struct {
+        int first;       //!< Index of the first child node
+        int count;       //!< Number of child nodes
+    } children;          //!< Value of QDROPBOXJSON_TYPE_JSON and QDROPBOXJSON_TYPE_ARRAY
+};
+
+//! A single value of a JSON document
+struct qdropboxjson_node{
+    qdropboxjson_entry_type type;      //!< Datatype of value
+    quint8                  flags;     //!< Storage flags (QDROPBOXJSON_NODE_*)
+    quint16                 keyId;     //!< Interned key (see QDropboxJsonDocument::internKey()), 0 if unknown
+    int                     keyOffset; //!< Start of the decoded key in source or pool
+    int                     keyLength; //!< Length of the decoded key, 0 for array elements
+    int                     offset;    //!< Start of the value in the source buffer, -1 if set by a setter
+    int                     length;    //!< Length of the value in the source buffer
+    qdropboxjson_value      value;     //!< The decoded value
+};
+
+//! Storage of a parsed JSON shared by QDropboxJson instances
+/*!
+  A QDropboxJsonDocument keeps a whole JSON in three buffers: the (implicitly shared) source
+  text, one vector of nodes and a byte pool for decoded keys and strings that can not be
+  referenced in the source (e.g. because they contain escape sequences or were set by a setter).
+  The children of an object or array are stored next to each other in the node vector, node 0
+  is the root of the document. Tearing down a document of any size frees only these buffers.
+
+  Only the root is parsed by parse(). Nested objects and arrays are skipped over and kept as
+  span of the source until they are accessed, then they are parsed once (see materialize()).
+  Reading a few values of a large directory listing therefore never touches its contents.
+
+  The keys used by the Dropbox API (e.g. "path" or "modified") are interned: their id is
+  stored in the node while parsing, so looking them up compares integers instead of strings.
+  Other keys are compared byte by byte as before.
+
+  Every object and array has a structural hash that is computed once per node (see hash()).
+  Values with different hashes are unequal without looking at them again, equal hashes are
+  confirmed child by child, because the hashed strings (e.g. file names in shared folders)
+  may be chosen to collide.
+
+  Because of this, reading a document may modify it. A document that is read by several
+  threads at the same time has to be frozen first (see freeze()): all of it is parsed and
+  hashed once, afterwards the const functions do not write to it anymore.
+
+  The buffers can be saved and loaded as they are (see QDropboxJsonSnapshot). A loaded document
+  refers to the snapshot (which may be a mapped file) instead of copying it.
+
+  \warning internal use only, see QDropboxJson
+ */
+class QTDROPBOXSHARED_EXPORT QDropboxJsonDocument : public QSharedData
+{
+public:
+    /*!
+      Creates a document containing an empty object.
+     */
+    QDropboxJsonDocument();
+
+    /*!
+      Copies another document. All buffers are implicitly shared until either
+      document is modified.
+     */
+    QDropboxJsonDocument(const QDropboxJsonDocument &other);
+
+    /*!
+      Parses UTF-8 encoded JSON data. Returns false and leaves an empty object if the data
+      is not a valid JSON object or array.
+     */
+    bool parse(const QByteArray &json);
+
+    /*!
+      Drops all data, the root becomes an empty object.
+     */
+    void clear();
+
+    /*!
+      Returns the node at the given index. The children of an object or array are only
+      valid after materialize() was called for it.
+     */
+    const qdropboxjson_node &node(int index) const;
+
+    /*!
+      Parses an object or array that was skipped so far. This is done only once, the result
+      is kept in the document. Returns false if the object or array is not valid.
+     */
+    bool materialize(int index) const;
+
+    /*!
+      Returns the index of the value mapped to the key inside of the given object
+      or -1 if the key does not exist. If a key is duplicated the last value wins.
+     */
+    int findChild(int object, const QByteArray &key) const;
+
+    /*!
+      Same as findChild() above, known keys are not converted to UTF-8.
+     */
+    int findChild(int object, const QString &key) const;
+
+    /*!
+      Returns the key of a node as UTF-8.
+     */
+    QByteArray key(int index) const;
+
+    /*!
+      Returns the decoded value of a string node.
+     */
+    QString string(int index) const;
+
+    /*!
+      Returns the value of a node as qint64. Unsigned values are returned if they fit.
+      Other types are only converted if force is set, otherwise 0 is returned.
+     */
+    qint64 toInt(int index, bool force) const;
+
+    /*!
+      Returns the value of a node as quint64. Non-negative signed values are returned as well.
+      Other types are only converted if force is set, otherwise 0 is returned.
+     */
+    quint64 toUInt(int index, bool force) const;
+
+    /*!
+      Returns the value of a node as double. Integers are converted as well. Other types
+      are only converted if force is set, otherwise 0.0 is returned.
+     */
+    double toDouble(int index, bool force) const;
+
+    /*!
+      Returns the value of a boolean node. Other types are only converted if force is
+      set, otherwise false is returned.
+     */
+    bool toBool(int index, bool force) const;
+
+    /*!
+      Returns the decoded value of a string node. Other types are returned in JSON
+      representation if force is set, otherwise an empty string is returned.
+     */
+    QString toString(int index, bool force) const;
+
+    /*!
+      Returns the value of a string node holding a timestamp like "Sat, 21 Aug 2010 22:31:20 +0000"
+      in milliseconds since the epoch. Returns false if the node is not a valid timestamp.
+     */
+    bool toTimestamp(int index, qint64 *msecs) const;
+
+    /*!
+      Returns the value of a node in compact JSON representation (see QDropboxJsonWriter).
+     */
+    QByteArray text(int index) const;
+
+    /*!
+      Maps a value (not a string, object or array) to the key in the given object. An
+      existing value is replaced. Returns the index of the new node.
+     */
+    int setValue(int object, const QByteArray &key, const qdropboxjson_node &value);
+
+    /*!
+      Maps a string in UTF-8 to the key in the given object.
+     */
+    int setString(int object, const QByteArray &key, const QByteArray &value);
+
+    /*!
+      Maps a copy of a node of another document (or this document) to the key in the given object.
+     */
+    int setNode(int object, const QByteArray &key, const QDropboxJsonDocument &other, int index);
+
+    /*!
+      Creates a document whose root is an array of count nodes starting at first (e.g. a range
+      of the elements of an array). Only the source is shared with this document, so the new
+      document can be used by another thread. Unparsed elements stay unparsed.
+     */
+    QDropboxJsonDocument *copyRange(int first, int count) const;
+
+    /*!
+      Compares the value of a node with the value of a node in another document. Objects and
+      arrays with different hashes (see hash()) are unequal, otherwise their children are
+      compared.
+     */
+    bool equals(int index, const QDropboxJsonDocument &other, int otherIndex) const;
+
+    /*!
+      Returns a 64-bit hash of the value of a node. Equal values have equal hashes, the order
+      of the keys of an object does not matter. Of duplicated keys only the last one is
+      hashed, like findChild() only finds the last one. The hash of an object or array is
+      computed once (parsing it if necessary) and kept until the document is modified.
+     */
+    quint64 hash(int index) const;
+
+    /*!
+      Parses all objects and arrays that were skipped so far and computes their hashes.
+      Afterwards the const functions do not modify the document, so it may be read by
+      several threads at the same time. Modifying the document ends this state.
+     */
+    void freeze() const;
+
+    /*!
+      Returns true if the document was frozen and not modified since.
+     */
+    bool isFrozen() const;
+
+    /*!
+      Returns the id of a key used by the Dropbox API or 0 if the key is not known.
+      The ids are the same in all documents.
+     */
+    static int internKey(const char *key, int length);
+
+    /*!
+      Same as internKey() above for a key in UTF-16.
+     */
+    static int internKey(const QChar *key, int length);
+
+    /*!
+      Parses a date and time in the format of RFC 2822 (e.g. "Sat, 21 Aug 2010 22:31:20 +0000")
+      into milliseconds since the epoch. The day of the week is optional. Returns false if the
+      data is not a valid date and time.
+     */
+    static bool parseTimestamp(const char *data, int size, qint64 *msecs);
+
+    /*!
+      Writes milliseconds since the epoch in the format of RFC 2822 in UTC. out needs space for
+      QDROPBOXJSON_TIMESTAMP_LENGTH characters. Returns the length written or 0 if the year
+      is not in the range of 0 to 9999.
+     */
+    static int formatTimestamp(qint64 msecs, char *out);
+
+private:
+    QByteArray                         _source;
+    mutable QByteArray                 _pool;
+    mutable QVector<qdropboxjson_node> _nodes;
+    mutable QVector<quint64>           _hashes;
+    bool                               _modified;
+    mutable bool                       _frozen;
+    QByteArray                         _snapshot; //!< Snapshot the source and the pool refer to
+    QSharedPointer<QFile>              _mapping;  //!< File the snapshot is mapped from
+
+    const char *keyData(const qdropboxjson_node &node) const;
+    const char *stringData(const qdropboxjson_node &node) const;
+    int findChild(int object, int keyId, const char *key, int length) const;
+    void markShadowed(int first, int count, QVarLengthArray<bool, 32> &shadowed) const;
+    bool equalChildren(int index, const QDropboxJsonDocument &other, int otherIndex) const;
+
+    bool parseValue(int &pos, qdropboxjson_node *node) const;
+    bool parseContainer(int &pos, qdropboxjson_node *node) const;
+    bool parseString(int &pos, int *offset, int *length, bool *inPool) const;
+    int  appendChild(int container, const qdropboxjson_node &child);
+    qdropboxjson_node importNode(const QDropboxJsonDocument &other, int index);
+
+    static void decodeLiteral(const char *data, int size, qdropboxjson_node *node);
+    static void skipWhitespace(const char *data, int size, int &pos);
+    static bool scanString(const char *data, int size, int &pos, bool *escaped);
+    static void scanLiteral(const char *data, int size, int &pos);
+    static void unescapeString(const char *data, int begin, int end, QByteArray &out);
+    static bool decodeHex(const char *data, int size, uint *code);
+    static void appendUtf8(QByteArray &buffer, uint code);
+
+    friend class QDropboxJsonWriter;
+    friend class QDropboxJsonPath;
+    friend class QDropboxJsonSnapshot;
+};
+
+#endif // QDROPBOXJSONDOCUMENT_H
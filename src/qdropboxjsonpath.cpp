@@ -0,0 +1,180 @@
+#include "qdropboxjsonpath.h"
+
+QDropboxJsonPath::QDropboxJsonPath() :
+    _valid(true)
+{
+}
+
+QDropboxJsonPath::QDropboxJsonPath(const QString &path) :
+    _path(path)
+{
+    _valid = compile();
+    if(!_valid)
+        _steps.clear();
+}
+
+bool QDropboxJsonPath::isValid() const
+{
+    return _valid;
+}
+
+QString QDropboxJsonPath::path() const
+{
+    return _path;
+}
+
+QDropboxJsonValue QDropboxJsonPath::value(const QDropboxJson &json) const
+{
+    if(!_valid || !json.valid)
+        return QDropboxJsonValue();
+
+    const int node = evaluate(json._doc, json._node, 0, NULL);
+    if(node < 0)
+        return QDropboxJsonValue();
+
+    return QDropboxJsonValue(json._doc, node);
+}
+
+QDropboxJsonValue QDropboxJsonPath::value(const QDropboxJsonValue &root) const
+{
+    if(!_valid || !root.isValid())
+        return QDropboxJsonValue();
+
+    const int node = evaluate(root._doc, root._node, 0, NULL);
+    if(node < 0)
+        return QDropboxJsonValue();
+
+    return QDropboxJsonValue(root._doc, node);
+}
+
+QList<QDropboxJsonValue> QDropboxJsonPath::values(const QDropboxJson &json) const
+{
+    QList<QDropboxJsonValue> list;
+    if(_valid && json.valid)
+        evaluate(json._doc, json._node, 0, &list);
+    return list;
+}
+
+QList<QDropboxJsonValue> QDropboxJsonPath::values(const QDropboxJsonValue &root) const
+{
+    QList<QDropboxJsonValue> list;
+    if(_valid && root.isValid())
+        evaluate(root._doc, root._node, 0, &list);
+    return list;
+}
+
+bool QDropboxJsonPath::compile()
+{
+    const QChar *data = _path.constData();
+    const int    size = _path.size();
+    int          pos  = 0;
+
+    while(pos < size)
+    {
+        qdropboxjson_path_step step;
+        step.keyId = 0;
+
+        if(data[pos] == QChar('['))
+        {
+            // [*] or a non-negative index
+            int end = pos + 1;
+            while(end < size && data[end] != QChar(']'))
+                ++end;
+            if(end >= size || end == pos + 1)
+                return false;
+
+            if(end == pos + 2 && data[pos+1] == QChar('*'))
+                step.index = QDROPBOXJSON_PATH_ALL;
+            else
+            {
+                qint64 index = 0;
+                for(int i = pos + 1; i < end; ++i)
+                {
+                    const ushort c = data[i].unicode();
+                    if(c < '0' || c > '9')
+                        return false;
+                    index = index*10 + (c - '0');
+                    if(index > 0x7FFFFFFF)
+                        return false;
+                }
+                step.index = int(index);
+            }
+            pos = end + 1;
+        }
+        else
+        {
+            // every key but the first one follows a dot
+            if(!_steps.isEmpty())
+            {
+                if(data[pos] != QChar('.'))
+                    return false;
+                ++pos;
+            }
+
+            int end = pos;
+            while(end < size && data[end] != QChar('.') && data[end] != QChar('['))
+                ++end;
+            if(end == pos)
+                return false;
+
+            step.index = QDROPBOXJSON_PATH_KEY;
+            step.keyId = QDropboxJsonDocument::internKey(data + pos, end - pos);
+            if(step.keyId == 0)
+                step.key = _path.mid(pos, end - pos).toUtf8();
+            pos = end;
+        }
+
+        _steps.append(step);
+    }
+
+#ifdef QTDROPBOX_DEBUG
+    qDebug() << "json path " << _path << " compiled to " << _steps.size() << " steps" << endl;
+#endif
+    return true;
+}
+
+int QDropboxJsonPath::evaluate(const QExplicitlySharedDataPointer<QDropboxJsonDocument> &doc, int node, int step,
+                               QList<QDropboxJsonValue> *values) const
+{
+    for(; step < _steps.size(); ++step)
+    {
+        const qdropboxjson_path_step &s = _steps.at(step);
+        if(s.index == QDROPBOXJSON_PATH_KEY)
+        {
+            node = doc->findChild(node, s.keyId, s.key.constData(), s.key.size());
+            if(node < 0)
+                return -1;
+            continue;
+        }
+
+        if(doc->node(node).type != QDROPBOXJSON_TYPE_ARRAY || !doc->materialize(node))
+            return -1;
+
+        // the node may be moved while the elements are evaluated
+        const int first = doc->node(node).value.children.first;
+        const int count = doc->node(node).value.children.count;
+        if(s.index != QDROPBOXJSON_PATH_ALL)
+        {
+            if(s.index >= count)
+                return -1;
+            node = first + s.index;
+            continue;
+        }
+
+        // without a list the first match is enough
+        int match = -1;
+        for(int i = 0; i < count; ++i)
+        {
+            const int found = evaluate(doc, first + i, step + 1, values);
+            if(found >= 0 && match < 0)
+                match = found;
+            if(match >= 0 && values == NULL)
+                break;
+        }
+        return match;
+    }
+
+    if(values != NULL)
+        values->append(QDropboxJsonValue(doc, node));
+    return node;
+}
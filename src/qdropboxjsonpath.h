@@ -0,0 +1,110 @@
+#ifndef QDROPBOXJSONPATH_H
+#define QDROPBOXJSONPATH_H
+
+#include "qtdropbox_global.h"
+#include "qdropboxjsondocument.h"
+#include "qdropboxjson.h"
+#include "qdropboxjsonarray.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QList>
+
+#ifdef QTDROPBOX_DEBUG
+#include <QDebug>
+#endif
+
+//! Index of a step that selects every element of an array
+const int QDROPBOXJSON_PATH_ALL = -1;
+//! Index of a step that selects a key of an object
+const int QDROPBOXJSON_PATH_KEY = -2;
+
+//! A single step of a compiled QDropboxJsonPath
+struct qdropboxjson_path_step{
+    int        index; //!< Index of the array element, QDROPBOXJSON_PATH_ALL or QDROPBOXJSON_PATH_KEY
+    int        keyId; //!< Interned key (see QDropboxJsonDocument::internKey()), 0 if unknown
+    QByteArray key;   //!< Key in UTF-8, only compared if the key is not interned
+};
+
+//! A path to a nested value of a JSON that is compiled once
+/*!
+  QDropboxJsonPath selects a value inside of a QDropboxJson by a path expression. The path
+  is split into steps when the QDropboxJsonPath is created and the keys are interned once
+  (see QDropboxJsonDocument::internKey()), so evaluating the same path against many JSONs or
+  against every element of a large array neither converts nor hashes any string.
+
+  A path consists of keys separated by dots and array indices in square brackets. The index
+  * selects every element of an array. Keys must not contain dots or square brackets.
+
+  \code
+  QDropboxJsonPath shared("quota_info.shared");
+  quint64 bytes = shared.value(account).toUInt();
+
+  QDropboxJsonPath revs("contents[*].rev");
+  QList<QDropboxJsonValue> list = revs.values(metadata);
+
+  QDropboxJsonPath rev("rev");
+  QDropboxJsonArray contents = metadata.getJsonArray("contents");
+  for(QDropboxJsonArray::const_iterator it = contents.begin(); it != contents.end(); ++it)
+      qDebug() << rev.value(*it).toString();
+  \endcode
+ */
+class QTDROPBOXSHARED_EXPORT QDropboxJsonPath
+{
+public:
+    /*!
+      Creates an empty path that selects the JSON itself.
+     */
+    QDropboxJsonPath();
+
+    /*!
+      Compiles a path expression like "contents[0].rev". If the expression is malformed the
+      path is invalid and never selects a value.
+
+      \param path The path expression.
+     */
+    explicit QDropboxJsonPath(const QString &path);
+
+    /*!
+      Returns false if the path expression could not be compiled.
+     */
+    bool isValid() const;
+
+    /*!
+      Returns the path expression.
+     */
+    QString path() const;
+
+    /*!
+      Returns the value selected by the path. If the path selects several values (by using
+      [*]) the first one is returned. The value is invalid if the path does not match.
+     */
+    QDropboxJsonValue value(const QDropboxJson &json) const;
+
+    /*!
+      Same as value() above, the path is evaluated relative to an element of an array.
+     */
+    QDropboxJsonValue value(const QDropboxJsonValue &root) const;
+
+    /*!
+      Returns all values selected by the path in the order of the document.
+     */
+    QList<QDropboxJsonValue> values(const QDropboxJson &json) const;
+
+    /*!
+      Same as values() above, the path is evaluated relative to an element of an array.
+     */
+    QList<QDropboxJsonValue> values(const QDropboxJsonValue &root) const;
+
+private:
+    QString                         _path;
+    QVector<qdropboxjson_path_step> _steps;
+    bool                            _valid;
+
+    bool compile();
+    int  evaluate(const QExplicitlySharedDataPointer<QDropboxJsonDocument> &doc, int node, int step,
+                  QList<QDropboxJsonValue> *values) const;
+};
+
+#endif // QDROPBOXJSONPATH_H
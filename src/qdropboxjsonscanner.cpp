@@ -0,0 +1,298 @@
+#include "qdropboxjsonscanner.h"
+
+#include <QAtomicPointer>
+#include <QtAlgorithms>
+
+#include <cstring>
+
+#if QT_VERSION < QT_VERSION_CHECK(5, 5, 0)
+// the bit counting functions of QtAlgorithms were added in Qt 5.5
+static inline uint qPopulationCount(quint64 v)
+{
+    v = v - ((v >> 1) & Q_UINT64_C(0x5555555555555555));
+    v = (v & Q_UINT64_C(0x3333333333333333)) + ((v >> 2) & Q_UINT64_C(0x3333333333333333));
+    v = (v + (v >> 4)) & Q_UINT64_C(0x0F0F0F0F0F0F0F0F);
+    return uint((v * Q_UINT64_C(0x0101010101010101)) >> 56);
+}
+
+static inline uint qCountTrailingZeroBits(quint64 v)
+{
+    return v == 0 ? 64 : qPopulationCount((v & (0 - v)) - 1);
+}
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define QDROPBOXJSON_SCANNER_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 code is compiled for single functions, so the library still runs on older CPUs
+#if defined(QDROPBOXJSON_SCANNER_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define QDROPBOXJSON_SCANNER_AVX2
+#include <immintrin.h>
+#endif
+
+//! Positions of the characters of interest in a block of 64 bytes, bit i refers to byte i
+struct qdropboxjson_block_masks{
+    quint64 quote;     //!< '"'
+    quint64 backslash; //!< '\\'
+    quint64 open;      //!< '{' and '['
+    quint64 close;     //!< '}' and ']'
+};
+
+typedef void (*qdropboxjson_mask_function)(const char *block, qdropboxjson_block_masks *masks);
+
+static bool skipContainerScalar(const char *data, int size, int &pos)
+{
+    int depth = 0;
+    for(; pos < size; ++pos)
+    {
+        switch(data[pos])
+        {
+        case '"':
+            // skip the string, escaped characters included
+            for(++pos; pos < size && data[pos] != '"'; ++pos)
+            {
+                if(data[pos] == '\\')
+                    ++pos;
+            }
+            if(pos >= size)
+                return false;
+            break;
+        case '{':
+        case '[':
+            ++depth;
+            break;
+        case '}':
+        case ']':
+            if(--depth == 0)
+            {
+                ++pos;
+                return true;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
+static bool skipContainerBlocks(const char *data, int size, int &pos, qdropboxjson_mask_function findMasks)
+{
+    quint64 escapedCarry = 0; // the first byte of the next block is escaped
+    quint64 stringCarry  = 0; // the next block starts inside of a string (all bits set)
+    int     depth        = 0;
+    char    tail[64];
+
+    for(int block = pos; block < size; block += 64)
+    {
+        // the last block is padded with whitespace
+        const char *p = data + block;
+        if(size - block < 64)
+        {
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, p, size - block);
+            p = tail;
+        }
+
+        qdropboxjson_block_masks masks;
+        findMasks(p, &masks);
+
+        // a backslash escapes the next byte unless it is escaped itself (rare, so done bit by bit)
+        quint64 escaped = escapedCarry;
+        escapedCarry = 0;
+        for(quint64 b = masks.backslash; b != 0; b &= b - 1)
+        {
+            const quint64 bit = b & (0 - b);
+            if(escaped & bit)
+                continue;
+            if(bit == (Q_UINT64_C(1) << 63))
+                escapedCarry = 1;
+            else
+                escaped |= bit << 1;
+        }
+
+        // every unescaped quote toggles between outside and inside of a string
+        quint64 strings = masks.quote & ~escaped;
+        strings ^= strings << 1;
+        strings ^= strings << 2;
+        strings ^= strings << 4;
+        strings ^= strings << 8;
+        strings ^= strings << 16;
+        strings ^= strings << 32;
+        strings ^= stringCarry;
+        stringCarry = 0 - (strings >> 63);
+
+        const quint64 open  = masks.open & ~strings;
+        const quint64 close = masks.close & ~strings;
+
+        // the container can not end in this block if there are not enough closing brackets
+        const int closeCount = int(qPopulationCount(close));
+        if(depth > closeCount)
+        {
+            depth += int(qPopulationCount(open)) - closeCount;
+            continue;
+        }
+
+        for(quint64 s = open | close; s != 0; s &= s - 1)
+        {
+            const quint64 bit = s & (0 - s);
+            if(open & bit)
+                ++depth;
+            else if(--depth == 0)
+            {
+                pos = block + int(qCountTrailingZeroBits(bit)) + 1;
+                return true;
+            }
+        }
+    }
+
+    pos = size;
+    return false;
+}
+
+#ifdef QDROPBOXJSON_SCANNER_SSE2
+static void findMasksSse2(const char *block, qdropboxjson_block_masks *masks)
+{
+    // setting bit 5 maps '[' to '{' and ']' to '}' and no other character to either
+    const __m128i quote     = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i open      = _mm_set1_epi8('{');
+    const __m128i close     = _mm_set1_epi8('}');
+    const __m128i lower     = _mm_set1_epi8(0x20);
+
+    masks->quote = masks->backslash = masks->open = masks->close = 0;
+    for(int i = 0; i < 4; ++i)
+    {
+        const __m128i chunk    = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 16*i));
+        const __m128i brackets = _mm_or_si128(chunk, lower);
+        masks->quote     |= quint64(quint16(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote))))        << (16*i);
+        masks->backslash |= quint64(quint16(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, backslash))))    << (16*i);
+        masks->open      |= quint64(quint16(_mm_movemask_epi8(_mm_cmpeq_epi8(brackets, open))))      << (16*i);
+        masks->close     |= quint64(quint16(_mm_movemask_epi8(_mm_cmpeq_epi8(brackets, close))))     << (16*i);
+    }
+}
+
+static bool skipContainerSse2(const char *data, int size, int &pos)
+{
+    return skipContainerBlocks(data, size, pos, findMasksSse2);
+}
+#endif
+
+#ifdef QDROPBOXJSON_SCANNER_AVX2
+__attribute__((target("avx2")))
+static void findMasksAvx2(const char *block, qdropboxjson_block_masks *masks)
+{
+    const __m256i quote     = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i open      = _mm256_set1_epi8('{');
+    const __m256i close     = _mm256_set1_epi8('}');
+    const __m256i lower     = _mm256_set1_epi8(0x20);
+
+    masks->quote = masks->backslash = masks->open = masks->close = 0;
+    for(int i = 0; i < 2; ++i)
+    {
+        const __m256i chunk    = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + 32*i));
+        const __m256i brackets = _mm256_or_si256(chunk, lower);
+        masks->quote     |= quint64(quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, quote))))     << (32*i);
+        masks->backslash |= quint64(quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, backslash)))) << (32*i);
+        masks->open      |= quint64(quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(brackets, open))))   << (32*i);
+        masks->close     |= quint64(quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(brackets, close))))  << (32*i);
+    }
+}
+
+static bool skipContainerAvx2(const char *data, int size, int &pos)
+{
+    return skipContainerBlocks(data, size, pos, findMasksAvx2);
+}
+#endif
+
+//! One implementation of QDropboxJsonScanner
+struct qdropboxjson_scanner_functions{
+    bool (*skipContainer)(const char *data, int size, int &pos);
+    QDropboxJsonScanner::Implementation implementation;
+};
+
+static const qdropboxjson_scanner_functions scalarFunctions = {
+    skipContainerScalar, QDropboxJsonScanner::Scalar
+};
+#ifdef QDROPBOXJSON_SCANNER_SSE2
+static const qdropboxjson_scanner_functions sse2Functions = {
+    skipContainerSse2, QDropboxJsonScanner::SSE2
+};
+#endif
+#ifdef QDROPBOXJSON_SCANNER_AVX2
+static const qdropboxjson_scanner_functions avx2Functions = {
+    skipContainerAvx2, QDropboxJsonScanner::AVX2
+};
+#endif
+
+static QAtomicPointer<const qdropboxjson_scanner_functions> currentFunctions;
+
+static const qdropboxjson_scanner_functions *functionsFor(QDropboxJsonScanner::Implementation implementation)
+{
+    switch(implementation)
+    {
+#ifdef QDROPBOXJSON_SCANNER_AVX2
+    case QDropboxJsonScanner::AVX2:
+        if(__builtin_cpu_supports("avx2"))
+            return &avx2Functions;
+        break;
+#endif
+#ifdef QDROPBOXJSON_SCANNER_SSE2
+    case QDropboxJsonScanner::SSE2:
+        return &sse2Functions;
+#endif
+    case QDropboxJsonScanner::Scalar:
+        return &scalarFunctions;
+    default:
+        break;
+    }
+    return NULL;
+}
+
+static const qdropboxjson_scanner_functions *functions()
+{
+    const qdropboxjson_scanner_functions *f = currentFunctions.load();
+    if(f == NULL)
+    {
+        // the CPU is checked once, concurrent callers store the same result
+        f = functionsFor(QDropboxJsonScanner::bestImplementation());
+        currentFunctions.store(f);
+    }
+    return f;
+}
+
+bool QDropboxJsonScanner::skipContainer(const char *data, int size, int &pos)
+{
+    // small containers are not worth the setup of the masks
+    if(size - pos < 64)
+        return skipContainerScalar(data, size, pos);
+
+    return functions()->skipContainer(data, size, pos);
+}
+
+QDropboxJsonScanner::Implementation QDropboxJsonScanner::implementation()
+{
+    return functions()->implementation;
+}
+
+bool QDropboxJsonScanner::setImplementation(Implementation implementation)
+{
+    const qdropboxjson_scanner_functions *f = functionsFor(implementation);
+    if(f == NULL)
+        return false;
+
+    currentFunctions.store(f);
+    return true;
+}
+
+QDropboxJsonScanner::Implementation QDropboxJsonScanner::bestImplementation()
+{
+    if(functionsFor(AVX2) != NULL)
+        return AVX2;
+    if(functionsFor(SSE2) != NULL)
+        return SSE2;
+    return Scalar;
+}
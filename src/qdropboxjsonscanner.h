@@ -0,0 +1,51 @@
+#ifndef QDROPBOXJSONSCANNER_H
+#define QDROPBOXJSONSCANNER_H
+
+#include "qtdropbox_global.h"
+
+//! Finds the structure of a JSON in blocks of 64 bytes
+/*!
+  QDropboxJsonScanner is the first stage of the JSON parser. Objects and arrays that are not
+  parsed yet (see QDropboxJsonDocument) are skipped by looking at 64 bytes at once: quotes,
+  backslashes and brackets are found by SSE2 or AVX2 compares and turned into bit masks. The
+  masks are combined to a mask of the characters inside of strings, so only brackets outside
+  of strings are counted and the parser jumps from one of them to the next without branching
+  on every byte. The implementation is chosen at runtime depending on the features of the
+  CPU, the scalar implementation is used on other platforms.
+
+  \warning internal use only
+ */
+class QTDROPBOXSHARED_EXPORT QDropboxJsonScanner
+{
+public:
+    //! Available implementations
+    enum Implementation{
+        Scalar, //!< Byte by byte, available everywhere
+        SSE2,   //!< 16 bytes at a time
+        AVX2    //!< 32 bytes at a time
+    };
+
+    /*!
+      Skips an object or array. pos has to point to the opening bracket, it points behind
+      the closing bracket afterwards. Returns false if the end of the data is reached first.
+     */
+    static bool skipContainer(const char *data, int size, int &pos);
+
+    /*!
+      Returns the implementation that is currently used.
+     */
+    static Implementation implementation();
+
+    /*!
+      Selects an implementation (e.g. for comparisons). Returns false if it is not
+      supported by the CPU or the compiler.
+     */
+    static bool setImplementation(Implementation implementation);
+
+    /*!
+      Returns the fastest implementation supported by the CPU.
+     */
+    static Implementation bestImplementation();
+};
+
+#endif // QDROPBOXJSONSCANNER_H
@@ -0,0 +1,288 @@
+#include "qdropboxjsonsnapshot.h"
+
+#include <QBitArray>
+#include <QVector>
+
+#include <cstring>
+
+static const char    snapshotMagic[4]  = { 'Q', 'D', 'J', 'S' };
+static const quint32 snapshotByteOrder = 0x01020304;
+
+//! Ranges read from a snapshot have to lie inside of their buffer
+static bool inRange(qint64 offset, qint64 length, int size)
+{
+    return offset >= 0 && length >= 0 && offset + length <= size;
+}
+
+//! Returns a copy of a node without padding and unused bytes of the value
+static qdropboxjson_node cleanNode(const qdropboxjson_node &n)
+{
+    // the bytes of the node are written as they are, so nothing uninitialized may be left
+    qdropboxjson_node clean;
+    memset(&clean, 0, sizeof(clean));
+    clean.type      = n.type;
+    clean.flags     = n.flags;
+    clean.keyId     = n.keyId;
+    clean.keyOffset = n.keyOffset;
+    clean.keyLength = n.keyLength;
+    clean.offset    = n.offset;
+    clean.length    = n.length;
+
+    switch(n.type)
+    {
+    case QDROPBOXJSON_TYPE_NUM:
+        clean.value.intValue = n.value.intValue;
+        break;
+    case QDROPBOXJSON_TYPE_UINT:
+        clean.value.uintValue = n.value.uintValue;
+        break;
+    case QDROPBOXJSON_TYPE_FLOAT:
+        clean.value.doubleValue = n.value.doubleValue;
+        break;
+    case QDROPBOXJSON_TYPE_BOOL:
+        clean.value.boolValue = n.value.boolValue;
+        break;
+    case QDROPBOXJSON_TYPE_STR:
+        clean.value.string.offset = n.value.string.offset;
+        clean.value.string.length = n.value.string.length;
+        break;
+    case QDROPBOXJSON_TYPE_JSON:
+    case QDROPBOXJSON_TYPE_ARRAY:
+        clean.value.children.first = n.value.children.first;
+        clean.value.children.count = n.value.children.count;
+        break;
+    default:
+        break;
+    }
+    return clean;
+}
+
+QByteArray QDropboxJsonSnapshot::save(const QDropboxJson &json)
+{
+    // the JSON is imported into a document of its own: only its subtree is written, parsed
+    // completely and with all strings in the pool, so the snapshot needs no source
+    QDropboxJsonDocument     doc;
+    const qdropboxjson_node  root = doc.importNode(*json._doc, json._node);
+    doc._nodes[0] = root;
+    doc._modified = json._doc->_modified;
+
+    const qdropboxjson_snapshot_header header = snapshotHeader(doc, 0);
+
+    QByteArray out;
+    out.reserve(int(sizeof(header)) + header.nodeCount * int(sizeof(qdropboxjson_node)) + header.poolSize);
+    out.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    for(int i=0; i<doc._nodes.size(); ++i)
+    {
+        const qdropboxjson_node n = cleanNode(doc._nodes.at(i));
+        out.append(reinterpret_cast<const char *>(&n), sizeof(n));
+    }
+    out.append(doc._source);
+    out.append(doc._pool);
+    return out;
+}
+
+bool QDropboxJsonSnapshot::save(const QDropboxJson &json, QIODevice *device)
+{
+    const QByteArray data = save(json);
+    return device->write(data) == data.size();
+}
+
+bool QDropboxJsonSnapshot::load(const QByteArray &data, QDropboxJson *json)
+{
+    return load(data, QSharedPointer<QFile>(), json);
+}
+
+bool QDropboxJsonSnapshot::load(const QByteArray &data, QDropboxFileInfo *info)
+{
+    QDropboxJson json;
+    const bool   ok = load(data, &json);
+    *info = QDropboxFileInfo(json);
+    return ok;
+}
+
+bool QDropboxJsonSnapshot::load(const QString &fileName, QDropboxJson *json)
+{
+    QSharedPointer<QFile> file(new QFile(fileName));
+    if(!file->open(QIODevice::ReadOnly))
+        return load(QByteArray(), QSharedPointer<QFile>(), json);
+
+    const qint64 size   = file->size();
+    uchar       *mapped = (size > 0 && size <= 0x7FFFFFFF) ? file->map(0, size) : NULL;
+    if(mapped == NULL)
+    {
+#ifdef QTDROPBOX_DEBUG
+        qDebug() << "snapshot " << fileName << " can not be mapped, reading it" << endl;
+#endif
+        return load(file->readAll(), QSharedPointer<QFile>(), json);
+    }
+
+    // the document keeps the file (and so the mapping) until it is destroyed
+    return load(QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), int(size)), file, json);
+}
+
+bool QDropboxJsonSnapshot::load(const QString &fileName, QDropboxFileInfo *info)
+{
+    QDropboxJson json;
+    const bool   ok = load(fileName, &json);
+    *info = QDropboxFileInfo(json);
+    return ok;
+}
+
+qdropboxjson_snapshot_header QDropboxJsonSnapshot::snapshotHeader(const QDropboxJsonDocument &doc, int root)
+{
+    qdropboxjson_snapshot_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+    header.version    = QDROPBOXJSON_SNAPSHOT_VERSION;
+    header.nodeSize   = quint16(sizeof(qdropboxjson_node));
+    header.byteOrder  = snapshotByteOrder;
+    header.flags      = doc._modified ? QDROPBOXJSON_SNAPSHOT_MODIFIED : 0;
+    header.root       = root;
+    header.nodeCount  = doc._nodes.size();
+    header.sourceSize = doc._source.size();
+    header.poolSize   = doc._pool.size();
+    return header;
+}
+
+bool QDropboxJsonSnapshot::load(const QByteArray &data, const QSharedPointer<QFile> &mapping, QDropboxJson *json)
+{
+    json->emptyList();
+    json->valid = false;
+
+    qdropboxjson_snapshot_header header;
+    if(data.size() < int(sizeof(header)))
+        return false;
+    memcpy(&header, data.constData(), sizeof(header));
+
+    if(memcmp(header.magic, snapshotMagic, sizeof(header.magic)) != 0 ||
+       header.version   != QDROPBOXJSON_SNAPSHOT_VERSION ||
+       header.nodeSize  != sizeof(qdropboxjson_node) ||
+       header.byteOrder != snapshotByteOrder)
+    {
+#ifdef QTDROPBOX_DEBUG
+        qDebug() << "snapshot of another version or platform" << endl;
+#endif
+        return false;
+    }
+
+    const qint64 nodes = qint64(header.nodeCount) * qint64(sizeof(qdropboxjson_node));
+    if(header.nodeCount <= 0 || header.sourceSize < 0 || header.poolSize < 0 ||
+       qint64(sizeof(header)) + nodes + header.sourceSize + header.poolSize != data.size())
+    {
+#ifdef QTDROPBOX_DEBUG
+        qDebug() << "snapshot truncated" << endl;
+#endif
+        return false;
+    }
+
+    // only the node table is copied, source and pool are used in place
+    const char *base = data.constData() + sizeof(header);
+    QExplicitlySharedDataPointer<QDropboxJsonDocument> doc(new QDropboxJsonDocument());
+    doc->_nodes.resize(header.nodeCount);
+    memcpy(doc->_nodes.data(), base, size_t(nodes));
+    doc->_source   = QByteArray::fromRawData(base + nodes, header.sourceSize);
+    doc->_pool     = QByteArray::fromRawData(base + nodes + header.sourceSize, header.poolSize);
+    doc->_modified = (header.flags & QDROPBOXJSON_SNAPSHOT_MODIFIED) != 0;
+    doc->_snapshot = data;
+    doc->_mapping  = mapping;
+
+    if(!validate(*doc, header.root))
+    {
+#ifdef QTDROPBOX_DEBUG
+        qDebug() << "snapshot corrupted" << endl;
+#endif
+        return false;
+    }
+
+    json->_doc  = doc;
+    json->_node = header.root;
+    json->valid = true;
+    return true;
+}
+
+bool QDropboxJsonSnapshot::validate(const QDropboxJsonDocument &doc, int root)
+{
+    const int                count      = doc._nodes.size();
+    const int                sourceSize = doc._source.size();
+    const int                poolSize   = doc._pool.size();
+    const qdropboxjson_node *nodes      = doc._nodes.constData();
+
+    if(root < 0 || root >= count)
+        return false;
+
+    // every node of the tree is checked once, a node reached twice would make it a cycle
+    QBitArray    visited(count);
+    QVector<int> pending;
+    pending.append(root);
+    while(!pending.isEmpty())
+    {
+        const int i = pending.last();
+        pending.removeLast();
+        if(visited.testBit(i))
+            return false;
+        visited.setBit(i);
+
+        const qdropboxjson_node &n = nodes[i];
+        if(!inRange(n.keyOffset, n.keyLength, (n.flags & QDROPBOXJSON_NODE_KEY_POOL) ? poolSize : sourceSize))
+            return false;
+        if(n.offset >= 0 && !inRange(n.offset, n.length, sourceSize))
+            return false;
+
+        switch(n.type)
+        {
+        case QDROPBOXJSON_TYPE_STR:
+            if(!inRange(n.value.string.offset, n.value.string.length,
+                        (n.flags & QDROPBOXJSON_NODE_STRING_POOL) ? poolSize : sourceSize))
+                return false;
+            break;
+        case QDROPBOXJSON_TYPE_JSON:
+        case QDROPBOXJSON_TYPE_ARRAY:
+            // unparsed objects and arrays are parsed (and checked) when they are accessed
+            if(n.flags & QDROPBOXJSON_NODE_LAZY)
+            {
+                // the span has to hold at least the brackets, parsing starts at its first byte
+                if(n.offset < 0 || n.offset >= sourceSize || n.length <= 0 ||
+                   !inRange(n.offset, n.length, sourceSize))
+                    return false;
+                break;
+            }
+            if(!inRange(n.value.children.first, n.value.children.count, count))
+                return false;
+            for(int c=n.value.children.first; c<n.value.children.first+n.value.children.count; ++c)
+                pending.append(c);
+            break;
+        case QDROPBOXJSON_TYPE_NUM:
+        case QDROPBOXJSON_TYPE_UINT:
+        case QDROPBOXJSON_TYPE_FLOAT:
+        case QDROPBOXJSON_TYPE_BOOL:
+        case QDROPBOXJSON_TYPE_UNKNOWN:
+            break;
+        default:
+            return false;
+        }
+    }
+
+    return true;
+}
+
+QDataStream &operator<<(QDataStream &stream, const QDropboxJson &json)
+{
+    return stream << QDropboxJsonSnapshot::save(json);
+}
+
+QDataStream &operator>>(QDataStream &stream, QDropboxJson &json)
+{
+    QByteArray data;
+    stream >> data;
+    if(!QDropboxJsonSnapshot::load(data, &json) && stream.status() == QDataStream::Ok)
+        stream.setStatus(QDataStream::ReadCorruptData);
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, QDropboxFileInfo &info)
+{
+    QDropboxJson json;
+    stream >> json;
+    info = QDropboxFileInfo(json);
+    return stream;
+}
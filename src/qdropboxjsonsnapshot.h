@@ -0,0 +1,121 @@
+#ifndef QDROPBOXJSONSNAPSHOT_H
+#define QDROPBOXJSONSNAPSHOT_H
+
+#include "qtdropbox_global.h"
+#include "qdropboxjsondocument.h"
+#include "qdropboxjson.h"
+#include "qdropboxfileinfo.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QIODevice>
+#include <QFile>
+#include <QSharedPointer>
+#include <QDataStream>
+
+#ifdef QTDROPBOX_DEBUG
+#include <QDebug>
+#endif
+
+//! Version of the snapshot format written by QDropboxJsonSnapshot
+const quint16 QDROPBOXJSON_SNAPSHOT_VERSION = 1;
+
+//! Header of a snapshot, followed by the nodes, the source and the pool of the document
+struct qdropboxjson_snapshot_header{
+    char    magic[4];   //!< "QDJS"
+    quint16 version;    //!< QDROPBOXJSON_SNAPSHOT_VERSION
+    quint16 nodeSize;   //!< sizeof(qdropboxjson_node) of the platform that wrote the snapshot
+    quint32 byteOrder;  //!< 0x01020304 in the byte order of the platform that wrote the snapshot
+    quint32 flags;      //!< QDROPBOXJSON_SNAPSHOT_*
+    qint32  root;       //!< Index of the node of the saved QDropboxJson
+    qint32  nodeCount;  //!< Number of nodes
+    qint32  sourceSize; //!< Size of the source in bytes
+    qint32  poolSize;   //!< Size of the pool in bytes
+};
+
+//! The document was modified by setters when the snapshot was written
+const quint32 QDROPBOXJSON_SNAPSHOT_MODIFIED = 0x01;
+
+//! Saves parsed JSONs in a binary format that is loaded without parsing
+/*!
+  A snapshot stores the buffers of a QDropboxJsonDocument as they are: a header, the node
+  table with offsets into the other buffers, the source text and the pool of decoded strings.
+  Only the saved JSON is written, not the rest of its document: it is copied into a document
+  of its own first, parsed completely and with all strings in the pool, so the source of a
+  snapshot is empty. Loading a snapshot therefore only validates the header and the nodes of
+  the tree, nothing is parsed again. The pool is used in place, so loading a memory mapped
+  file costs about as much as mapping it plus one copy of the node table.
+
+  Snapshots are meant as cache of metadata (e.g. a folder tree kept between runs) or for
+  exchanging JSONs between processes on the same machine. They are written in the byte order
+  and node layout of the platform, a snapshot of another platform or version is rejected.
+
+  \code
+  QFile file("tree.snapshot");
+  file.open(QIODevice::WriteOnly);
+  QDropboxJsonSnapshot::save(metadata, &file);
+  file.close();
+
+  QDropboxFileInfo restored;
+  QDropboxJsonSnapshot::load("tree.snapshot", &restored);
+  \endcode
+ */
+class QTDROPBOXSHARED_EXPORT QDropboxJsonSnapshot
+{
+public:
+    /*!
+      Returns a snapshot of the JSON.
+     */
+    static QByteArray save(const QDropboxJson &json);
+
+    /*!
+      Writes a snapshot of the JSON to an open device. Returns false if the device failed to write.
+     */
+    static bool save(const QDropboxJson &json, QIODevice *device);
+
+    /*!
+      Loads a snapshot into json. The data is not copied: the JSON keeps a reference to it, so
+      data created with QByteArray::fromRawData() has to stay valid as long as the JSON (and its
+      copies) exist. Returns false and leaves an invalid JSON if data is not a valid snapshot.
+     */
+    static bool load(const QByteArray &data, QDropboxJson *json);
+
+    /*!
+      Same as load() above, metadata is passed through QDropboxFileInfo.
+     */
+    static bool load(const QByteArray &data, QDropboxFileInfo *info);
+
+    /*!
+      Maps a snapshot file into memory and loads it. The file stays mapped until the JSON and all
+      of its copies are destroyed. If the file can not be mapped it is read instead.
+     */
+    static bool load(const QString &fileName, QDropboxJson *json);
+
+    /*!
+      Same as load() above, metadata is passed through QDropboxFileInfo.
+     */
+    static bool load(const QString &fileName, QDropboxFileInfo *info);
+
+private:
+    static bool load(const QByteArray &data, const QSharedPointer<QFile> &mapping, QDropboxJson *json);
+    static bool validate(const QDropboxJsonDocument &doc, int root);
+    static qdropboxjson_snapshot_header snapshotHeader(const QDropboxJsonDocument &doc, int root);
+};
+
+/*!
+  Writes a snapshot of a QDropboxJson (or QDropboxFileInfo) to a QDataStream.
+ */
+QTDROPBOXSHARED_EXPORT QDataStream &operator<<(QDataStream &stream, const QDropboxJson &json);
+
+/*!
+  Reads a QDropboxJson from a QDataStream. The status of the stream is set to
+  QDataStream::ReadCorruptData if the data is not a valid snapshot.
+ */
+QTDROPBOXSHARED_EXPORT QDataStream &operator>>(QDataStream &stream, QDropboxJson &json);
+
+/*!
+  Reads a QDropboxFileInfo from a QDataStream.
+ */
+QTDROPBOXSHARED_EXPORT QDataStream &operator>>(QDataStream &stream, QDropboxFileInfo &info);
+
+#endif // QDROPBOXJSONSNAPSHOT_H
@@ -0,0 +1,338 @@
+#include "qdropboxjsonstreamreader.h"
+
+QDropboxJsonHandler::~QDropboxJsonHandler()
+{
+}
+
+void QDropboxJsonHandler::startObject()
+{
+}
+
+void QDropboxJsonHandler::endObject()
+{
+}
+
+void QDropboxJsonHandler::startArray()
+{
+}
+
+void QDropboxJsonHandler::endArray()
+{
+}
+
+void QDropboxJsonHandler::key(const QString &key)
+{
+    Q_UNUSED(key);
+}
+
+void QDropboxJsonHandler::value(const QDropboxJsonValue &value)
+{
+    Q_UNUSED(value);
+}
+
+void QDropboxJsonHandler::captured(const QDropboxJsonValue &value)
+{
+    Q_UNUSED(value);
+}
+
+QDropboxJsonStreamReader::QDropboxJsonStreamReader(QDropboxJsonHandler *handler) :
+    _handler(handler)
+{
+    reset();
+}
+
+bool QDropboxJsonStreamReader::addData(const QByteArray &data)
+{
+    if(_state == Failed)
+        return false;
+
+    const char *p           = data.constData();
+    const int   size        = data.size();
+    int         pos         = 0;
+    int         tokenFrom   = 0; // tokens and captures may have started in a previous chunk
+    int         captureFrom = 0;
+
+    while(pos < size && _state != Failed)
+    {
+        if(_token == StringToken)
+        {
+            bool complete = false;
+            while(pos < size && !complete)
+            {
+                const char c = p[pos++];
+                if(_escape)
+                    _escape = false;
+                else if(c == '\\')
+                    _escape = true;
+                else if(c == '"')
+                    complete = true;
+            }
+            if(!complete)
+                break;
+
+            if(_captureDepth < 0)
+                _tokenData.append(p+tokenFrom, pos-tokenFrom);
+            if(!completeToken())
+                _state = Failed;
+            continue;
+        }
+
+        if(_token == LiteralToken)
+        {
+            bool complete = false;
+            while(pos < size && !complete)
+            {
+                switch(p[pos])
+                {
+                case ' ':
+                case '\t':
+                case '\n':
+                case '\r':
+                case ',':
+                case ':':
+                case '}':
+                case ']':
+                    complete = true;
+                    break;
+                default:
+                    ++pos;
+                    break;
+                }
+            }
+            if(!complete)
+                break;
+
+            if(_captureDepth < 0)
+                _tokenData.append(p+tokenFrom, pos-tokenFrom);
+            if(!completeToken())
+                _state = Failed;
+            continue;
+        }
+
+        const char c = p[pos];
+        switch(c)
+        {
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+            ++pos;
+            break;
+        case '{':
+        case '[':
+            if(!openContainer(c))
+            {
+                _state = Failed;
+                break;
+            }
+            if(_captureRequested)
+            {
+                // the opening bracket is the first byte of the capture
+                _captureRequested = false;
+                _captureDepth     = _stack.size();
+                _capture          = "[";
+                captureFrom       = pos;
+            }
+            ++pos;
+            break;
+        case '}':
+        case ']':
+            ++pos;
+            if(_captureDepth == _stack.size())
+            {
+                _capture.append(p+captureFrom, pos-captureFrom);
+                if(!closeContainer(c))
+                    break;
+                _capture.append(']');
+
+                QByteArray json;
+                json.swap(_capture);
+                _captureDepth = -1;
+
+                QDropboxJsonDocument *doc = scratch();
+                if(!doc->parse(json))
+                {
+                    _state = Failed;
+                    break;
+                }
+                _handler->captured(QDropboxJsonValue(_scratch, 1));
+            }
+            else if(!closeContainer(c))
+                break;
+            afterValue();
+            break;
+        case ':':
+            if(_state != ExpectColon)
+                _state = Failed;
+            else
+                _state = ExpectValue;
+            ++pos;
+            break;
+        case ',':
+            if(_state != ExpectCommaOrEnd)
+                _state = Failed;
+            else
+                _state = (_stack.at(_stack.size()-1) == '{') ? ExpectKey : ExpectValue;
+            ++pos;
+            break;
+        case '"':
+            _token     = StringToken;
+            _escape    = false;
+            tokenFrom  = pos;
+            if(_captureDepth < 0)
+                _tokenData = "[";
+            ++pos;
+            break;
+        default:
+            _token     = LiteralToken;
+            tokenFrom  = pos;
+            if(_captureDepth < 0)
+                _tokenData = "[";
+            break;
+        }
+    }
+
+    if(_state == Failed)
+    {
+#ifdef QTDROPBOX_DEBUG
+        qDebug() << "json stream invalid at depth " << _stack.size() << endl;
+#endif
+        _tokenData.clear();
+        _capture.clear();
+        return false;
+    }
+
+    // keep what belongs to an incomplete token or capture for the next chunk
+    if(_captureDepth >= 0)
+        _capture.append(p+captureFrom, size-captureFrom);
+    else if(_token != NoToken)
+        _tokenData.append(p+tokenFrom, size-tokenFrom);
+
+    return true;
+}
+
+bool QDropboxJsonStreamReader::finish() const
+{
+    return _state == Done;
+}
+
+bool QDropboxJsonStreamReader::hasError() const
+{
+    return _state == Failed;
+}
+
+int QDropboxJsonStreamReader::depth() const
+{
+    return _stack.size();
+}
+
+void QDropboxJsonStreamReader::captureCurrent()
+{
+    _captureRequested = true;
+}
+
+void QDropboxJsonStreamReader::reset()
+{
+    _state            = ExpectValue;
+    _token            = NoToken;
+    _escape           = false;
+    _captureRequested = false;
+    _captureDepth     = -1;
+    _stack.clear();
+    _tokenData.clear();
+    _capture.clear();
+}
+
+bool QDropboxJsonStreamReader::openContainer(char c)
+{
+    if(_state != ExpectValue && _state != ExpectValueOrEnd)
+        return false;
+
+    _stack.append(c);
+    _state            = (c == '{') ? ExpectKeyOrEnd : ExpectValueOrEnd;
+    _captureRequested = false;
+
+    if(_captureDepth >= 0)
+        return true;
+
+    if(c == '{')
+        _handler->startObject();
+    else
+        _handler->startArray();
+    return true;
+}
+
+bool QDropboxJsonStreamReader::closeContainer(char c)
+{
+    const char open = (c == '}') ? '{' : '[';
+    const State empty = (c == '}') ? ExpectKeyOrEnd : ExpectValueOrEnd;
+
+    if((_state != ExpectCommaOrEnd && _state != empty) ||
+       _stack.isEmpty() || _stack.at(_stack.size()-1) != open)
+    {
+        _state = Failed;
+        return false;
+    }
+
+    _stack.chop(1);
+    if(_captureDepth >= 0)
+        return true;
+
+    if(c == '}')
+        _handler->endObject();
+    else
+        _handler->endArray();
+    return true;
+}
+
+bool QDropboxJsonStreamReader::completeToken()
+{
+    const Token token = _token;
+    _token = NoToken;
+
+    // the root has to be an object or array
+    if(_stack.isEmpty())
+        return false;
+
+    const bool isKey = (_state == ExpectKey || _state == ExpectKeyOrEnd);
+    if(isKey && token != StringToken)
+        return false;
+    if(!isKey && _state != ExpectValue && _state != ExpectValueOrEnd)
+        return false;
+
+    if(_captureDepth < 0)
+    {
+        // the token is decoded like the element of an array
+        _tokenData.append(']');
+        QByteArray json;
+        json.swap(_tokenData);
+
+        QDropboxJsonDocument *doc = scratch();
+        if(!doc->parse(json))
+            return false;
+
+        if(isKey)
+            _handler->key(doc->string(1));
+        else
+            _handler->value(QDropboxJsonValue(_scratch, 1));
+    }
+
+    if(isKey)
+        _state = ExpectColon;
+    else
+        afterValue();
+    return true;
+}
+
+void QDropboxJsonStreamReader::afterValue()
+{
+    _state = _stack.isEmpty() ? Done : ExpectCommaOrEnd;
+}
+
+QDropboxJsonDocument *QDropboxJsonStreamReader::scratch()
+{
+    // values passed to the handler may be kept, they must not be overwritten
+    if(!_scratch || _scratch->ref.load() != 1)
+        _scratch = new QDropboxJsonDocument();
+    return _scratch.data();
+}
@@ -0,0 +1,162 @@
+#ifndef QDROPBOXJSONSTREAMREADER_H
+#define QDROPBOXJSONSTREAMREADER_H
+
+#include "qtdropbox_global.h"
+#include "qdropboxjsondocument.h"
+#include "qdropboxjsonarray.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QExplicitlySharedDataPointer>
+
+#ifdef QTDROPBOX_DEBUG
+#include <QDebug>
+#endif
+
+//! Receives the events of a QDropboxJsonStreamReader
+/*!
+  Reimplement the functions for the events you are interested in. The default
+  implementations do nothing.
+ */
+class QTDROPBOXSHARED_EXPORT QDropboxJsonHandler
+{
+public:
+    virtual ~QDropboxJsonHandler();
+
+    /*!
+      An object starts. Call QDropboxJsonStreamReader::captureCurrent() to receive
+      the whole object by captured() instead of single events.
+     */
+    virtual void startObject();
+
+    /*!
+      The current object ends.
+     */
+    virtual void endObject();
+
+    /*!
+      An array starts. Call QDropboxJsonStreamReader::captureCurrent() to receive
+      the whole array by captured() instead of single events.
+     */
+    virtual void startArray();
+
+    /*!
+      The current array ends.
+     */
+    virtual void endArray();
+
+    /*!
+      The next value of the current object is mapped to this key.
+     */
+    virtual void key(const QString &key);
+
+    /*!
+      A string, number, boolean or null value was read.
+     */
+    virtual void value(const QDropboxJsonValue &value);
+
+    /*!
+      A captured object or array was read completely. It can be passed to the
+      constructor of QDropboxJson or QDropboxFileInfo.
+     */
+    virtual void captured(const QDropboxJsonValue &value);
+};
+
+//! Parses JSON data while it is received
+/*!
+  QDropboxJsonStreamReader is a push parser: data is passed to addData() in chunks of any
+  size as soon as it is available (e.g. from QNetworkReply::readyRead()) and the structure
+  of the JSON is reported to a QDropboxJsonHandler as it is read. Only incomplete tokens at
+  the end of a chunk are kept, so the memory used does not depend on the size of the JSON.
+
+  Objects or arrays the handler needs as a whole (e.g. the entries of a directory listing)
+  can be captured by calling captureCurrent() from QDropboxJsonHandler::startObject() or
+  QDropboxJsonHandler::startArray(). Their contents are not reported as events, instead they
+  are passed to QDropboxJsonHandler::captured() as soon as they end.
+
+  \code
+  QDropboxJsonStreamReader reader(&handler);
+  reader.addData("{\"contents\": [{\"pa");
+  reader.addData("th\": \"/a\"}]}");
+  bool complete = reader.finish();
+  \endcode
+ */
+class QTDROPBOXSHARED_EXPORT QDropboxJsonStreamReader
+{
+public:
+    /*!
+      Creates a reader that reports to the given handler.
+
+      \param handler Receiver of the events, not owned by the reader.
+     */
+    QDropboxJsonStreamReader(QDropboxJsonHandler *handler);
+
+    /*!
+      Parses the next chunk of data. Returns false if the JSON is invalid, no further
+      events are reported in that case.
+     */
+    bool addData(const QByteArray &data);
+
+    /*!
+      Returns true if a complete and valid JSON object or array was read.
+     */
+    bool finish() const;
+
+    /*!
+      Returns true if the data is not valid JSON.
+     */
+    bool hasError() const;
+
+    /*!
+      Returns the number of objects and arrays the reader is currently in.
+     */
+    int depth() const;
+
+    /*!
+      Captures the object or array that just started. Only valid if called from
+      QDropboxJsonHandler::startObject() or QDropboxJsonHandler::startArray().
+     */
+    void captureCurrent();
+
+    /*!
+      Resets the reader to read a new JSON.
+     */
+    void reset();
+
+private:
+    enum State{
+        ExpectValue,
+        ExpectValueOrEnd,
+        ExpectKey,
+        ExpectKeyOrEnd,
+        ExpectColon,
+        ExpectCommaOrEnd,
+        Done,
+        Failed
+    };
+
+    enum Token{
+        NoToken,
+        StringToken,
+        LiteralToken
+    };
+
+    QDropboxJsonHandler *_handler;
+    State      _state;
+    QByteArray _stack;
+    Token      _token;
+    bool       _escape;
+    QByteArray _tokenData;
+    bool       _captureRequested;
+    int        _captureDepth;
+    QByteArray _capture;
+    QExplicitlySharedDataPointer<QDropboxJsonDocument> _scratch;
+
+    bool openContainer(char c);
+    bool closeContainer(char c);
+    bool completeToken();
+    void afterValue();
+    QDropboxJsonDocument *scratch();
+};
+
+#endif // QDROPBOXJSONSTREAMREADER_H
@@ -0,0 +1,393 @@
+#include "qdropboxjsonwriter.h"
+#include "qdropboxjson.h"
+
+#include <QLocale>
+#include <QVarLengthArray>
+#include <qnumeric.h>
+
+#include <algorithm>
+
+//! Size of the chunks passed to a QIODevice
+static const int chunkSize = 16384;
+
+//! Shortest representation of a double that reads back as the same value
+static QByteArray shortestNumber(double value)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 7, 0)
+    return QByteArray::number(value, 'g', QLocale::FloatingPointShortest);
+#else
+    // older versions of Qt have no shortest mode, 17 digits always read back correctly
+    QByteArray number;
+    for(int precision = 1; precision <= 17; ++precision)
+    {
+        number = QByteArray::number(value, 'g', precision);
+        if(number.toDouble() == value)
+            break;
+    }
+    return number;
+#endif
+}
+
+//! Output of QDropboxJsonWriter, the buffer is passed on to a device whenever a chunk is full
+class qdropboxjson_sink
+{
+public:
+    qdropboxjson_sink(QByteArray &buffer, QIODevice *device) :
+        _buffer(buffer),
+        _device(device),
+        _failed(false)
+    {
+    }
+
+    void append(const char *data, int size)
+    {
+        _buffer.append(data, size);
+        if(_device != NULL && _buffer.size() >= chunkSize)
+            flush();
+    }
+
+    void append(char c)
+    {
+        _buffer.append(c);
+        if(_device != NULL && _buffer.size() >= chunkSize)
+            flush();
+    }
+
+    bool flush()
+    {
+        if(_device == NULL || _buffer.isEmpty())
+            return !_failed;
+
+        // after an error the rest is dropped
+        if(!_failed && _device->write(_buffer) != _buffer.size())
+            _failed = true;
+        _buffer.resize(0);
+        return !_failed;
+    }
+
+private:
+    QByteArray &_buffer;
+    QIODevice  *_device;
+    bool        _failed;
+};
+
+//! A child of an object in the order of the output
+struct qdropboxjson_member{
+    const char *key;    //!< Decoded key, only valid until the pool grows
+    int         length; //!< Length of the key
+    int         index;  //!< Index of the child node
+    bool        hidden; //!< The key is duplicated by a later child
+};
+
+//! Orders members by the bytes of their keys
+static bool keyLess(const qdropboxjson_member &a, const qdropboxjson_member &b)
+{
+    const int c = memcmp(a.key, b.key, qMin(a.length, b.length));
+    return c < 0 || (c == 0 && a.length < b.length);
+}
+
+static void appendInteger(quint64 value, bool negative, qdropboxjson_sink &out)
+{
+    char  buffer[24];
+    char *p = buffer + sizeof(buffer);
+    do
+    {
+        *--p = char('0' + value%10);
+        value /= 10;
+    } while(value != 0);
+    if(negative)
+        *--p = '-';
+    out.append(p, int(buffer + sizeof(buffer) - p));
+}
+
+QDropboxJsonWriter::QDropboxJsonWriter(Format format) :
+    _format(format)
+{
+}
+
+QDropboxJsonWriter::Format QDropboxJsonWriter::format() const
+{
+    return _format;
+}
+
+void QDropboxJsonWriter::setFormat(Format format)
+{
+    _format = format;
+}
+
+QByteArray QDropboxJsonWriter::write(const QDropboxJson &json) const
+{
+    QByteArray out;
+    write(*json._doc, json._node, out, NULL);
+    return out;
+}
+
+bool QDropboxJsonWriter::write(const QDropboxJson &json, QIODevice *device) const
+{
+    QByteArray buffer;
+    return write(*json._doc, json._node, buffer, device);
+}
+
+void QDropboxJsonWriter::write(const QDropboxJsonDocument &doc, int index, QByteArray &out) const
+{
+    write(doc, index, out, NULL);
+}
+
+bool QDropboxJsonWriter::write(const QDropboxJsonDocument &doc, int index, QByteArray &buffer, QIODevice *device) const
+{
+    const int estimate = estimateSize(doc, index);
+    buffer.reserve(buffer.size() + (device != NULL ? qMin(estimate, chunkSize + 1024) : estimate));
+
+    qdropboxjson_sink sink(buffer, device);
+    writeNode(doc, index, sink);
+
+#ifdef QTDROPBOX_DEBUG
+    qDebug() << "json written: " << buffer.size() << " bytes, " << estimate << " estimated" << endl;
+#endif
+    return sink.flush();
+}
+
+void QDropboxJsonWriter::writeNode(const QDropboxJsonDocument &doc, int index, qdropboxjson_sink &out) const
+{
+    // a copy, the node vector may grow while objects and arrays are materialized
+    const qdropboxjson_node n = doc._nodes.at(index);
+    const bool container = (n.type == QDROPBOXJSON_TYPE_JSON || n.type == QDROPBOXJSON_TYPE_ARRAY);
+
+    // parsed values are copied from the source unless a setter changed their content
+    // or the source is no valid JSON
+    if(_format == Compact && n.offset >= 0 &&
+       (!container || !doc._modified || (n.flags & QDROPBOXJSON_NODE_LAZY)) &&
+       isVerbatim(doc, index))
+    {
+        const char *source = doc._source.constData() + n.offset;
+        if(container)
+            writeStripped(source, n.length, out);
+        else
+            out.append(source, n.length);
+        return;
+    }
+
+    switch(n.type)
+    {
+    case QDROPBOXJSON_TYPE_NUM:
+        if(n.value.intValue < 0)
+            appendInteger(quint64(-(n.value.intValue + 1)) + 1, true, out);
+        else
+            appendInteger(quint64(n.value.intValue), false, out);
+        break;
+    case QDROPBOXJSON_TYPE_UINT:
+        appendInteger(n.value.uintValue, false, out);
+        break;
+    case QDROPBOXJSON_TYPE_FLOAT:
+    {
+        // infinity (e.g. from 1e999) can not be represented in JSON
+        if(!qIsFinite(n.value.doubleValue))
+        {
+            out.append("null", 4);
+            break;
+        }
+
+        // keep the value a float when it is parsed again
+        QByteArray number = shortestNumber(n.value.doubleValue);
+        if(!number.contains('.') && !number.contains('e'))
+            number += ".0";
+        out.append(number.constData(), number.size());
+        break;
+    }
+    case QDROPBOXJSON_TYPE_BOOL:
+        if(n.value.boolValue)
+            out.append("true", 4);
+        else
+            out.append("false", 5);
+        break;
+    case QDROPBOXJSON_TYPE_STR:
+        writeString(doc.stringData(n), n.value.string.length, out);
+        break;
+    case QDROPBOXJSON_TYPE_JSON:
+    case QDROPBOXJSON_TYPE_ARRAY:
+        // n may be moved by parsing the children
+        doc.materialize(index);
+        writeChildren(doc, doc._nodes.at(index), out);
+        break;
+    default:
+        out.append("null", 4);
+        break;
+    }
+}
+
+bool QDropboxJsonWriter::isVerbatim(const QDropboxJsonDocument &doc, int index)
+{
+    switch(doc._nodes.at(index).type)
+    {
+    case QDROPBOXJSON_TYPE_UNKNOWN:
+    {
+        // null is the only literal that is kept undecoded
+        const qdropboxjson_node &n = doc._nodes.at(index);
+        return n.length == 4 && qstrncmp(doc._source.constData() + n.offset, "null", 4) == 0;
+    }
+    case QDROPBOXJSON_TYPE_JSON:
+    case QDROPBOXJSON_TYPE_ARRAY:
+    {
+        if(!doc.materialize(index))
+            return false;
+
+        const int first = doc._nodes.at(index).value.children.first;
+        const int count = doc._nodes.at(index).value.children.count;
+        for(int i=first; i<first+count; ++i)
+        {
+            if(!isVerbatim(doc, i))
+                return false;
+        }
+        return true;
+    }
+    default:
+        return true;
+    }
+}
+
+void QDropboxJsonWriter::writeChildren(const QDropboxJsonDocument &doc, const qdropboxjson_node &n, qdropboxjson_sink &out) const
+{
+    const bool object = (n.type == QDROPBOXJSON_TYPE_JSON);
+    const int  first  = n.value.children.first;
+    const int  count  = n.value.children.count;
+
+    QVarLengthArray<qdropboxjson_member, 64> members(count);
+    for(int i=0; i<count; ++i)
+    {
+        const qdropboxjson_node &c = doc._nodes.at(first+i);
+        members[i].key    = doc.keyData(c);
+        members[i].length = c.keyLength;
+        members[i].index  = first+i;
+        members[i].hidden = false;
+    }
+
+    // of duplicated keys only the last one counts (see QDropboxJsonDocument::findChild())
+    if(object && _format == Canonical)
+    {
+        std::stable_sort(members.begin(), members.end(), keyLess);
+        for(int i=0; i+1<count; ++i)
+            members[i].hidden = !keyLess(members[i], members[i+1]);
+    }
+
+    out.append(object ? '{' : '[');
+    bool separator = false;
+    for(int i=0; i<count; ++i)
+    {
+        if(members[i].hidden)
+            continue;
+
+        if(separator)
+            out.append(',');
+        separator = true;
+
+        // parsing the previous children may have moved the pool, so the key is looked up again
+        if(object)
+        {
+            const qdropboxjson_node &c = doc._nodes.at(members[i].index);
+            writeString(doc.keyData(c), c.keyLength, out);
+            out.append(':');
+        }
+        writeNode(doc, members[i].index, out);
+    }
+    out.append(object ? '}' : ']');
+}
+
+void QDropboxJsonWriter::writeStripped(const char *data, int size, qdropboxjson_sink &out)
+{
+    // the span was parsed already, so only whitespace outside of strings has to be found
+    bool inString = false;
+    bool escaped  = false;
+    int  run      = 0;
+    for(int i=0; i<size; ++i)
+    {
+        const char c = data[i];
+        if(inString)
+        {
+            if(escaped)
+                escaped = false;
+            else if(c == '\\')
+                escaped = true;
+            else if(c == '"')
+                inString = false;
+            continue;
+        }
+
+        switch(c)
+        {
+        case '"':
+            inString = true;
+            break;
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+            out.append(data+run, i-run);
+            run = i+1;
+            break;
+        default:
+            break;
+        }
+    }
+    out.append(data+run, size-run);
+}
+
+void QDropboxJsonWriter::writeString(const char *data, int size, qdropboxjson_sink &out)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    // characters that do not need to be escaped are copied in runs
+    out.append('"');
+    int run = 0;
+    for(int i=0; i<size; ++i)
+    {
+        const uchar c = uchar(data[i]);
+        if(c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        out.append(data+run, i-run);
+        run = i+1;
+
+        switch(c)
+        {
+        case '"':
+            out.append("\\\"", 2);
+            break;
+        case '\\':
+            out.append("\\\\", 2);
+            break;
+        case '\b':
+            out.append("\\b", 2);
+            break;
+        case '\f':
+            out.append("\\f", 2);
+            break;
+        case '\n':
+            out.append("\\n", 2);
+            break;
+        case '\r':
+            out.append("\\r", 2);
+            break;
+        case '\t':
+            out.append("\\t", 2);
+            break;
+        default:
+        {
+            const char escape[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+            out.append(escape, sizeof(escape));
+            break;
+        }
+        }
+    }
+    out.append(data+run, size-run);
+    out.append('"');
+}
+
+int QDropboxJsonWriter::estimateSize(const QDropboxJsonDocument &doc, int index)
+{
+    // the source is at most as long as the output, values set by setters are kept in the pool
+    const qdropboxjson_node &n = doc._nodes.at(index);
+    int size = (n.offset >= 0) ? n.length : 0;
+    if(doc._modified || n.offset < 0)
+        size += doc._pool.size();
+    return size + 16;
+}
@@ -0,0 +1,89 @@
+#ifndef QDROPBOXJSONWRITER_H
+#define QDROPBOXJSONWRITER_H
+
+#include "qtdropbox_global.h"
+#include "qdropboxjsondocument.h"
+
+#include <QByteArray>
+#include <QIODevice>
+
+#ifdef QTDROPBOX_DEBUG
+#include <QDebug>
+#endif
+
+class QDropboxJson;
+class qdropboxjson_sink;
+
+//! Writes JSON in UTF-8
+/*!
+  QDropboxJsonWriter serializes a QDropboxJson (or a node of a QDropboxJsonDocument) in one
+  pass into a buffer that is reserved up front, or in chunks directly to a QIODevice. Strings
+  are escaped as required by RFC 7159.
+
+  In Compact format values that were not modified since parsing are copied from the source,
+  only the whitespace between tokens is removed. Objects and arrays are parsed first to make
+  sure their source is valid, unknown literals are written as null. The Canonical format writes every value from
+  its decoded representation and sorts the keys of objects, so equal JSONs result in the same
+  bytes regardless of key order, escape sequences or formatting of the source. This is the
+  format to use when serialized metadata is hashed or compared byte by byte.
+
+  \code
+  QDropboxJsonWriter writer(QDropboxJsonWriter::Canonical);
+  QByteArray bytes = writer.write(fileInfo);
+  writer.write(fileInfo, &file);
+  \endcode
+ */
+class QTDROPBOXSHARED_EXPORT QDropboxJsonWriter
+{
+public:
+    //! Output formats
+    enum Format{
+        Compact,  //!< No whitespace, keys in the order of the document
+        Canonical //!< No whitespace, keys sorted by their UTF-8 bytes, values normalized
+    };
+
+    /*!
+      Creates a writer for the given format.
+     */
+    QDropboxJsonWriter(Format format = Compact);
+
+    /*!
+      Returns the output format.
+     */
+    Format format() const;
+
+    /*!
+      Sets the output format.
+     */
+    void setFormat(Format format);
+
+    /*!
+      Returns the JSON as UTF-8. An empty JSON results in "{}".
+     */
+    QByteArray write(const QDropboxJson &json) const;
+
+    /*!
+      Writes the JSON to an open device. Returns false if the device failed to write.
+     */
+    bool write(const QDropboxJson &json, QIODevice *device) const;
+
+    /*!
+      Appends a node of a document to a buffer.
+      \warning internal use only
+     */
+    void write(const QDropboxJsonDocument &doc, int index, QByteArray &out) const;
+
+private:
+    Format _format;
+
+    bool write(const QDropboxJsonDocument &doc, int index, QByteArray &buffer, QIODevice *device) const;
+    void writeNode(const QDropboxJsonDocument &doc, int index, qdropboxjson_sink &out) const;
+    void writeChildren(const QDropboxJsonDocument &doc, const qdropboxjson_node &n, qdropboxjson_sink &out) const;
+
+    static bool isVerbatim(const QDropboxJsonDocument &doc, int index);
+    static void writeStripped(const char *data, int size, qdropboxjson_sink &out);
+    static void writeString(const char *data, int size, qdropboxjson_sink &out);
+    static int  estimateSize(const QDropboxJsonDocument &doc, int index);
+};
+
+#endif // QDROPBOXJSONWRITER_H
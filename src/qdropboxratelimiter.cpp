@@ -0,0 +1,158 @@
+#include "qdropboxratelimiter.h"
+#include "qdropboxjsondocument.h"
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+#include <QRandomGenerator>
+#else
+#include <QThreadStorage>
+#include <QThread>
+#include <QDateTime>
+#endif
+
+//! Lowest rate in requests per second, the rate never stops requests completely
+static const double minRate       = 0.5;
+//! Rate added per second of successful responses
+static const double rateIncrease  = 1.0;
+//! Responses within this time of a decrease were sent at the old rate
+static const qint64 decreaseDelay = 1000;
+//! Backoff of the first retry and highest backoff in milliseconds (before jitter)
+static const qint64 baseDelay     = 500;
+static const qint64 maxDelay      = 32000;
+
+//! Random number from 0 to range (inclusive) that may be drawn by any thread
+static qint64 randomUpTo(qint64 range)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+    return QRandomGenerator::global()->bounded(quint32(range + 1));
+#else
+    // the seed of qrand() is kept per thread, each thread seeds its own on first use
+    static QThreadStorage<bool> seeded;
+    if(!seeded.hasLocalData())
+    {
+        qsrand(uint(QDateTime::currentMSecsSinceEpoch()) ^ uint(quintptr(QThread::currentThreadId())));
+        seeded.setLocalData(true);
+    }
+    return qrand() % (range + 1);
+#endif
+}
+
+QDropboxRateLimiter::QDropboxRateLimiter() :
+    _maxRate(20),
+    _rate(20),
+    _burst(20),
+    _tokens(20),
+    _last(-1),
+    _pausedUntil(0),
+    _lastDecrease(-decreaseDelay)
+{
+}
+
+void QDropboxRateLimiter::setMaxRate(double perSecond)
+{
+    _maxRate = qMax(minRate, perSecond);
+    _rate    = qMin(_rate, _maxRate);
+}
+
+double QDropboxRateLimiter::maxRate() const
+{
+    return _maxRate;
+}
+
+double QDropboxRateLimiter::rate() const
+{
+    return _rate;
+}
+
+void QDropboxRateLimiter::setBurst(int burst)
+{
+    _burst  = qMax(1, burst);
+    _tokens = qMin(_tokens, double(_burst));
+}
+
+int QDropboxRateLimiter::burst() const
+{
+    return _burst;
+}
+
+qint64 QDropboxRateLimiter::waitTime(qint64 now)
+{
+    if(now < _pausedUntil)
+        return _pausedUntil - now;
+
+    refill(now);
+    if(_tokens >= 1)
+        return 0;
+
+    // round up, a token has to be complete when the caller checks again
+    return qint64((1 - _tokens) * 1000 / _rate) + 1;
+}
+
+void QDropboxRateLimiter::acquire(qint64 now)
+{
+    refill(now);
+    _tokens -= 1;
+}
+
+void QDropboxRateLimiter::pause(qint64 until)
+{
+    if(until <= _pausedUntil)
+        return;
+
+    // the tokens saved up before the pause would send a burst right into the cap
+    _pausedUntil = until;
+    _tokens      = 0;
+    _last        = until;
+}
+
+void QDropboxRateLimiter::succeeded()
+{
+    // at the current rate this adds rateIncrease per second
+    _rate = qMin(_maxRate, _rate + rateIncrease / _rate);
+}
+
+void QDropboxRateLimiter::throttled(qint64 now)
+{
+    if(now - _lastDecrease < decreaseDelay)
+        return;
+
+    _lastDecrease = now;
+    _rate   = qMax(minRate, _rate / 2);
+    _tokens = qMin(_tokens, 0.0);
+}
+
+qint64 QDropboxRateLimiter::retryDelay(int attempt)
+{
+    qint64 delay = maxDelay;
+    if(attempt < 6)
+        delay = qMin(maxDelay, baseDelay << attempt);
+
+    // half of the delay is random, so clients that failed together do not retry together
+    return delay/2 + randomUpTo(delay/2);
+}
+
+qint64 QDropboxRateLimiter::retryAfter(const QByteArray &value, qint64 now)
+{
+    const QByteArray trimmed = value.trimmed();
+
+    bool ok;
+    const int seconds = trimmed.toInt(&ok);
+    if(ok)
+        return seconds >= 0 ? qint64(seconds) * 1000 : -1;
+
+    // HTTP dates are a subset of the dates of RFC 2822 ("Wed, 21 Oct 2015 07:28:00 GMT")
+    qint64 date;
+    if(!QDropboxJsonDocument::parseTimestamp(trimmed.constData(), trimmed.size(), &date))
+        return -1;
+    return qMax(qint64(0), date - now);
+}
+
+void QDropboxRateLimiter::refill(qint64 now)
+{
+    if(_last < 0)
+        _last = now;
+    if(now <= _last)
+        return;
+
+    _tokens = qMin(double(_burst), _tokens + (now - _last) * _rate / 1000);
+    _last   = now;
+}
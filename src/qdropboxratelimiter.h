@@ -0,0 +1,109 @@
+#ifndef QDROPBOXRATELIMITER_H
+#define QDROPBOXRATELIMITER_H
+
+#include "qtdropbox_global.h"
+
+#include <QByteArray>
+
+//! Internally used limit of the request rate of QDropbox
+/*!
+  A token bucket: a request may be sent when a token is left, tokens are refilled at
+  rate() per second up to burst(). The rate adapts to the server (AIMD): every successful
+  response raises it a little, every response of an exhausted request cap (503) halves it,
+  so the rate settles just below the cap of the server.
+
+  Times are milliseconds of a monotonic clock, passed in by the caller.
+ */
+class QTDROPBOXSHARED_EXPORT QDropboxRateLimiter
+{
+public:
+    /*!
+      Creates a limiter of 20 requests per second with bursts of 20 requests.
+     */
+    QDropboxRateLimiter();
+
+    /*!
+      Sets the highest rate in requests per second. The current rate is lowered if it is
+      higher.
+     */
+    void setMaxRate(double perSecond);
+
+    /*!
+      Returns the highest rate in requests per second.
+     */
+    double maxRate() const;
+
+    /*!
+      Returns the current rate in requests per second.
+     */
+    double rate() const;
+
+    /*!
+      Sets the number of requests that may be sent at once after a pause.
+     */
+    void setBurst(int burst);
+
+    /*!
+      Returns the number of requests that may be sent at once after a pause.
+     */
+    int burst() const;
+
+    /*!
+      Returns the time in milliseconds until the next request may be sent, 0 if it may be
+      sent now.
+     */
+    qint64 waitTime(qint64 now);
+
+    /*!
+      Takes the token of a request that is sent now.
+     */
+    void acquire(qint64 now);
+
+    /*!
+      Sends no requests before the given time (e.g. for a Retry-After header).
+     */
+    void pause(qint64 until);
+
+    /*!
+      Raises the rate after a successful response (additive increase).
+     */
+    void succeeded();
+
+    /*!
+      Halves the rate after the request cap of the server was exceeded (multiplicative
+      decrease). Responses within a second of the last decrease were sent at the old rate
+      and do not lower it again.
+     */
+    void throttled(qint64 now);
+
+    /*!
+      Returns the delay in milliseconds before a retry (exponential backoff with jitter).
+      The first retry waits 0.25 to 0.5 seconds, every further retry twice as long, up
+      to 32 seconds. The jitter is random on every thread that calls this function.
+
+      \param attempt Number of the retry, starting at 0
+     */
+    static qint64 retryDelay(int attempt);
+
+    /*!
+      Returns the delay in milliseconds of a Retry-After header, given either in seconds or
+      as HTTP date. Returns -1 if the value is neither.
+
+      \param value Value of the header
+      \param now Current time in milliseconds since the epoch
+     */
+    static qint64 retryAfter(const QByteArray &value, qint64 now);
+
+private:
+    double _maxRate;
+    double _rate;
+    int    _burst;
+    double _tokens;
+    qint64 _last;
+    qint64 _pausedUntil;
+    qint64 _lastDecrease;
+
+    void refill(qint64 now);
+};
+
+#endif // QDROPBOXRATELIMITER_H
@@ -0,0 +1,104 @@
+#include "qdropboxreply.h"
+
+#include <QEventLoop>
+#include <QThread>
+
+QDropboxReply::QDropboxReply(int nr, QObject *parent) :
+    QObject(parent),
+    _nr(nr),
+    _finished(false),
+    _error(QDropbox::NoError),
+    _elapsed(0),
+    _woken(false)
+{
+    _timer.start();
+}
+
+QDropboxReply::~QDropboxReply()
+{
+}
+
+int QDropboxReply::requestNumber() const
+{
+    return _nr;
+}
+
+bool QDropboxReply::isFinished() const
+{
+    return _finished;
+}
+
+QDropbox::Error QDropboxReply::error() const
+{
+    return _error;
+}
+
+QString QDropboxReply::errorString() const
+{
+    return _errorText;
+}
+
+qint64 QDropboxReply::elapsed() const
+{
+    return _finished ? _elapsed : _timer.elapsed();
+}
+
+QDropboxJson QDropboxReply::json() const
+{
+    return _json;
+}
+
+QDropboxFileInfo QDropboxReply::metadata() const
+{
+    return _metadata;
+}
+
+QDropboxAccount QDropboxReply::account() const
+{
+    return _account;
+}
+
+QList<QDropboxFileInfo> QDropboxReply::revisions() const
+{
+    return _revisions;
+}
+
+QUrl QDropboxReply::sharedLink() const
+{
+    return _sharedLink;
+}
+
+bool QDropboxReply::waitForFinished()
+{
+    if(QThread::currentThread() != thread())
+    {
+        // the results are complete before the waiting threads are woken by finish()
+        QMutexLocker locker(&_waitMutex);
+        while(!_woken)
+            _waitCondition.wait(&_waitMutex);
+        return _error == QDropbox::NoError;
+    }
+
+    if(!_finished)
+    {
+#ifdef QTDROPBOX_DEBUG
+        qDebug() << "waiting for request " << _nr << endl;
+#endif
+        QEventLoop loop;
+        connect(this, SIGNAL(finished()), &loop, SLOT(quit()));
+        loop.exec();
+    }
+    return _error == QDropbox::NoError;
+}
+
+void QDropboxReply::finish()
+{
+    _finished = true;
+    _elapsed  = _timer.elapsed();
+    emit finished();
+
+    // a woken thread may delete the reply, nothing is touched afterwards
+    QMutexLocker locker(&_waitMutex);
+    _woken = true;
+    _waitCondition.wakeAll();
+}
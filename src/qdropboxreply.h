@@ -0,0 +1,152 @@
+#ifndef QDROPBOXREPLY_H
+#define QDROPBOXREPLY_H
+
+#include "qtdropbox_global.h"
+#include "qdropbox.h"
+#include "qdropboxjson.h"
+#include "qdropboxaccount.h"
+#include "qdropboxfileinfo.h"
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QUrl>
+
+#ifdef QTDROPBOX_DEBUG
+#include <QDebug>
+#endif
+
+//! The result of a single request sent by QDropbox
+/*!
+  QDropboxReply is returned by the functions of QDropbox that send a request without blocking
+  (QDropbox::accountInfo(), QDropbox::metadata(), QDropbox::revisions() and
+  QDropbox::sharedLink()). Every reply carries its own result, error and timing, so any number
+  of requests may be in flight at the same time without overwriting each other.
+
+  The signal finished() is emitted when the result (or an error) is available. Only the
+  function that matches the request returns data, e.g. metadata() for QDropbox::metadata().
+
+  \code
+  QDropboxReply *reply = dropbox.metadata("/dropbox/photos");
+  connect(reply, SIGNAL(finished()), this, SLOT(metadataFinished()));
+
+  void MyClass::metadataFinished()
+  {
+      QDropboxReply *reply = qobject_cast<QDropboxReply*>(sender());
+      if(reply->error() == QDropbox::NoError)
+          showListing(reply->metadata().contents());
+      reply->deleteLater();
+  }
+  \endcode
+
+  A reply is a child of the QDropbox that created it. Delete it (by using deleteLater()) as
+  soon as its result is no longer needed. A reply that is deleted before it finished is
+  simply not notified.
+ */
+class QTDROPBOXSHARED_EXPORT QDropboxReply : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+      Cleans up the reply on destruction.
+     */
+    ~QDropboxReply();
+
+    /*!
+      Returns the number of the request. QDropbox::operationFinished() is emitted with the
+      same number.
+     */
+    int requestNumber() const;
+
+    /*!
+      Returns true if the request has finished, successfully or not.
+     */
+    bool isFinished() const;
+
+    /*!
+      Returns the error of the request. QDropbox::NoError if the request succeeded or has
+      not finished yet.
+     */
+    QDropbox::Error error() const;
+
+    /*!
+      Returns a description of the error, if there is one.
+     */
+    QString errorString() const;
+
+    /*!
+      Returns the milliseconds from sending the request until it finished. While the
+      request is running the time elapsed so far is returned.
+     */
+    qint64 elapsed() const;
+
+    /*!
+      Returns the parsed response.
+     */
+    QDropboxJson json() const;
+
+    /*!
+      Returns the metadata requested by QDropbox::metadata(). The contents of a directory
+      are already listed.
+     */
+    QDropboxFileInfo metadata() const;
+
+    /*!
+      Returns the account information requested by QDropbox::accountInfo().
+     */
+    QDropboxAccount account() const;
+
+    /*!
+      Returns the revisions requested by QDropbox::revisions().
+     */
+    QList<QDropboxFileInfo> revisions() const;
+
+    /*!
+      Returns the link requested by QDropbox::sharedLink().
+     */
+    QUrl sharedLink() const;
+
+    /*!
+      Blocks until the request has finished and returns true if it succeeded.
+
+      Called by the thread of the reply (the thread of its QDropbox) a local event loop
+      processes the events of the thread until this reply is finished, other replies that
+      finish meanwhile do not end the wait. Any other thread sleeps until the reply is
+      finished, no event loop is needed.
+     */
+    bool waitForFinished();
+
+signals:
+    /*!
+      Emitted when the request has finished. Check error() to see if it succeeded.
+     */
+    void finished();
+
+private:
+    QDropboxReply(int nr, QObject *parent);
+    void finish();
+
+    int                     _nr;
+    bool                    _finished;
+    QDropbox::Error         _error;
+    QString                 _errorText;
+    QElapsedTimer           _timer;
+    qint64                  _elapsed;
+    QDropboxJson            _json;
+    QDropboxFileInfo        _metadata;
+    QDropboxAccount         _account;
+    QList<QDropboxFileInfo> _revisions;
+    QUrl                    _sharedLink;
+
+    // waiting threads other than the thread of the reply
+    QMutex                  _waitMutex;
+    QWaitCondition          _waitCondition;
+    bool                    _woken;
+
+    friend class QDropbox;
+};
+
+#endif // QDROPBOXREPLY_H
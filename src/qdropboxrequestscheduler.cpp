@@ -0,0 +1,110 @@
+#include "qdropboxrequestscheduler.h"
+
+QDropboxRequestScheduler::QDropboxRequestScheduler() :
+    _defaultMaxRunning(6)
+{
+    for(int i = 0; i < QDROPBOX_PRIORITY_LANES; ++i)
+    {
+        _lanes[i].next = 0;
+        _lanes[i].size = 0;
+    }
+}
+
+void QDropboxRequestScheduler::enqueue(const qdropbox_pending_request &request, int lane, int caller)
+{
+    lane = qBound(0, lane, QDROPBOX_PRIORITY_LANES-1);
+    Lane &l = _lanes[lane];
+
+    // a caller without queued requests joins the turns at the end
+    if(!l.queues.contains(caller))
+        l.callers.append(caller);
+    l.queues[caller].append(request);
+    ++l.size;
+}
+
+bool QDropboxRequestScheduler::takeNext(qdropbox_pending_request *request)
+{
+    for(int lane = 0; lane < QDROPBOX_PRIORITY_LANES; ++lane)
+    {
+        Lane &l = _lanes[lane];
+        const int callers = l.callers.size();
+        for(int k = 0; k < callers; ++k)
+        {
+            const int i = (l.next + k) % callers;
+            const int caller = l.callers.at(i);
+            QList<qdropbox_pending_request> &queue = l.queues[caller];
+            if(!mayRun(queue.first().host, lane))
+                continue;
+
+            *request = queue.takeFirst();
+            --l.size;
+            _running[request->host] += 1;
+
+            // the next turn belongs to the caller after this one
+            if(queue.isEmpty())
+            {
+                l.queues.remove(caller);
+                l.callers.removeAt(i);
+                l.next = l.callers.isEmpty() ? 0 : i % l.callers.size();
+            }
+            else
+                l.next = (i + 1) % callers;
+            return true;
+        }
+    }
+    return false;
+}
+
+void QDropboxRequestScheduler::finished(const QString &host)
+{
+    const int running = _running.value(host) - 1;
+    if(running > 0)
+        _running.insert(host, running);
+    else
+        _running.remove(host);
+}
+
+void QDropboxRequestScheduler::setMaxRunning(const QString &host, int max)
+{
+    _maxRunning.insert(host, qMax(1, max));
+}
+
+int QDropboxRequestScheduler::maxRunning(const QString &host) const
+{
+    return _maxRunning.value(host, _defaultMaxRunning);
+}
+
+void QDropboxRequestScheduler::setDefaultMaxRunning(int max)
+{
+    _defaultMaxRunning = qMax(1, max);
+}
+
+int QDropboxRequestScheduler::running(const QString &host) const
+{
+    return _running.value(host);
+}
+
+int QDropboxRequestScheduler::queued(int lane) const
+{
+    if(lane < 0 || lane >= QDROPBOX_PRIORITY_LANES)
+        return 0;
+    return _lanes[lane].size;
+}
+
+int QDropboxRequestScheduler::queued() const
+{
+    int size = 0;
+    for(int i = 0; i < QDROPBOX_PRIORITY_LANES; ++i)
+        size += _lanes[i].size;
+    return size;
+}
+
+bool QDropboxRequestScheduler::mayRun(const QString &host, int lane) const
+{
+    const int max = maxRunning(host);
+
+    // one connection is kept free for the first lane
+    if(lane > 0 && max > 1)
+        return running(host) < max - 1;
+    return running(host) < max;
+}
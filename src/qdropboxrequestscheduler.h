@@ -0,0 +1,111 @@
+#ifndef QDROPBOXREQUESTSCHEDULER_H
+#define QDROPBOXREQUESTSCHEDULER_H
+
+#include "qtdropbox_global.h"
+
+#include <QString>
+#include <QByteArray>
+#include <QUrl>
+#include <QList>
+#include <QHash>
+
+//! Number of priority lanes of QDropboxRequestScheduler (see QDropbox::Priority)
+const int QDROPBOX_PRIORITY_LANES = 3;
+
+//! Internally used struct for a request that waits to be sent
+struct qdropbox_pending_request{
+    int        nr;       //!< ID of the request
+    QUrl       url;      //!< Complete request URL
+    QString    method;   //!< Used method to send the request (POST/GET)
+    QByteArray postdata; //!< Body of a POST request
+    QString    host;     //!< Host that receives the request
+};
+
+//! Internally used queue of the requests of QDropbox
+/*!
+  Requests are queued in priority lanes, lane 0 is served first. Within a lane every
+  caller (e.g. a QDropboxClient) has a queue of its own and the callers take turns, so a
+  caller that queued thousands of requests does not delay the single request of another
+  one. The requests of a caller are sent in the order they were queued.
+
+  A request is only taken from the queue if its host has less requests running than the
+  limit of the host. Requests of the other lanes may use all but one of the
+  connections of a host, so a request of lane 0 never waits for a whole batch of other
+  requests to finish.
+ */
+class QTDROPBOXSHARED_EXPORT QDropboxRequestScheduler
+{
+public:
+    /*!
+      Creates an empty scheduler. Hosts are limited to 6 running requests, the number of
+      connections QNetworkAccessManager opens per host.
+     */
+    QDropboxRequestScheduler();
+
+    /*!
+      Queues a request.
+
+      \param request The request
+      \param lane Priority lane (0 to QDROPBOX_PRIORITY_LANES-1)
+      \param caller Caller that sent the request
+     */
+    void enqueue(const qdropbox_pending_request &request, int lane, int caller);
+
+    /*!
+      Takes the next request that may be sent and counts it as running. Returns false if
+      no queued request may be sent now.
+     */
+    bool takeNext(qdropbox_pending_request *request);
+
+    /*!
+      Marks a request of the host as finished, so the next one may be sent.
+     */
+    void finished(const QString &host);
+
+    /*!
+      Sets the limit of running requests of a host. A limit below 1 is set to 1.
+     */
+    void setMaxRunning(const QString &host, int max);
+
+    /*!
+      Returns the limit of running requests of a host.
+     */
+    int maxRunning(const QString &host) const;
+
+    /*!
+      Sets the limit of hosts without a limit of their own.
+     */
+    void setDefaultMaxRunning(int max);
+
+    /*!
+      Returns the number of running requests of a host.
+     */
+    int running(const QString &host) const;
+
+    /*!
+      Returns the number of requests queued in a lane.
+     */
+    int queued(int lane) const;
+
+    /*!
+      Returns the number of queued requests.
+     */
+    int queued() const;
+
+private:
+    struct Lane{
+        QHash<int,QList<qdropbox_pending_request> > queues;
+        QList<int> callers;
+        int        next;
+        int        size;
+    };
+
+    Lane               _lanes[QDROPBOX_PRIORITY_LANES];
+    QHash<QString,int> _maxRunning;
+    QHash<QString,int> _running;
+    int                _defaultMaxRunning;
+
+    bool mayRun(const QString &host, int lane) const;
+};
+
+#endif // QDROPBOXREQUESTSCHEDULER_H
@@ -0,0 +1,162 @@
+#include "qdropboxrequesttable.h"
+
+//! The lower bits of an ID select the slot, the upper bits hold its generation
+static const int slotBits      = 16;
+static const int slotMask      = (1 << slotBits) - 1;
+static const int maxGeneration = 0x7FFF;
+
+QDropboxRequestTable::QDropboxRequestTable() :
+    _freeSlot(-1),
+    _inFlight(0),
+    _total(0)
+{
+}
+
+int QDropboxRequestTable::insert(QNetworkReply *reply, const qdropbox_request &request)
+{
+    int slot = _freeSlot;
+    if(slot >= 0)
+        _freeSlot = _slots[slot].nextFree;
+    else
+    {
+        if(_slots.size() > slotMask)
+            return -1;
+
+        Slot s;
+        s.reply      = NULL;
+        s.generation = 0;
+        s.nextFree   = -1;
+        s.used       = false;
+        slot = _slots.size();
+        _slots.append(s);
+    }
+
+    // generations start at 1, so IDs are never 0 or negative
+    Slot &s = _slots[slot];
+    s.generation = (s.generation % maxGeneration) + 1;
+    s.request    = request;
+    s.reply      = reply;
+    s.nextFree   = -1;
+    s.used       = true;
+
+    const int id = (s.generation << slotBits) | slot;
+    if(reply != NULL)
+        _replies.insert(reply, id);
+    ++_inFlight;
+    ++_total;
+    return id;
+}
+
+bool QDropboxRequestTable::contains(int id) const
+{
+    return slotOf(id) >= 0;
+}
+
+qdropbox_request QDropboxRequestTable::value(int id) const
+{
+    const int slot = slotOf(id);
+    if(slot >= 0)
+        return _slots.at(slot).request;
+
+    qdropbox_request none;
+    none.type     = 0;
+    none.linked   = 0;
+    none.priority = 0;
+    none.attempts = 0;
+    return none;
+}
+
+void QDropboxRequestTable::setType(int id, qdropbox_request_type type)
+{
+    const int slot = slotOf(id);
+    if(slot >= 0)
+        _slots[slot].request.type = type;
+}
+
+void QDropboxRequestTable::setLinked(int id, int linked)
+{
+    const int slot = slotOf(id);
+    if(slot >= 0)
+        _slots[slot].request.linked = linked;
+}
+
+void QDropboxRequestTable::setAttempts(int id, int attempts)
+{
+    const int slot = slotOf(id);
+    if(slot >= 0)
+        _slots[slot].request.attempts = attempts;
+}
+
+void QDropboxRequestTable::setReply(int id, QNetworkReply *reply)
+{
+    const int slot = slotOf(id);
+    if(slot < 0)
+        return;
+
+    Slot &s = _slots[slot];
+    if(s.reply != NULL)
+        _replies.remove(s.reply);
+    s.reply = reply;
+    if(reply != NULL)
+        _replies.insert(reply, id);
+}
+
+QNetworkReply *QDropboxRequestTable::reply(int id) const
+{
+    const int slot = slotOf(id);
+    return slot >= 0 ? _slots.at(slot).reply : NULL;
+}
+
+int QDropboxRequestTable::id(QNetworkReply *reply) const
+{
+    return _replies.value(reply, 0);
+}
+
+void QDropboxRequestTable::releaseReply(QNetworkReply *reply)
+{
+    const int slot = slotOf(_replies.take(reply));
+    if(slot >= 0)
+        _slots[slot].reply = NULL;
+}
+
+void QDropboxRequestTable::remove(int id)
+{
+    const int slot = slotOf(id);
+    if(slot < 0)
+        return;
+
+    Slot &s = _slots[slot];
+    if(s.reply != NULL)
+        _replies.remove(s.reply);
+
+    // the strings of the request are freed now, not when the slot is reused
+    s.request  = qdropbox_request();
+    s.reply    = NULL;
+    s.used     = false;
+    s.nextFree = _freeSlot;
+    _freeSlot  = slot;
+    --_inFlight;
+}
+
+qdropbox_request_statistics QDropboxRequestTable::statistics() const
+{
+    qdropbox_request_statistics statistics;
+    statistics.inFlight = _inFlight;
+    statistics.capacity = _slots.size();
+    statistics.total    = _total;
+    statistics.queued   = 0;
+    return statistics;
+}
+
+int QDropboxRequestTable::slotOf(int id) const
+{
+    if(id <= 0)
+        return -1;
+
+    const int slot = id & slotMask;
+    if(slot >= _slots.size())
+        return -1;
+
+    const Slot &s = _slots.at(slot);
+    return (s.used && s.generation == (id >> slotBits)) ? slot : -1;
+}
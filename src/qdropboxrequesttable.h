@@ -0,0 +1,158 @@
+#ifndef QDROPBOXREQUESTTABLE_H
+#define QDROPBOXREQUESTTABLE_H
+
+#include "qtdropbox_global.h"
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+
+class QNetworkReply;
+
+typedef int qdropbox_request_type;
+
+const qdropbox_request_type QDROPBOX_REQ_CONNECT = 0x01;
+const qdropbox_request_type QDROPBOX_REQ_RQTOKEN = 0x02;
+const qdropbox_request_type QDROPBOX_REQ_AULOGIN = 0x03;
+const qdropbox_request_type QDROPBOX_REQ_REDIREC = 0x04;
+const qdropbox_request_type QDROPBOX_REQ_ACCTOKN = 0x05;
+const qdropbox_request_type QDROPBOX_REQ_ACCINFO = 0x06;
+const qdropbox_request_type QDROPBOX_REQ_RQBTOKN = 0x07;
+const qdropbox_request_type QDROPBOX_REQ_BACCTOK = 0x08;
+const qdropbox_request_type QDROPBOX_REQ_METADAT = 0x09;
+const qdropbox_request_type QDROPBOX_REQ_BACCINF = 0x0A;
+const qdropbox_request_type QDROPBOX_REQ_BMETADA = 0x0B;
+const qdropbox_request_type QDROPBOX_REQ_SHRDLNK = 0x0C;
+const qdropbox_request_type QDROPBOX_REQ_BSHRDLN = 0x0D;
+const qdropbox_request_type QDROPBOX_REQ_REVISIO = 0x0E;
+const qdropbox_request_type QDROPBOX_REQ_BREVISI = 0x0F;
+
+//! Internally used struct to handle network requests sent from QDropbox
+/*!
+  This structure is used internally by QDropbox. It is used to connect network
+  requests that are sent to the Dropbox API server with the asynchronous queries
+  made to the QtDropbox API.
+ */
+struct qdropbox_request{
+    qdropbox_request_type type; //!< Type of the request
+    QString method;             //!< Used method to send the request (POST/GET)
+    QString host;               //!< Host that received the request
+    int linked;                 //!< ID of any linked request (for forwarded requests)
+    int priority;               //!< Priority lane of the request (see QDropbox::Priority)
+    int attempts;               //!< Number of retries of the request
+};
+
+//! Counters of the requests of a QDropbox
+/*!
+  Returned by QDropbox::requestStatistics().
+ */
+struct qdropbox_request_statistics{
+    int    inFlight;  //!< Requests that are sent and not finished yet
+    int    capacity;  //!< Slots allocated for requests, the highest number of requests in flight so far
+    qint64 total;     //!< Requests sent since QDropbox was created
+    int    queued;    //!< Requests in flight that wait for a connection
+};
+
+//! Internally used table of the requests sent by QDropbox
+/*!
+  The requests are kept in slots that are reused as soon as a request is removed, so the
+  table only grows with the number of requests in flight at the same time. The ID of a
+  request combines its slot with a generation counter of the slot. An ID of a removed
+  request stays invalid after its slot was reused, until the generation counter wraps
+  around after 32767 reuses of the slot.
+
+  The network reply of a request is mapped to its ID until it is released, which happens
+  as soon as the reply is finished. The request itself stays in the table until it is
+  removed, e.g. while its response is parsed in background.
+ */
+class QTDROPBOXSHARED_EXPORT QDropboxRequestTable
+{
+public:
+    /*!
+      Creates an empty table.
+     */
+    QDropboxRequestTable();
+
+    /*!
+      Adds a request and returns its ID or -1 if no slot is left (65536 requests in flight).
+
+      \param reply Network reply of the request, NULL if it is not sent yet
+      \param request Request information
+     */
+    int insert(QNetworkReply *reply, const qdropbox_request &request);
+
+    /*!
+      Returns true if id refers to a request in the table.
+     */
+    bool contains(int id) const;
+
+    /*!
+      Returns the request with the given ID. For an invalid ID a request of type 0 is
+      returned.
+     */
+    qdropbox_request value(int id) const;
+
+    /*!
+      Sets the type of a request.
+     */
+    void setType(int id, qdropbox_request_type type);
+
+    /*!
+      Links a request to another one (e.g. a redirection to the original request).
+     */
+    void setLinked(int id, int linked);
+
+    /*!
+      Sets the number of retries of a request.
+     */
+    void setAttempts(int id, int attempts);
+
+    /*!
+      Sets the network reply of a request that was inserted without one.
+     */
+    void setReply(int id, QNetworkReply *reply);
+
+    /*!
+      Returns the network reply of a request or NULL if it was released.
+     */
+    QNetworkReply *reply(int id) const;
+
+    /*!
+      Returns the ID of the request of a network reply or 0 if there is none.
+     */
+    int id(QNetworkReply *reply) const;
+
+    /*!
+      Forgets a network reply, the request stays in the table.
+     */
+    void releaseReply(QNetworkReply *reply);
+
+    /*!
+      Removes a request and frees its slot. Invalid IDs are ignored.
+     */
+    void remove(int id);
+
+    /*!
+      Returns the counters of the table.
+     */
+    qdropbox_request_statistics statistics() const;
+
+private:
+    struct Slot{
+        qdropbox_request request;
+        QNetworkReply   *reply;
+        int              generation;
+        int              nextFree;
+        bool             used;
+    };
+
+    QVector<Slot>             _slots;
+    QHash<QNetworkReply*,int> _replies;
+    int                       _freeSlot;
+    int                       _inFlight;
+    qint64                    _total;
+
+    int slotOf(int id) const;
+};
+
+#endif // QDROPBOXREQUESTTABLE_H
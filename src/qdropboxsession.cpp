@@ -0,0 +1,164 @@
+#include "qdropboxsession.h"
+
+QDropboxClient::QDropboxClient() :
+    _dropbox(NULL),
+    _id(0),
+    _priority(QDropbox::NormalPriority),
+    _error(QDropbox::NoError)
+{
+}
+
+QDropboxClient::QDropboxClient(QDropbox *dropbox, int id) :
+    _dropbox(dropbox),
+    _id(id),
+    _priority(QDropbox::NormalPriority),
+    _error(QDropbox::NoError)
+{
+}
+
+bool QDropboxClient::isValid() const
+{
+    return _dropbox != NULL;
+}
+
+QDropbox::Error QDropboxClient::error() const
+{
+    return _error;
+}
+
+QString QDropboxClient::errorString() const
+{
+    return _errorText;
+}
+
+void QDropboxClient::setPriority(QDropbox::Priority priority)
+{
+    _priority = priority;
+}
+
+QDropbox::Priority QDropboxClient::priority() const
+{
+    return _priority;
+}
+
+QDropboxAccount QDropboxClient::requestAccountInfoAndWait()
+{
+    QDropboxReply *reply = _dropbox->callAndWait(QDROPBOX_REQ_ACCINFO, QString(), 0, _priority, _id);
+    QDropboxAccount account = reply->account();
+    takeResult(reply);
+    return account;
+}
+
+QDropboxFileInfo QDropboxClient::requestMetadataAndWait(QString file)
+{
+    QDropboxReply *reply = _dropbox->callAndWait(QDROPBOX_REQ_METADAT, file, 0, _priority, _id);
+    QDropboxFileInfo info = reply->metadata();
+    takeResult(reply);
+    return info;
+}
+
+QList<QDropboxFileInfo> QDropboxClient::requestRevisionsAndWait(QString file, int max)
+{
+    QDropboxReply *reply = _dropbox->callAndWait(QDROPBOX_REQ_REVISIO, file, max, _priority, _id);
+    QList<QDropboxFileInfo> revisions = reply->revisions();
+    takeResult(reply);
+    return revisions;
+}
+
+QUrl QDropboxClient::requestSharedLinkAndWait(QString file)
+{
+    QDropboxReply *reply = _dropbox->callAndWait(QDROPBOX_REQ_SHRDLNK, file, 0, _priority, _id);
+    QUrl link = reply->sharedLink();
+    takeResult(reply);
+    return link;
+}
+
+QDropboxReply *QDropboxClient::accountInfo()
+{
+    return _dropbox->call(QDROPBOX_REQ_ACCINFO, QString(), 0, _priority, _id);
+}
+
+QDropboxReply *QDropboxClient::metadata(QString file)
+{
+    return _dropbox->call(QDROPBOX_REQ_METADAT, file, 0, _priority, _id);
+}
+
+QDropboxReply *QDropboxClient::revisions(QString file, int max)
+{
+    return _dropbox->call(QDROPBOX_REQ_REVISIO, file, max, _priority, _id);
+}
+
+QDropboxReply *QDropboxClient::sharedLink(QString file)
+{
+    return _dropbox->call(QDROPBOX_REQ_SHRDLNK, file, 0, _priority, _id);
+}
+
+void QDropboxClient::takeResult(QDropboxReply *reply)
+{
+    _error     = reply->error();
+    _errorText = reply->errorString();
+
+    // the reply belongs to the network thread and is deleted there
+    reply->deleteLater();
+}
+
+QDropboxSession::QDropboxSession(QString key, QString sharedSecret, QDropbox::OAuthMethod method, QString url, QObject *parent) :
+    QObject(parent)
+{
+#ifdef QTDROPBOX_DEBUG
+    qDebug() << "creating dropbox session" << endl;
+#endif
+    _dropbox = new QDropbox(key, sharedSecret, method, url);
+
+    // tokens received by the network thread are stored right there
+    connect(_dropbox, SIGNAL(tokenChanged(QString,QString)),
+            this, SLOT(dropboxTokenChanged(QString,QString)), Qt::DirectConnection);
+    _dropbox->startNetworkThread();
+}
+
+QDropboxSession::~QDropboxSession()
+{
+    // QDropbox is destroyed by its network thread, which quits afterwards
+    QThread *networkThread = _dropbox->thread();
+    _dropbox->deleteLater();
+    networkThread->wait();
+    delete networkThread;
+}
+
+void QDropboxSession::setToken(QString token, QString tokenSecret)
+{
+    {
+        QMutexLocker locker(&_mutex);
+        _token       = token;
+        _tokenSecret = tokenSecret;
+    }
+
+    // queued calls are handled in order, requests sent afterwards use the new token
+    QMetaObject::invokeMethod(_dropbox, "setToken", Qt::QueuedConnection, Q_ARG(QString, token));
+    QMetaObject::invokeMethod(_dropbox, "setTokenSecret", Qt::QueuedConnection, Q_ARG(QString, tokenSecret));
+}
+
+QString QDropboxSession::token() const
+{
+    QMutexLocker locker(&_mutex);
+    return _token;
+}
+
+QString QDropboxSession::tokenSecret() const
+{
+    QMutexLocker locker(&_mutex);
+    return _tokenSecret;
+}
+
+QDropboxClient QDropboxSession::client()
+{
+    // clients are numbered from 1, requests of QDropbox itself use 0
+    return QDropboxClient(_dropbox, _clients.fetchAndAddRelaxed(1) + 1);
+}
+
+void QDropboxSession::dropboxTokenChanged(QString token, QString secret)
+{
+    QMutexLocker locker(&_mutex);
+    _token       = token;
+    _tokenSecret = secret;
+}
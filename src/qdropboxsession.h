@@ -0,0 +1,171 @@
+#ifndef QDROPBOXSESSION_H
+#define QDROPBOXSESSION_H
+
+#include "qtdropbox_global.h"
+#include "qdropbox.h"
+#include "qdropboxreply.h"
+
+#include <QObject>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QString>
+#include <QList>
+#include <QUrl>
+
+#ifdef QTDROPBOX_DEBUG
+#include <QDebug>
+#endif
+
+class QDropboxSession;
+
+//! Handle of a thread to the requests of a QDropboxSession
+/*!
+  A client is created by QDropboxSession::client() and sends its requests through the
+  QDropbox of the session. Clients are cheap to create and copy, every thread that sends
+  requests should use a client of its own. The error of the last request is kept by the
+  client, so threads do not see the errors of each other.
+
+  The functions match those of QDropbox. The blocking functions may be called by any
+  thread, the calling thread sleeps until the request is answered. The replies of the
+  non-blocking functions live in the network thread of the session, their signals are
+  delivered to other threads as queued signals.
+ */
+class QTDROPBOXSHARED_EXPORT QDropboxClient
+{
+public:
+    /*!
+      Creates a client that does not belong to a session.
+     */
+    QDropboxClient();
+
+    /*!
+      Returns true if the client belongs to a session.
+     */
+    bool isValid() const;
+
+    /*!
+      Returns the error of the last blocking request of this client.
+     */
+    QDropbox::Error error() const;
+
+    /*!
+      Returns a description of the error of the last blocking request of this client.
+     */
+    QString errorString() const;
+
+    /*!
+      Sets the priority of the requests of this client. Requests of several clients with
+      the same priority take turns, so every client gets its share of the connections.
+     */
+    void setPriority(QDropbox::Priority priority);
+
+    /*!
+      Returns the priority of the requests of this client.
+     */
+    QDropbox::Priority priority() const;
+
+    QDropboxAccount         requestAccountInfoAndWait();                            //!< See QDropbox::requestAccountInfoAndWait()
+    QDropboxFileInfo        requestMetadataAndWait(QString file);                   //!< See QDropbox::requestMetadataAndWait()
+    QList<QDropboxFileInfo> requestRevisionsAndWait(QString file, int max = 10);    //!< See QDropbox::requestRevisionsAndWait()
+    QUrl                    requestSharedLinkAndWait(QString file);                 //!< See QDropbox::requestSharedLinkAndWait()
+
+    QDropboxReply *accountInfo();                       //!< See QDropbox::accountInfo()
+    QDropboxReply *metadata(QString file);              //!< See QDropbox::metadata()
+    QDropboxReply *revisions(QString file, int max = 10); //!< See QDropbox::revisions()
+    QDropboxReply *sharedLink(QString file);            //!< See QDropbox::sharedLink()
+
+private:
+    QDropboxClient(QDropbox *dropbox, int id);
+    void takeResult(QDropboxReply *reply);
+
+    QDropbox          *_dropbox;
+    int                _id;
+    QDropbox::Priority _priority;
+    QDropbox::Error    _error;
+    QString            _errorText;
+
+    friend class QDropboxSession;
+};
+
+//! A connection to Dropbox shared by several threads
+/*!
+  QDropboxSession holds the credentials of an application and a user once and sends
+  the requests of any number of threads through a single QDropbox. That QDropbox lives
+  in a network thread of the session, so all requests share one QNetworkAccessManager
+  and its connections. The bookkeeping of requests is only touched by the network thread
+  and needs no locks, the threads hand their requests over and wait for their replies.
+
+  \code
+  QDropboxSession session(APP_KEY, APP_SECRET);
+  session.setToken(token, tokenSecret);
+
+  // on any thread of a worker pool
+  QDropboxClient client = session.client();
+  QDropboxFileInfo info = client.requestMetadataAndWait("/dropbox/photos");
+  if(client.error() != QDropbox::NoError)
+      handleError(client.errorString());
+  \endcode
+
+  The token is usually obtained by a QDropbox of its own (see QDropbox::requestToken()
+  and QDropbox::requestAccessToken()) and stored for later sessions.
+
+  All functions of QDropboxSession may be called by any thread. The session has to
+  outlive its clients.
+ */
+class QTDROPBOXSHARED_EXPORT QDropboxSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+      Creates a session and starts its network thread.
+
+      \param key API key of your application (provided by Dropbox)
+      \param sharedSecret Your app's secret (provided by Dropbox)
+      \param method Used authentication method
+      \param url URL of the API server
+      \param parent Parent object of the session
+     */
+    explicit QDropboxSession(QString key, QString sharedSecret,
+                             QDropbox::OAuthMethod method = QDropbox::Plaintext,
+                             QString url = "api.dropbox.com", QObject *parent = 0);
+
+    /*!
+      Stops the network thread. Pending requests are dropped.
+     */
+    ~QDropboxSession();
+
+    /*!
+      Sets the token and token secret of the user. Requests sent after this call use the
+      new token.
+     */
+    void setToken(QString token, QString tokenSecret);
+
+    /*!
+      Returns the token of the user.
+     */
+    QString token() const;
+
+    /*!
+      Returns the token secret of the user.
+     */
+    QString tokenSecret() const;
+
+    /*!
+      Returns a new client of the session. Copies of a client share its turn in the
+      queue of requests.
+     */
+    QDropboxClient client();
+
+private slots:
+    void dropboxTokenChanged(QString token, QString secret);
+
+private:
+    QDropbox      *_dropbox;
+    mutable QMutex _mutex;
+    QString        _token;
+    QString        _tokenSecret;
+    QAtomicInt     _clients;
+};
+
+#endif // QDROPBOXSESSION_H
@@ -4,7 +4,16 @@
 #include "qtdropbox_global.h"
 #include "qdropbox.h"
 #include "qdropboxjson.h"
+#include "qdropboxjsonarray.h"
+#include "qdropboxjsonstreamreader.h"
+#include "qdropboxjsonscanner.h"
+#include "qdropboxjsonwriter.h"
+#include "qdropboxjsonpath.h"
+#include "qdropboxjsonsnapshot.h"
 #include "qdropboxfile.h"
 #include "qdropboxfileinfo.h"
+#include "qdropboxdirectorylisting.h"
+#include "qdropboxreply.h"
+#include "qdropboxsession.h"
 
 #endif // QTDROPBOX_H
@@ -185,7 +185,7 @@ void QtDropboxTest::jsonCase13()
     QVERIFY2(json.getBool("testBool"), "setBool of json is incorrect");
 
     json.setString("testString", "10");
-    QVERIFY2(json.getString("testString").compare("10"), "setString of json is incorrect");
+    QVERIFY2(json.getString("testString").compare("10") == 0, "setString of json is incorrect");
 
     QDateTime time = QDateTime::currentDateTime();
     json.setTimestamp("testTimestamp", time);
@@ -215,6 +215,984 @@ void QtDropboxTest::jsonCase15()
 	     QString("curly brackets in string not parsed correctly [%1]").arg(json.getString("string")).toStdString().c_str());
 }
 
+/**
+ * @brief QDropboxJson: Escape sequences
+ * Verify that escaped quotes, backslashes and unicode escapes are decoded in values,
+ * keys and array items and that structural characters in nested strings are ignored.
+ */
+void QtDropboxTest::jsonCase16()
+{
+    QDropboxJson json("{\"quote\": \"a\\\"b\", \"back\\\\slash\": \"c:\\\\d\", "
+                      "\"unicode\": \"\\u00e4\\u20AC\", \"json\": {\"s\": \"}{,\\\"\"}, "
+                      "\"array\": [\"x\\\"]\", {\"k\": \"]\"}]}");
+    QVERIFY2(json.isValid(), "json with escape sequences could not be parsed");
+    QVERIFY2(json.getString("quote").compare("a\"b") == 0, "escaped quote not decoded");
+    QVERIFY2(json.getString("back\\slash").compare("c:\\d") == 0, "escaped backslash not decoded");
+    QVERIFY2(json.getString("unicode").compare(QString::fromUtf8("\xc3\xa4\xe2\x82\xac")) == 0,
+             "unicode escape not decoded");
+
+    QDropboxJson* subjson = json.getJson("json");
+    QVERIFY2(subjson != NULL, "subjson is null");
+    QVERIFY2(subjson->getString("s").compare("}{,\"") == 0, "structural characters in subjson string");
+
+    QStringList l = json.getArray("array");
+    QVERIFY2(l.size() == 2, "array list has wrong size");
+    QVERIFY2(l.at(0).compare("x\"]") == 0, "escaped string in array not decoded");
+}
+
+/**
+ * @brief QDropboxJson: Parsing UTF-8 data
+ * A JSON is parsed directly from a UTF-8 encoded buffer. Non-ASCII characters have to survive
+ * and the JSON has to stay valid after the original buffer was modified.
+ */
+void QtDropboxTest::jsonCase17()
+{
+    QByteArray data("{\"path\": \"/Fotos/K\xc3\xa4se.jpg\", \"bytes\": 1234}");
+    QDropboxJson json;
+    json.parseUtf8(data);
+    data.fill('x');
+
+    QVERIFY2(json.isValid(), "json validity");
+    QVERIFY2(json.getString("path").compare(QString::fromUtf8("/Fotos/K\xc3\xa4se.jpg")) == 0,
+             "UTF-8 string value does not match");
+    QVERIFY2(json.getInt("bytes") == 1234, "integer value does not match");
+}
+
+/**
+ * @brief QDropboxJson: 64 bit values
+ * Numbers are decoded once while parsing. Values beyond 32 bit, unsigned values beyond qint64
+ * and strings containing characters that need escaping have to be kept intact.
+ */
+void QtDropboxTest::jsonCase18()
+{
+    QDropboxJson json("{\"bytes\": 5368709120, \"neg\": -9223372036854775808, "
+                      "\"big\": 18446744073709551615, \"size\": 1.5e3, \"flag\": false}");
+    QVERIFY2(json.isValid(), "json validity");
+    QVERIFY2(json.type("bytes") == QDropboxJson::NumberType, "bytes is not a number");
+    QVERIFY2(json.getInt("bytes") == Q_INT64_C(5368709120), "64 bit integer does not match");
+    QVERIFY2(json.getUInt("bytes") == Q_UINT64_C(5368709120), "positive integer not returned as unsigned");
+    QVERIFY2(json.getInt("neg") == Q_INT64_C(-9223372036854775807) - 1, "negative integer does not match");
+    QVERIFY2(json.getUInt("neg") == 0, "negative integer returned as unsigned");
+    QVERIFY2(json.type("big") == QDropboxJson::UnsignedIntType, "big is not unsigned");
+    QVERIFY2(json.getUInt("big") == Q_UINT64_C(18446744073709551615), "unsigned integer does not match");
+    QVERIFY2(json.type("size") == QDropboxJson::FloatType, "size is not a float");
+    QVERIFY2(json.getDouble("size") == 1500.0, "float does not match");
+    QVERIFY2(json.type("flag") == QDropboxJson::BoolType && !json.getBool("flag"), "bool does not match");
+
+    json.setString("string", "a \"quoted\"\\path\n");
+    QDropboxJson copy(json);
+    QVERIFY2(copy.getString("string").compare("a \"quoted\"\\path\n") == 0, "escaped string does not match");
+    QVERIFY2(copy.compare(json) == 0, "copy does not match");
+}
+
+/**
+ * @brief QDropboxJson: shared document
+ * Sub JSONs are views of the document of their parent. Changes made through a sub JSON have to
+ * be visible in the parent and sub JSONs have to stay valid when the parent is modified.
+ */
+void QtDropboxTest::jsonCase19()
+{
+    QDropboxJson json("{\"quota_info\": {\"shared\": 1, \"inner\": {\"x\": [1, 2]}}, \"uid\": 7}");
+    QVERIFY2(json.isValid(), "json validity");
+
+    QDropboxJson *quota = json.getJson("quota_info");
+    QDropboxJson *inner = quota->getJson("inner");
+    QVERIFY2(quota != NULL && inner != NULL, "sub json not found");
+
+    quota->setUInt("normal", 2);
+    json.setString("email", "a@b.c");
+    QVERIFY2(json.getJson("quota_info") == quota, "sub json not reused");
+    QVERIFY2(json.getJson("quota_info")->getUInt("normal") == 2, "change of sub json not visible");
+    QVERIFY2(inner->getArray("x").size() == 2, "sub json invalid after modification of parent");
+
+    QDropboxJson copy(json.strContent());
+    QVERIFY2(copy.isValid(), "modified json could not be parsed again");
+    QVERIFY2(copy.compare(json) == 0, "modified json does not match");
+    QVERIFY2(copy.getJson("quota_info")->getUInt("shared") == 1, "unmodified value lost");
+
+    copy.setJson("copy", json);
+    QVERIFY2(copy.getJson("copy")->getJson("quota_info")->getUInt("normal") == 2, "setJson does not copy sub jsons");
+}
+
+/**
+ * @brief QDropboxJson: lazy sub jsons
+ * Nested objects and arrays are parsed when they are accessed. An invalid sub json does not
+ * affect the other values, only the sub json itself is invalid.
+ */
+void QtDropboxTest::jsonCase20()
+{
+    QDropboxJson json("{\"hash\": \"abc\", \"contents\": [{\"path\": \"/a\"}, {\"path\": \"/b\"}], "
+                      "\"broken\": {\"a\" 1}}");
+    QVERIFY2(json.isValid(), "json validity");
+    QVERIFY2(json.getString("hash").compare("abc") == 0, "value next to sub jsons does not match");
+    QVERIFY2(json.type("contents") == QDropboxJson::ArrayType, "array type not detected");
+
+    QDropboxJson *broken = json.getJson("broken");
+    QVERIFY2(broken != NULL && !broken->isValid(), "invalid sub json not detected");
+
+    QStringList contents = json.getArray("contents");
+    QVERIFY2(contents.size() == 2, "array size does not match");
+    QVERIFY2(QDropboxJson(contents.at(1)).getString("path").compare("/b") == 0, "array element does not match");
+
+    QDropboxFileInfo info("{\"is_dir\": true, \"hash\": \"abc\", \"contents\": [{\"path\": \"/a\"}]}");
+    QVERIFY2(info.contents().size() == 1, "contents not created on access");
+    QVERIFY2(info.contents().at(0).path().compare("/a") == 0, "contents do not match");
+}
+
+/**
+ * @brief QDropboxJson: typed arrays
+ * Elements of an array are returned as typed values that share the parsed JSON. Objects in
+ * an array can be used as QDropboxJson or QDropboxFileInfo directly.
+ */
+void QtDropboxTest::jsonCase21()
+{
+    QDropboxJson json("{\"numbers\": [1, -2, 3.5, true, \"x\", [4, 5]], "
+                      "\"files\": [{\"path\": \"/a\", \"bytes\": 10}, {\"path\": \"/b\"}], \"str\": \"y\"}");
+    QVERIFY2(json.isValid(), "json validity");
+
+    QDropboxJsonArray numbers = json.getJsonArray("numbers");
+    QVERIFY2(numbers.size() == 6, "array size does not match");
+    QVERIFY2(numbers.at(0).type() == QDropboxJson::NumberType && numbers.at(0).toInt() == 1, "int element does not match");
+    QVERIFY2(numbers.at(1).toInt() == -2 && numbers.at(1).toUInt() == 0, "negative element does not match");
+    QVERIFY2(numbers.at(2).toDouble() == 3.5 && numbers.at(2).toInt() == 0, "float element does not match");
+    QVERIFY2(numbers.at(3).toBool() && numbers.at(4).toString().compare("x") == 0, "bool or string element does not match");
+    QVERIFY2(numbers.at(5).toArray().size() == 2 && numbers.at(5).toArray().at(1).toInt() == 5, "nested array does not match");
+    QVERIFY2(json.getJsonArray("str").isEmpty() && json.getJsonArray("missing").isEmpty(), "non-array not empty");
+
+    qint64 sum = 0;
+    for(QDropboxJsonArray::const_iterator it = numbers.begin(); it != numbers.end(); ++it)
+        sum += (*it).toInt();
+    QVERIFY2(sum == -1, "iteration does not match");
+
+    QDropboxJsonArray files = json.getJsonArray("files");
+    QDropboxJson first(files.at(0));
+    QVERIFY2(first.isValid() && first.getUInt("bytes") == 10, "object element does not match");
+    QVERIFY2(!QDropboxJson(numbers.at(0)).isValid(), "value element used as json");
+
+    QDropboxFileInfo info(files.at(1));
+    QVERIFY2(info.isValid() && info.path().compare("/b") == 0, "file info from element does not match");
+
+    QDropboxJson anonymous("[\"a\", \"b\"]");
+    QVERIFY2(anonymous.getJsonArray().size() == 2 && anonymous.getJsonArray().at(1).toString().compare("b") == 0, "anonymous array does not match");
+}
+
+/**
+ * @brief QDropboxJson: stream reader
+ * A JSON is parsed chunk by chunk. Tokens split between chunks are reported once and
+ * captured objects are delivered as a whole.
+ */
+void QtDropboxTest::jsonCase22()
+{
+    class Recorder : public QDropboxJsonHandler
+    {
+    public:
+        Recorder() : reader(this) {}
+        void startObject() { log += "{"; if(reader.depth() == 3) reader.captureCurrent(); }
+        void endObject() { log += "}"; }
+        void startArray() { log += "["; }
+        void endArray() { log += "]"; }
+        void key(const QString &key) { log += key + ":"; }
+        void value(const QDropboxJsonValue &value) { log += value.toString(true) + ","; }
+        void captured(const QDropboxJsonValue &value) { log += "<" + QDropboxJson(value).getString("path") + ">"; }
+
+        QDropboxJsonStreamReader reader;
+        QString log;
+    };
+
+    QByteArray json("{\"a\": 1, \"b\\\"c\": [true, null, \"x\\u00e4\"], "
+                    "\"contents\": [{\"path\": \"/a\", \"n\": [1]}, {\"path\": \"/b}\"}]}");
+    QString expected = QString::fromUtf8("{a:1,b\"c:[true,null,x\xc3\xa4,]contents:[{</a>{</b}>]}");
+
+    Recorder whole;
+    QVERIFY2(whole.reader.addData(json) && whole.reader.finish(), "stream not complete");
+    QVERIFY2(whole.log == expected, "events do not match");
+
+    Recorder split;
+    for(int i=0; i<json.size(); ++i)
+        QVERIFY2(split.reader.addData(json.mid(i, 1)), "chunk rejected");
+    QVERIFY2(split.reader.finish(), "split stream not complete");
+    QVERIFY2(split.log == expected, "events of split stream do not match");
+
+    Recorder incomplete;
+    QVERIFY2(incomplete.reader.addData(json.left(json.size()-1)) && !incomplete.reader.finish(), "incomplete stream accepted");
+
+    Recorder invalid;
+    QVERIFY2(!invalid.reader.addData("{\"a\" 1}") && invalid.reader.hasError(), "invalid stream accepted");
+}
+
+/**
+ * @brief QDropboxJson: structural scanner
+ * All implementations of the scanner skip objects and arrays the same way, also if strings
+ * with brackets and escape sequences cross the blocks the scanner works on.
+ */
+void QtDropboxTest::jsonCase23()
+{
+    QByteArray json("{\"a\": [");
+    for(int i=0; i<50; ++i)
+        json += QString("{\"s\": \"%1\\\\\\\"]}\", \"n\": [%2]}, ").arg(QString(i, 'x')).arg(i).toUtf8();
+    json += "{}], \"b\": 1}";
+
+    for(int i=QDropboxJsonScanner::Scalar; i<=QDropboxJsonScanner::AVX2; ++i)
+    {
+        if(!QDropboxJsonScanner::setImplementation(QDropboxJsonScanner::Implementation(i)))
+            continue;
+
+        QDropboxJson parsed(json);
+        QVERIFY2(parsed.isValid() && parsed.getInt("b") == 1, "json validity");
+
+        QDropboxJsonArray a = parsed.getJsonArray("a");
+        QVERIFY2(a.size() == 51, "array size does not match");
+        QVERIFY2(QDropboxJson(a.at(49)).getString("s") == QString(49, 'x') + "\\\"]}", "string does not match");
+        QVERIFY2(!QDropboxJson("{\"a\": [1, {\"b\": \"]\"}").isValid(), "incomplete array accepted");
+    }
+
+    QDropboxJsonScanner::setImplementation(QDropboxJsonScanner::bestImplementation());
+}
+
+/**
+ * @brief QDropboxJson: interned keys
+ * Keys of the Dropbox API and other keys are found alike, also if they are escaped,
+ * added by a setter or compared between documents.
+ */
+void QtDropboxTest::jsonCase24()
+{
+    QVERIFY2(QDropboxJsonDocument::internKey("path", 4) != 0, "known key not interned");
+    QVERIFY2(QDropboxJsonDocument::internKey("path", 4) != QDropboxJsonDocument::internKey("size", 4), "ids not unique");
+    QVERIFY2(QDropboxJsonDocument::internKey("pat", 3) == 0 && QDropboxJsonDocument::internKey("paths", 5) == 0,
+             "unknown key interned");
+
+    QDropboxJson json("{\"p\\u0061th\": \"/a\", \"pat\": 1, \"size\": \"1 KB\", \"x-custom\": 2}");
+    QVERIFY2(json.isValid() && json.getString("path") == "/a" && json.getString("size") == "1 KB", "known keys not found");
+    QVERIFY2(json.getInt("pat") == 1 && json.getInt("x-custom") == 2, "unknown keys not found");
+    QVERIFY2(!json.hasKey("rev") && !json.hasKey("x-other"), "missing key found");
+
+    json.setString("rev", "abc");
+    json.setInt("custom", 3);
+    json.setString("path", "/b");
+    QVERIFY2(json.getString("rev") == "abc" && json.getInt("custom") == 3 && json.getString("path") == "/b",
+             "keys set by setters not found");
+
+    QDropboxJson copy(json.strContent());
+    QVERIFY2(copy.compare(json) == 0, "documents with interned keys differ");
+
+    QDropboxFileInfo info(QString("{\"path\": \"/c\", \"bytes\": 42, \"is_dir\": true}"));
+    QVERIFY2(info.path() == "/c" && info.bytes() == 42 && info.isDir(), "file info does not match");
+}
+
+/**
+ * @brief QDropboxJson: timestamps
+ * Timestamps in the format of RFC 2822 are read with their zone offset and written in UTC,
+ * invalid dates are rejected.
+ */
+void QtDropboxTest::jsonCase25()
+{
+    QDropboxJson json("{\"modified\": \"Sat, 21 Aug 2010 22:31:20 +0000\", \"offset\": \"Sun, 22 Aug 2010 00:01:20 +0130\", "
+                      "\"leap\": \"29 Feb 2012 12:00:00 -0130\", \"invalid\": \"Mon, 29 Feb 2010 22:31:20 +0000\", "
+                      "\"garbage\": \"Sat, 21 Aug 2010\", \"number\": 1}");
+    QDateTime expected(QDate(2010, 8, 21), QTime(22, 31, 20), Qt::UTC);
+    QVERIFY2(json.getTimestamp("modified") == expected, "timestamp does not match");
+    QVERIFY2(json.getTimestamp("offset") == expected, "timestamp with offset does not match");
+    QVERIFY2(json.getTimestamp("leap") == QDateTime(QDate(2012, 2, 29), QTime(13, 30, 0), Qt::UTC), "leap day does not match");
+    QVERIFY2(!json.getTimestamp("invalid").isValid() && !json.getTimestamp("garbage").isValid() &&
+             !json.getTimestamp("number", true).isValid(), "invalid timestamp accepted");
+
+    json.setTimestamp("modified", expected.addDays(10));
+    QVERIFY2(json.getString("modified") == "Tue, 31 Aug 2010 22:31:20 +0000", "written timestamp does not match");
+
+    QDateTime beforeEpoch(QDate(1969, 12, 31), QTime(23, 59, 59), Qt::UTC);
+    json.setTimestamp("modified", beforeEpoch);
+    QVERIFY2(json.getString("modified") == "Wed, 31 Dec 1969 23:59:59 +0000", "timestamp before 1970 does not match");
+    QVERIFY2(json.getTimestamp("modified") == beforeEpoch, "timestamp before 1970 not read back");
+}
+
+/**
+ * @brief QDropboxJson: implicit sharing
+ * Copies share the document until either of them is modified. Changes of a copy are not
+ * visible in the original, while sub JSONs still follow their parent.
+ */
+void QtDropboxTest::jsonCase26()
+{
+    QDropboxJson json("{\"a\": 1, \"sub\": {\"b\": 2}}");
+    QDropboxJson *sub = json.getJson("sub");
+
+    QDropboxJson copy(json);
+    QVERIFY2(copy.compare(json) == 0 && copy.getJson("sub")->getInt("b") == 2, "copy does not match");
+
+    copy.setInt("a", 3);
+    copy.getJson("sub")->setInt("b", 4);
+    QVERIFY2(json.getInt("a") == 1 && sub->getInt("b") == 2, "modification of copy visible in original");
+    QVERIFY2(copy.getInt("a") == 3 && copy.getJson("sub")->getInt("b") == 4, "modification of copy lost");
+
+    QDropboxJson shared(json);
+    sub->setInt("c", 5);
+    QVERIFY2(json.getJson("sub")->getInt("c") == 5, "modification of sub json not visible in parent");
+    QVERIFY2(!shared.getJson("sub")->hasKey("c"), "modification of sub json visible in copy");
+
+#ifdef Q_COMPILER_RVALUE_REFS
+    QDropboxJson moved(std::move(copy));
+    QVERIFY2(moved.getInt("a") == 3 && moved.getJson("sub")->getInt("b") == 4, "moved json does not match");
+    copy = std::move(moved);
+    QVERIFY2(copy.getInt("a") == 3, "move assigned json does not match");
+#endif
+
+    QList<QDropboxFileInfo> list;
+    QDropboxFileInfo info(QString("{\"path\": \"/a\", \"bytes\": 1}"));
+    list.append(info);
+    QVERIFY2(list.at(0).path() == "/a" && list.at(0).strContent() == info.strContent(), "copied file info does not match");
+
+    QDropboxAccount account(QString("{\"referral_link\": \"https://db.tt/x\", \"display_name\": \"A\", \"uid\": 1, "
+                                     "\"country\": \"DE\", \"email\": \"a@b.c\", "
+                                     "\"quota_info\": {\"shared\": 1, \"quota\": 2, \"normal\": 3}}"));
+    QDropboxAccount accountCopy(account);
+    QVERIFY2(accountCopy.isValid() && accountCopy.quota() == 2 && accountCopy.hasKey("email"), "copied account does not match");
+}
+
+/**
+ * @brief QDropboxJson: writer
+ * The compact format keeps the source without whitespace, the canonical format writes equal
+ * JSONs as equal bytes. Strings are escaped and written to a device in chunks.
+ */
+void QtDropboxTest::jsonCase27()
+{
+    QDropboxJson json("{ \"b\" : [1, 2, {\"c\" : \"x y\"}], \"a\":1 }");
+    QDropboxJsonWriter writer;
+    QVERIFY2(writer.write(json) == "{\"b\":[1,2,{\"c\":\"x y\"}],\"a\":1}", "compact output does not match");
+    QVERIFY2(json.strContent() == "{\"b\":[1,2,{\"c\":\"x y\"}],\"a\":1}", "content does not match");
+
+    QDropboxJsonWriter canonical(QDropboxJsonWriter::Canonical);
+    QDropboxJson escaped("{\"b\": \"\\u0041\", \"a\": 1, \"a\": 2}");
+    QDropboxJson plain("{\"a\":2,\"b\":\"A\"}");
+    QVERIFY2(canonical.write(escaped) == "{\"a\":2,\"b\":\"A\"}", "canonical output does not match");
+    QVERIFY2(canonical.write(escaped) == canonical.write(plain), "canonical outputs differ");
+
+    // sources that are no valid JSON are not copied
+    QDropboxJson literals("{\"a\": [1, foo, null], \"b\": {\"c\": bar}, \"d\": [1 2], \"e\": baz}");
+    QVERIFY2(writer.write(literals) == "{\"a\":[1,null,null],\"b\":{\"c\":null},\"d\":[],\"e\":null}",
+             "invalid source copied");
+
+    QString special = QString("q\"b\\n\nc") + QChar(1);
+    json.setString("s", special);
+    QByteArray bytes = writer.write(json);
+    QVERIFY2(bytes.contains("\"s\":\"q\\\"b\\\\n\\nc\\u0001\""), "string not escaped");
+    QDropboxJson parsed(QString::fromUtf8(bytes));
+    QVERIFY2(parsed.isValid() && parsed.getString("s") == special && parsed.getInt("a") == 1,
+             "written json not parsed back");
+
+    json.setString("long", QString(20000, QChar('x')));
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QVERIFY2(writer.write(json, &buffer), "writing to device failed");
+    QVERIFY2(buffer.data() == writer.write(json), "device output does not match");
+}
+
+/**
+ * @brief QDropboxJson: path queries
+ * Compiled paths select nested values by keys and array indices, [*] selects every element.
+ * Malformed paths are rejected.
+ */
+void QtDropboxTest::jsonCase28()
+{
+    QDropboxJson json("{\"quota_info\": {\"shared\": 5, \"quota\": 10}, \"path\": \"/\", "
+                      "\"contents\": [{\"rev\": \"a1\", \"x-y\": 1}, {\"bytes\": 2}, {\"rev\": \"b2\", \"x-y\": 3}]}");
+
+    QVERIFY2(QDropboxJsonPath("quota_info.shared").value(json).toUInt() == 5, "nested value does not match");
+    QVERIFY2(QDropboxJsonPath("contents[2].rev").value(json).toString() == "b2", "array element does not match");
+    QVERIFY2(QDropboxJsonPath("contents[2].x-y").value(json).toInt() == 3, "unknown key does not match");
+    QVERIFY2(!QDropboxJsonPath("contents[3].rev").value(json).isValid() &&
+             !QDropboxJsonPath("path.rev").value(json).isValid(), "missing value selected");
+
+    QDropboxJsonPath revs("contents[*].rev");
+    QList<QDropboxJsonValue> list = revs.values(json);
+    QVERIFY2(list.size() == 2 && list.at(0).toString() == "a1" && list.at(1).toString() == "b2",
+             "selected values do not match");
+    QVERIFY2(revs.value(json).toString() == "a1", "first selected value does not match");
+
+    QDropboxJsonPath rev("rev");
+    QDropboxJsonArray contents = json.getJsonArray("contents");
+    QVERIFY2(rev.value(contents.at(0)).toString() == "a1" && !rev.value(contents.at(1)).isValid(),
+             "relative path does not match");
+
+    QDropboxJson other("{\"quota_info\": {\"shared\": 7}}");
+    QDropboxJsonPath shared("quota_info.shared");
+    QVERIFY2(shared.value(other).toInt() == 7 && shared.value(json).toInt() == 5, "path not reusable");
+
+    QVERIFY2(QDropboxJsonPath().isValid() && QDropboxJsonPath("").value(json).type() == QDropboxJson::JsonType,
+             "empty path does not select the json");
+    QVERIFY2(!QDropboxJsonPath("a..b").isValid() && !QDropboxJsonPath("a[").isValid() &&
+             !QDropboxJsonPath("a[x]").isValid() && !QDropboxJsonPath("a[]").isValid() &&
+             !QDropboxJsonPath(".a").isValid() && !QDropboxJsonPath("a[0]b").isValid(), "malformed path accepted");
+}
+
+/**
+ * @brief QDropboxJson: structural hash and diff
+ * Equal JSONs have equal hashes regardless of key order and formatting, diff() lists
+ * changed keys and array elements.
+ */
+void QtDropboxTest::jsonCase29()
+{
+    QDropboxJson a("{\"path\": \"/\", \"hash\": \"h1\", \"quota_info\": {\"shared\": 1, \"quota\": 2}, "
+                   "\"contents\": [{\"path\": \"/a\", \"rev\": \"1\"}, {\"path\": \"/b\", \"rev\": \"1\"}]}");
+    QDropboxJson b("{\"contents\": [ {\"rev\": \"1\", \"path\": \"/a\"}, {\"path\": \"/b\", \"rev\": \"1\"} ], "
+                   "\"quota_info\": {\"quota\": 2, \"shared\": 1}, \"hash\": \"h1\", \"path\": \"\\/\"}");
+    QVERIFY2(a.hash() == b.hash() && a.compare(b) == 0, "equal jsons differ");
+    QVERIFY2(a.diff(b).isEmpty(), "diff of equal jsons not empty");
+
+    QDropboxJson c("{\"path\": \"/\", \"hash\": \"h2\", \"quota_info\": {\"shared\": 1, \"quota\": 3}, \"is_dir\": true, "
+                   "\"contents\": [{\"path\": \"/b\", \"rev\": \"1\"}, {\"path\": \"/a\", \"rev\": \"2\"}]}");
+    QVERIFY2(a.hash() != c.hash() && a.compare(c) != 0, "different jsons equal");
+
+    QList<QDropboxJsonChange> changes = a.diff(c);
+    QStringList list;
+    for(QList<QDropboxJsonChange>::const_iterator it = changes.constBegin(); it != changes.constEnd(); ++it)
+        list.append(QString::number(int(it->type)) + ":" + it->path);
+    QVERIFY2(list.join(",") == "2:hash,2:quota_info.quota,1:contents[0],0:contents[1],0:is_dir",
+             "diff does not match");
+
+    QDropboxJson d("{\"n\": 1, \"f\": 0.0, \"a\": [1, 2]}");
+    QDropboxJson e("{\"a\": [2, 1], \"f\": -0.0, \"n\": 1}");
+    e.setUInt("n", 1);
+    QVERIFY2(d.getJsonArray("a").size() == 2 && d.hash() != e.hash(), "array order ignored");
+    e.setJson("a", QDropboxJson("[1, 2]"));
+    QVERIFY2(d.hash() == e.hash() && d.compare(e) == 0, "hash not updated after modification");
+}
+
+/**
+ * @brief QDropboxJson: snapshots
+ * Snapshots are loaded without parsing, from memory, a mapped file or a QDataStream.
+ * Snapshots of other versions and corrupted snapshots are rejected.
+ */
+void QtDropboxTest::jsonCase30()
+{
+    QDropboxJson json("{\"path\": \"/\", \"is_dir\": true, \"hash\": \"h\\u00e4\", \"contents\": ["
+                      "{\"path\": \"/a\", \"bytes\": 1, \"modified\": \"Sat, 21 Aug 2010 22:31:20 +0000\"}, "
+                      "{\"path\": \"/b\", \"bytes\": 2}]}");
+    QVERIFY2(json.getJsonArray("contents").size() == 2, "contents not parsed");
+
+    QByteArray data = QDropboxJsonSnapshot::save(json);
+    QDropboxJson loaded;
+    QVERIFY2(QDropboxJsonSnapshot::load(data, &loaded) && loaded.isValid(), "snapshot not loaded");
+    QVERIFY2(loaded.compare(json) == 0 && loaded.getString("hash") == json.getString("hash"), "loaded json does not match");
+    QVERIFY2(QDropboxFileInfo(loaded.getJsonArray("contents").at(1)).bytes() == 2, "loaded contents do not match");
+
+    loaded.setString("path", "/x");
+    QVERIFY2(loaded.getString("path") == "/x" && json.getString("path") == "/", "loaded json not modifiable");
+
+    QByteArray streamed;
+    QDataStream out(&streamed, QIODevice::WriteOnly);
+    out << QDropboxFileInfo(json) << loaded;
+    QDataStream in(streamed);
+    QDropboxFileInfo info;
+    QDropboxJson copy;
+    in >> info >> copy;
+    QVERIFY2(in.status() == QDataStream::Ok && info.isDir() && info.contents().size() == 2 &&
+             copy.getString("path") == "/x", "streamed json does not match");
+
+    QTemporaryFile file;
+    QVERIFY2(file.open() && QDropboxJsonSnapshot::save(json, &file), "snapshot not written");
+    file.close();
+    QDropboxFileInfo mapped;
+    QVERIFY2(QDropboxJsonSnapshot::load(file.fileName(), &mapped) && mapped.isDir() && mapped.compare(json) == 0,
+             "mapped snapshot does not match");
+
+    QByteArray corrupt = data;
+    corrupt[4] = char(0x7F);
+    QVERIFY2(!QDropboxJsonSnapshot::load(corrupt, &loaded) && !loaded.isValid(), "snapshot of another version loaded");
+    QVERIFY2(!QDropboxJsonSnapshot::load(data.left(data.size()-1), &loaded), "truncated snapshot loaded");
+
+    corrupt = data;
+    qdropboxjson_node root;
+    memcpy(&root, corrupt.constData() + sizeof(qdropboxjson_snapshot_header), sizeof(root));
+    root.value.children.count = 1000;
+    memcpy(corrupt.data() + sizeof(qdropboxjson_snapshot_header), &root, sizeof(root));
+    QVERIFY2(!QDropboxJsonSnapshot::load(corrupt, &loaded), "corrupted snapshot loaded");
+}
+
+/**
+ * @brief QDropboxFileInfo: large directory listing
+ * The contents of large directories are created by several threads and stitched
+ * together in the order of the listing.
+ */
+void QtDropboxTest::jsonCase31()
+{
+    QByteArray listing("{\"path\": \"/big\", \"is_dir\": true, \"contents\": [");
+    for(int i=0; i<5000; ++i)
+    {
+        if(i > 0)
+            listing.append(", ");
+        listing.append("{\"path\": \"/big/f" + QByteArray::number(i) + (i%7 == 0 ? "\\u00e4" : "") +
+                       "\", \"bytes\": " + QByteArray::number(i) + ", \"is_dir\": false}");
+    }
+    listing.append("]}");
+
+    QDropboxFileInfo info(QString::fromUtf8(listing));
+    QList<QDropboxFileInfo> contents = info.contents();
+    QVERIFY2(contents.size() == 5000, "number of entries does not match");
+
+    bool ordered = true;
+    for(int i=0; i<contents.size() && ordered; ++i)
+    {
+        const QString path = QString("/big/f%1").arg(i) + (i%7 == 0 ? QString::fromUtf8("\xc3\xa4") : QString());
+        ordered = contents.at(i).path() == path && contents.at(i).bytes() == quint64(i);
+    }
+    QVERIFY2(ordered, "entries do not match");
+
+    QDropboxJsonArray array = info.getJsonArray("contents");
+    QDropboxJsonArray range = array.mid(4998);
+    QVERIFY2(range.size() == 2 && QDropboxFileInfo(range.at(1)).bytes() == 4999, "range does not match");
+    QVERIFY2(QDropboxFileInfo(array.mid(7, 1).at(0)).path() == contents.at(7).path(),
+             "decoded string in range does not match");
+    QVERIFY2(array.mid(5001).isEmpty() && QDropboxJsonArray().mid(0).isEmpty(), "invalid range not empty");
+}
+
+//! Lists a directory the way a thread sharing the metadata with others would
+static int countEntries(const QDropboxFileInfo *info)
+{
+    return info->contents().size();
+}
+
+/**
+ * @brief QDropboxFileInfo: copies keep the listing
+ * Lists a directory (as the parser threads of QDropbox do) and checks that copies
+ * of the metadata keep the listing after the original was destroyed.
+ */
+void QtDropboxTest::jsonCase32()
+{
+    QDropboxFileInfo *parsed = new QDropboxFileInfo(QString(
+        "{\"path\": \"/dir\", \"is_dir\": true, \"contents\": ["
+        "{\"path\": \"/dir/a\", \"bytes\": 1}, {\"path\": \"/dir/b\", \"bytes\": 2}]}"));
+    QVERIFY2(parsed->contents().size() == 2, "listing not created");
+
+    QDropboxFileInfo copy(*parsed);
+    QDropboxFileInfo assigned;
+    assigned = *parsed;
+    delete parsed;
+
+    QVERIFY2(copy.contents().size() == 2 && copy.contents().at(1).path() == "/dir/b", "copied listing does not match");
+    QVERIFY2(assigned.contents().size() == 2 && assigned.contents().at(0).bytes() == 1, "assigned listing does not match");
+
+    // threads listing the same frozen metadata at once share one listing
+    QDropboxFileInfo shared(QString(
+        "{\"path\": \"/dir\", \"is_dir\": true, \"contents\": ["
+        "{\"path\": \"/dir/a\", \"bytes\": 1}, {\"path\": \"/dir/b\", \"bytes\": 2}]}"));
+    shared.freeze();
+    QList<const QDropboxFileInfo*> readers;
+    for(int i = 0; i < 8; ++i)
+        readers.append(&shared);
+    const QList<int> sizes = QtConcurrent::blockingMapped<QList<int> >(readers, countEntries);
+    for(int i = 0; i < sizes.size(); ++i)
+        QVERIFY2(sizes.at(i) == 2, "listing differs between threads");
+}
+
+/**
+ * @brief QDropboxDirectoryListing: column wise listing
+ * Creates a listing from metadata, reads entries and sorts it by several columns.
+ */
+void QtDropboxTest::jsonCase33()
+{
+    QDropboxFileInfo dir(QString(
+        "{\"path\": \"/dir\", \"is_dir\": true, \"contents\": ["
+        "{\"path\": \"/dir/b.txt\", \"bytes\": 300, \"size\": \"300 bytes\", \"rev\": \"2a\", \"revision\": 42,"
+        " \"mime_type\": \"text/plain\", \"icon\": \"page_white\", \"root\": \"dropbox\","
+        " \"modified\": \"Sat, 21 Aug 2010 22:31:20 +0000\", \"is_dir\": false},"
+        "{\"path\": \"/dir/A\", \"bytes\": 0, \"size\": \"0 bytes\", \"rev\": \"2b\", \"revision\": 43,"
+        " \"icon\": \"folder\", \"root\": \"dropbox\", \"is_dir\": true},"
+        "{\"path\": \"/dir/c.txt\", \"bytes\": 300, \"size\": \"300 bytes\", \"rev\": \"29\", \"revision\": 41,"
+        " \"mime_type\": \"text/plain\", \"icon\": \"page_white\", \"root\": \"dropbox\","
+        " \"modified\": \"Sun, 22 Aug 2010 22:31:20 +0000\", \"is_deleted\": true}]}"));
+
+    QDropboxDirectoryListing listing(dir);
+    QVERIFY2(listing.size() == 3, "number of entries does not match");
+
+    QDropboxDirectoryListing::Entry b = listing.at(0);
+    QVERIFY2(b.path() == "/dir/b.txt" && b.bytes() == 300 && b.size() == "300 bytes", "entry does not match");
+    QVERIFY2(b.revision() == 42 && b.revisionHash() == "2a" && b.mimeType() == "text/plain", "revision does not match");
+    QVERIFY2(b.modified() == QDateTime(QDate(2010, 8, 21), QTime(22, 31, 20), Qt::UTC), "timestamp does not match");
+    QVERIFY2(!b.isDir() && listing.at(1).isDir() && listing.at(2).isDeleted(), "flags do not match");
+    QVERIFY2(!listing.at(1).modified().isValid() && listing.at(1).mimeType().isEmpty(), "missing fields not empty");
+    QVERIFY2(listing.indexOf("/DIR/a") == 1 && listing.indexOf("/dir/d") == -1, "entry not found by path");
+
+    listing.sort(QDropboxDirectoryListing::SortByPath);
+    QVERIFY2(listing.at(0).path() == "/dir/A" && listing.at(2).path() == "/dir/c.txt", "not sorted by path");
+    QVERIFY2(listing.at(0).isDir() && listing.at(2).isDeleted() && listing.at(1).revision() == 42,
+             "columns not sorted along");
+
+    // equal sizes keep the order of the path
+    listing.sort(QDropboxDirectoryListing::SortByBytes, Qt::DescendingOrder);
+    QVERIFY2(listing.at(0).path() == "/dir/b.txt" && listing.at(1).path() == "/dir/c.txt" && listing.at(2).bytes() == 0,
+             "not sorted by size");
+
+    QDropboxDirectoryListing appended;
+    for(QDropboxDirectoryListing::const_iterator it = listing.begin(); it != listing.end(); ++it)
+        QVERIFY2((*it).icon() != "", "icon missing");
+    appended.append(QDropboxFileInfo(dir.getJsonArray("contents").at(2)));
+    QVERIFY2(appended.size() == 1 && appended.at(0).path() == "/dir/c.txt", "appended entry does not match");
+    QVERIFY2(QDropboxDirectoryListing(QDropboxFileInfo(dir.getJsonArray("contents").at(0))).isEmpty(),
+             "file has a listing");
+}
+
+/**
+ * @brief QDropboxFileInfo/QDropboxAccount: slim values
+ * Decoded fields are shared by copies, moved values leave an empty one behind and
+ * the fields survive releasing the JSON.
+ */
+void QtDropboxTest::jsonCase34()
+{
+    QDropboxFileInfo dir(QString("{\"path\": \"/dir\", \"is_dir\": true, \"rev\": \"1f\", "
+                                 "\"modified\": \"Sat, 21 Aug 2010 22:31:20 +0000\", "
+                                 "\"contents\": [{\"path\": \"/dir/a\", \"bytes\": 7}]}"));
+    QDropboxFileInfo entry = dir.contents().at(0);
+
+    const QDropboxFileInfo constCopy(dir);
+    QVERIFY2(constCopy.modified() == dir.modified() && constCopy.modified().isValid(), "timestamp not shared");
+
+    entry.releaseJson();
+    QVERIFY2(entry.isValid() && entry.path() == "/dir/a" && entry.bytes() == 7, "fields lost with the json");
+    QVERIFY2(!entry.hasKey("path") && entry.contents().isEmpty(), "json not released");
+
+    QList<QDropboxFileInfo> cache;
+    cache.append(entry);
+    entry = QDropboxFileInfo();
+    QVERIFY2(cache.at(0).path() == "/dir/a" && entry.path().isEmpty(), "cached entry does not match");
+
+#ifdef Q_COMPILER_RVALUE_REFS
+    QDropboxFileInfo moved(std::move(dir));
+    QVERIFY2(moved.revisionHash() == "1f" && moved.contents().size() == 1, "moved file info does not match");
+    QVERIFY2(dir.revisionHash().isEmpty() && !dir.isDir(), "moved from file info not empty");
+#endif
+
+    QDropboxAccount account;
+    account = QDropboxAccount(QString("{\"referral_link\": \"https://db.tt/x\", \"display_name\": \"A\", "
+                                      "\"uid\": 1, \"country\": \"DE\", \"email\": \"a@b.c\", "
+                                      "\"quota_info\": {\"shared\": 1, \"quota\": 2, \"normal\": 3}}"));
+    account.releaseJson();
+    QVERIFY2(account.isValid() && account.email() == "a@b.c" && account.quotaNormal() == 3, "account fields lost");
+    QVERIFY2(!account.hasKey("email"), "account json not released");
+}
+
+/**
+ * @brief QDropboxRequestTable: bounded bookkeeping
+ * Slots of removed requests are reused, the table only grows with the requests in flight
+ * and IDs of removed requests stay invalid.
+ */
+void QtDropboxTest::requestCase1()
+{
+    QDropboxRequestTable table;
+    qdropbox_request request;
+    request.type   = QDROPBOX_REQ_METADAT;
+    request.method = "GET";
+    request.linked = 0;
+
+    // the replies are only used as keys, they are never dereferenced
+    QNetworkReply *first  = reinterpret_cast<QNetworkReply*>(quintptr(0x10));
+    QNetworkReply *second = reinterpret_cast<QNetworkReply*>(quintptr(0x20));
+
+    int old = table.insert(first, request);
+    QVERIFY2(old > 0 && table.contains(old), "request not inserted");
+    QVERIFY2(table.id(first) == old && table.reply(old) == first, "reply not mapped");
+    QVERIFY2(table.value(old).type == QDROPBOX_REQ_METADAT, "wrong request");
+
+    table.releaseReply(first);
+    QVERIFY2(table.id(first) == 0 && table.reply(old) == NULL && table.contains(old),
+             "released reply still mapped");
+    table.remove(old);
+    QVERIFY2(!table.contains(old) && table.value(old).type == 0, "removed request found");
+
+    for(int i = 0; i < 10000; ++i)
+    {
+        int nr = table.insert(second, request);
+        QVERIFY2(nr > 0 && nr != old, "ID of a removed request reused");
+        table.setType(nr, QDROPBOX_REQ_ACCINFO);
+        table.remove(nr);
+    }
+    table.setType(old, QDROPBOX_REQ_SHRDLNK);
+    QVERIFY2(!table.contains(old), "stale ID modified a request");
+
+    qdropbox_request_statistics statistics = table.statistics();
+    QVERIFY2(statistics.inFlight == 0, "requests left in flight");
+    QVERIFY2(statistics.capacity == 1, "table grew without requests in flight");
+    QVERIFY2(statistics.total == 10001, "wrong number of requests");
+}
+
+/**
+ * @brief QDropboxRequestScheduler: priorities and fairness
+ * Higher priorities are sent first, callers of a priority take turns and hosts never get
+ * more requests than their limit, except for the connection kept free for the first lane.
+ */
+void QtDropboxTest::requestCase2()
+{
+    QDropboxRequestScheduler scheduler;
+    scheduler.setMaxRunning("api.dropbox.com", 3);
+
+    qdropbox_pending_request request;
+    request.method = "GET";
+    request.host   = "api.dropbox.com";
+
+    // caller 1 queues a batch, caller 2 a single request
+    for(int i = 1; i <= 4; ++i)
+    {
+        request.nr = i;
+        scheduler.enqueue(request, QDropbox::NormalPriority, 1);
+    }
+    request.nr = 5;
+    scheduler.enqueue(request, QDropbox::NormalPriority, 2);
+    request.nr = 6;
+    scheduler.enqueue(request, QDropbox::BackgroundPriority, 1);
+    QVERIFY2(scheduler.queued() == 6, "wrong number of queued requests");
+    QVERIFY2(scheduler.queued(QDropbox::NormalPriority) == 5, "wrong number of queued requests");
+
+    qdropbox_pending_request next;
+    QVERIFY2(scheduler.takeNext(&next) && next.nr == 1, "first request not sent first");
+    QVERIFY2(scheduler.takeNext(&next) && next.nr == 5, "callers did not take turns");
+    QVERIFY2(!scheduler.takeNext(&next), "connection for interactive requests used");
+    QVERIFY2(scheduler.running("api.dropbox.com") == 2, "wrong number of running requests");
+
+    request.nr = 7;
+    scheduler.enqueue(request, QDropbox::InteractivePriority, 2);
+    QVERIFY2(scheduler.takeNext(&next) && next.nr == 7, "interactive request not sent");
+    QVERIFY2(!scheduler.takeNext(&next), "host limit exceeded");
+
+    // other hosts are not limited by a busy host
+    request.nr   = 8;
+    request.host = "api-content.dropbox.com";
+    scheduler.enqueue(request, QDropbox::NormalPriority, 2);
+    QVERIFY2(scheduler.takeNext(&next) && next.nr == 8, "request of another host blocked");
+    scheduler.finished("api-content.dropbox.com");
+
+    scheduler.finished("api.dropbox.com");
+    scheduler.finished("api.dropbox.com");
+    scheduler.finished("api.dropbox.com");
+    QVERIFY2(scheduler.takeNext(&next) && next.nr == 2, "order of a caller changed");
+    QVERIFY2(scheduler.takeNext(&next) && next.nr == 3, "order of a caller changed");
+    scheduler.finished("api.dropbox.com");
+    scheduler.finished("api.dropbox.com");
+    QVERIFY2(scheduler.takeNext(&next) && next.nr == 4, "order of a caller changed");
+    QVERIFY2(scheduler.takeNext(&next) && next.nr == 6, "background request not sent last");
+    QVERIFY2(scheduler.queued() == 0, "requests left in queue");
+}
+
+/**
+ * @brief QDropboxRateLimiter: token bucket, AIMD and backoff
+ * Bursts are limited, the rate is halved once per overload and raised again by successful
+ * responses, Retry-After pauses all requests and retries back off exponentially.
+ */
+void QtDropboxTest::requestCase3()
+{
+    QDropboxRateLimiter limiter;
+    limiter.setMaxRate(10);
+    limiter.setBurst(2);
+
+    // a burst is sent at once, then one request every 100 ms
+    QVERIFY2(limiter.waitTime(0) == 0, "burst limited");
+    limiter.acquire(0);
+    QVERIFY2(limiter.waitTime(0) == 0, "burst limited");
+    limiter.acquire(0);
+    qint64 wait = limiter.waitTime(0);
+    QVERIFY2(wait > 0 && wait <= 101, "rate not limited");
+    QVERIFY2(limiter.waitTime(100) == 0, "token not refilled");
+    limiter.acquire(100);
+
+    limiter.throttled(200);
+    limiter.throttled(300);
+    QVERIFY2(limiter.rate() == 5, "rate not halved once");
+    limiter.succeeded();
+    QVERIFY2(limiter.rate() > 5 && limiter.rate() < 10, "rate not raised");
+    for(int i = 0; i < 1000; ++i)
+        limiter.succeeded();
+    QVERIFY2(limiter.rate() == 10, "rate above the limit");
+
+    limiter.pause(5000);
+    QVERIFY2(limiter.waitTime(1000) == 4000, "pause ignored");
+    QVERIFY2(limiter.waitTime(5000) > 0, "burst sent after a pause");
+    QVERIFY2(limiter.waitTime(5100) == 0, "no request after a pause");
+
+    for(int attempt = 0; attempt < 10; ++attempt)
+    {
+        const qint64 delay = QDropboxRateLimiter::retryDelay(attempt);
+        const qint64 limit = qMin(qint64(500) << attempt, qint64(32000));
+        QVERIFY2(delay >= limit/2 && delay <= limit, "backoff out of range");
+    }
+
+    const qint64 date = Q_INT64_C(1445412480000);
+    QVERIFY2(QDropboxRateLimiter::retryAfter("120", 0) == 120000, "seconds not parsed");
+    QVERIFY2(QDropboxRateLimiter::retryAfter("Wed, 21 Oct 2015 07:28:00 GMT", date - 3000) == 3000,
+             "HTTP date not parsed");
+    QVERIFY2(QDropboxRateLimiter::retryAfter("Wed, 21 Oct 2015 07:28:00 GMT", date + 3000) == 0,
+             "past date not sent right away");
+    QVERIFY2(QDropboxRateLimiter::retryAfter("soon", 0) == -1, "invalid value accepted");
+}
+
+//! Reads a listing the way a receiver of QDropbox::fileInfoReceived() would
+static int readListing(const QDropboxJson &json)
+{
+    int found = 0;
+    QDropboxJsonArray contents = json.getJsonArray("contents");
+    for(QDropboxJsonArray::const_iterator it = contents.begin(); it != contents.end(); ++it)
+    {
+        QDropboxJson entry(*it);
+        if(entry.getString("path").startsWith("/dir/") && entry.hash() != 0)
+            ++found;
+    }
+    return found;
+}
+
+/**
+ * @brief QDropboxJson: frozen documents
+ * A frozen JSON is parsed completely, so copies of it can be read by several threads at the
+ * same time. Modifying a copy does not affect the others.
+ */
+void QtDropboxTest::jsonCase35()
+{
+    QByteArray data("{\"path\": \"/dir\", \"is_dir\": true, \"contents\": [");
+    for(int i = 0; i < 200; ++i)
+    {
+        if(i > 0)
+            data += ", ";
+        data += "{\"path\": \"/dir/" + QByteArray::number(i) + "\", \"photo_info\": {\"lat_long\": [1.5, 2.5]}}";
+    }
+    data += "]}";
+
+    QDropboxJson json;
+    json.parseUtf8(data);
+    QVERIFY2(json.isValid(), "json invalid");
+    json.freeze();
+
+    QList<QDropboxJson> copies;
+    for(int i = 0; i < 8; ++i)
+        copies.append(json);
+    const QList<int> found = QtConcurrent::blockingMapped<QList<int> >(copies, readListing);
+    for(int i = 0; i < found.size(); ++i)
+        QVERIFY2(found.at(i) == 200, "entries missing in a thread");
+
+    QDropboxJson copy(json);
+    copy.setString("path", "/other");
+    QVERIFY2(json.getString("path") == "/dir" && copy.getString("path") == "/other",
+             "modification of a frozen copy shared");
+    QVERIFY2(readListing(copy) == 200, "contents lost by modification");
+}
+
+/**
+ * @brief QDropboxJson: duplicated keys in hash and diff
+ * Only the last of duplicated keys counts, like for the getters. Large objects are diffed
+ * key by key.
+ */
+void QtDropboxTest::jsonCase36()
+{
+    QDropboxJson a("{\"a\": 1, \"a\": 2, \"b\": 3}");
+    QDropboxJson b("{\"b\": 3, \"a\": 2}");
+    QVERIFY2(a.hash() == b.hash() && a.compare(b) == 0, "shadowed key hashed");
+    QVERIFY2(a.diff(b).isEmpty() && b.diff(a).isEmpty(), "diff of equal jsons not empty");
+
+    QDropboxJson c("{\"a\": 2, \"a\": 1}");
+    QDropboxJson d("{\"a\": 2}");
+    QList<QDropboxJsonChange> changes = c.diff(d);
+    QVERIFY2(c.hash() != d.hash() && changes.size() == 1 && changes.first().type == QDropboxJsonChange::Modified
+             && changes.first().path == "a", "last key not compared");
+
+    QByteArray data("{");
+    for(int i = 0; i < 1000; ++i)
+        data += (i > 0 ? ", \"k" : "\"k") + QByteArray::number(i) + "\": " + QByteArray::number(i);
+    data += "}";
+    QDropboxJson e(QString::fromUtf8(data));
+    QDropboxJson f(QString::fromUtf8(data));
+    f.setInt("k500", -1);
+    changes = e.diff(f);
+    QVERIFY2(changes.size() == 1 && changes.first().path == "k500", "diff of large objects does not match");
+
+    // repeated elements are matched once each
+    QDropboxJson g("{\"a\": [1, 1, {\"x\": 2}]}");
+    QDropboxJson h("{\"a\": [{\"x\": 2}, 1, {\"x\": 2}]}");
+    changes = g.diff(h);
+    QVERIFY2(changes.size() == 2 && changes.at(0).type == QDropboxJsonChange::Removed && changes.at(0).path == "a[1]" &&
+             changes.at(1).type == QDropboxJsonChange::Added && changes.at(1).path == "a[2]", "repeated elements matched twice");
+}
+
+/**
+ * @brief QDropboxJson: snapshots of sub JSONs
+ * A snapshot holds only the saved JSON, parsed completely, even if the rest of the document
+ * was never accessed. Saving the same JSON twice writes the same bytes.
+ */
+void QtDropboxTest::jsonCase37()
+{
+    QDropboxJson json("{\"path\": \"/\", \"hash\": \"h\", \"contents\": ["
+                      "{\"path\": \"/a\", \"photo_info\": {\"lat_long\": [1.5, 2.5]}}, "
+                      "{\"path\": \"/b\\u00e4\", \"bytes\": 2, \"photo_info\": {\"lat_long\": [3.5, 4.5]}}]}");
+    QDropboxJson entry = json.getJsonArray("contents").at(1);
+
+    QByteArray data = QDropboxJsonSnapshot::save(entry);
+    QVERIFY2(data == QDropboxJsonSnapshot::save(entry), "snapshot not reproducible");
+
+    qdropboxjson_snapshot_header header;
+    memcpy(&header, data.constData(), sizeof(header));
+    QVERIFY2(header.root == 0 && header.sourceSize == 0 && header.nodeCount == 7, "snapshot holds more than the entry");
+
+    QDropboxJson loaded;
+    QVERIFY2(QDropboxJsonSnapshot::load(data, &loaded) && loaded.compare(entry) == 0, "loaded entry does not match");
+    QVERIFY2(loaded.getString("path") == QString::fromUtf8("/b\xc3\xa4") && loaded.diff(entry).isEmpty(),
+             "loaded entry does not match");
+
+    // a span of an unparsed object has to lie inside of the source
+    QByteArray corrupt = data;
+    qdropboxjson_node root;
+    memcpy(&root, corrupt.constData() + sizeof(header), sizeof(root));
+    root.flags |= QDROPBOXJSON_NODE_LAZY;
+    root.offset = 0;
+    root.length = 0;
+    memcpy(corrupt.data() + sizeof(header), &root, sizeof(root));
+    QVERIFY2(!QDropboxJsonSnapshot::load(corrupt, &loaded), "empty span loaded");
+}
+
+/**
+ * @brief QDropboxJson: scanner throughput
+ * Parses a large directory listing with every implementation of the scanner and prints the
+ * throughput of parse() (skips the contents) and of a full parse of all entries.
+ */
+void QtDropboxTest::jsonBenchmark1()
+{
+    QByteArray json("{\"hash\": \"abc\", \"is_dir\": true, \"contents\": [");
+    for(int i=0; i<20000; ++i)
+    {
+        if(i > 0)
+            json += ", ";
+        json += QString("{\"size\": \"%1 KB\", \"rev\": \"%2\", \"thumb_exists\": false, \"bytes\": %3, "
+                        "\"modified\": \"Sat, 21 Aug 2010 22:31:20 +0000\", \"path\": \"/Photos/Holiday %4/IMG_%5.jpg\", "
+                        "\"is_dir\": false, \"icon\": \"page_white_picture\", \"root\": \"dropbox\", "
+                        "\"mime_type\": \"image/jpeg\", \"revision\": %5}")
+                .arg(i).arg(i*7919, 8, 16, QChar('0')).arg(i*1024).arg(i/100).arg(i).toUtf8();
+    }
+    json += "]}";
+
+    const char *names[] = { "scalar", "sse2", "avx2" };
+    for(int i=QDropboxJsonScanner::Scalar; i<=QDropboxJsonScanner::AVX2; ++i)
+    {
+        if(!QDropboxJsonScanner::setImplementation(QDropboxJsonScanner::Implementation(i)))
+            continue;
+
+        qint64 scan = 0;
+        qint64 full = 0;
+        QElapsedTimer timer;
+        for(int run=0; run<5; ++run)
+        {
+            timer.start();
+            QDropboxJson parsed;
+            parsed.parseUtf8(json);
+            scan += timer.nsecsElapsed();
+
+            timer.start();
+            QDropboxJsonArray contents = parsed.getJsonArray("contents");
+            int valid = 0;
+            for(int j=0; j<contents.size(); ++j)
+                valid += QDropboxJson(contents.at(j)).isValid() ? 1 : 0;
+            full += timer.nsecsElapsed();
+            QVERIFY2(valid == 20000, "entries not valid");
+        }
+
+        qDebug() << names[i] << ": scan" << (5.0*json.size()/qMax<qint64>(scan, 1)) << "GB/s, full"
+                 << (5.0*json.size()/qMax<qint64>(full, 1)) << "GB/s";
+    }
+
+    QDropboxJsonScanner::setImplementation(QDropboxJsonScanner::bestImplementation());
+}
+
 /**
  * @brief QDropbox: Plaintext Connection
  * This test connects to Dropbox and sends a dummy request to check that the connection in
@@ -231,6 +1209,258 @@ void QtDropboxTest::dropboxCase1()
     return;
 }
 
+/**
+ * @brief QDropbox: concurrent replies
+ * Sends several requests at once and checks that every reply receives its own result.
+ * <b>Requires authorization like dropboxCase1.</b>
+ */
+void QtDropboxTest::dropboxCase2()
+{
+    QDropbox dropbox(APP_KEY, APP_SECRET);
+    QVERIFY2(connectDropbox(&dropbox, QDropbox::Plaintext), "connection error");
+
+    QDropboxReply *account  = dropbox.accountInfo();
+    QDropboxReply *root     = dropbox.metadata("/dropbox");
+    QDropboxReply *notFound = dropbox.metadata("/dropbox/qtdropbox-does-not-exist");
+    QVERIFY2(account->requestNumber() != root->requestNumber(), "requests share a number");
+
+    QVERIFY2(notFound->waitForFinished() == false, "missing file was found");
+    QVERIFY2(notFound->error() == QDropbox::FileNotFound, "wrong error of missing file");
+    QVERIFY2(root->waitForFinished(), "metadata request failed");
+    QVERIFY2(root->metadata().isDir(), "metadata of wrong request");
+    QVERIFY2(account->waitForFinished(), "account request failed");
+    QVERIFY2(account->account().uid() != 0, "account of wrong request");
+    QVERIFY2(account->isFinished() && account->elapsed() >= 0, "reply not finished");
+
+    delete account;
+    delete root;
+    delete notFound;
+    return;
+}
+
+/**
+ * @brief QDropbox: blocking calls
+ * Waits for a blocking call while another request is running, then repeats the blocking
+ * calls through a network thread. <b>Requires authorization like dropboxCase1.</b>
+ */
+void QtDropboxTest::dropboxCase3()
+{
+    QDropbox dropbox(APP_KEY, APP_SECRET);
+    QVERIFY2(connectDropbox(&dropbox, QDropbox::Plaintext), "connection error");
+
+    // the running request may finish during the blocking call, the call still gets its own result
+    QDropboxReply *root = dropbox.metadata("/dropbox");
+    QDropboxAccount account = dropbox.requestAccountInfoAndWait();
+    QVERIFY2(account.uid() != 0, "blocking call returned wrong result");
+    QVERIFY2(root->waitForFinished(), "metadata request failed");
+    QVERIFY2(root->metadata().isDir(), "metadata of wrong request");
+    delete root;
+
+    // the test thread sleeps while the network thread handles the requests
+    QDropbox *networked = new QDropbox(APP_KEY, APP_SECRET, QDropbox::Plaintext);
+    networked->setToken(dropbox.token());
+    networked->setTokenSecret(dropbox.tokenSecret());
+    networked->startNetworkThread();
+    QVERIFY2(networked->requestMetadataAndWait("/dropbox").isDir(), "metadata through network thread failed");
+    QVERIFY2(networked->requestAccountInfoAndWait().uid() == account.uid(), "account through network thread failed");
+
+    // QDropbox is destroyed on its network thread, which quits afterwards
+    QThread *networkThread = networked->thread();
+    networked->deleteLater();
+    QVERIFY2(networkThread->wait(10000), "network thread not stopped");
+    delete networkThread;
+    return;
+}
+
+/**
+ * @brief QDropboxSession: clients
+ * Authorizes a QDropbox, hands its token to a session and sends requests through two
+ * clients of the session. <b>Requires authorization like dropboxCase1.</b>
+ */
+void QtDropboxTest::dropboxCase4()
+{
+    QDropbox dropbox(APP_KEY, APP_SECRET);
+    QVERIFY2(connectDropbox(&dropbox, QDropbox::Plaintext), "connection error");
+
+    QDropboxSession session(APP_KEY, APP_SECRET);
+    session.setToken(dropbox.token(), dropbox.tokenSecret());
+    QVERIFY2(session.token() == dropbox.token(), "token not stored");
+
+    QDropboxClient first  = session.client();
+    QDropboxClient second = session.client();
+    QVERIFY2(first.isValid() && !QDropboxClient().isValid(), "invalid client");
+
+    QDropboxReply *root = second.metadata("/dropbox");
+    QVERIFY2(first.requestAccountInfoAndWait().uid() != 0, "account request failed");
+    QVERIFY2(first.error() == QDropbox::NoError, "error of account request");
+
+    second.requestMetadataAndWait("/dropbox/qtdropbox-does-not-exist");
+    QVERIFY2(second.error() == QDropbox::FileNotFound, "wrong error of missing file");
+    QVERIFY2(first.error() == QDropbox::NoError, "error of other client");
+
+    QVERIFY2(root->waitForFinished(), "metadata request failed");
+    QVERIFY2(root->metadata().isDir(), "metadata of wrong request");
+    root->deleteLater();
+    return;
+}
+
+//! Finished network reply with a fixed status and body, handed to QDropbox instead of a real one
+class QtDropboxTestReply : public QNetworkReply
+{
+public:
+    QtDropboxTestReply(const QUrl &url, int status, const QByteArray &body) :
+        _body(body),
+        _pos(0)
+    {
+        setUrl(url);
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute, status);
+        open(QIODevice::ReadOnly);
+        setFinished(true);
+    }
+
+    void abort()
+    {
+    }
+
+    qint64 bytesAvailable() const
+    {
+        return _body.size() - _pos + QNetworkReply::bytesAvailable();
+    }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize)
+    {
+        const qint64 size = qMin(maxSize, qint64(_body.size() - _pos));
+        memcpy(data, _body.constData() + _pos, size_t(size));
+        _pos += size;
+        return size;
+    }
+
+private:
+    QByteArray _body;
+    qint64     _pos;
+};
+
+/**
+ * @brief QDropbox: retried metadata stream
+ * A streamed metadata request that is answered with 503 is retried, the retry still streams
+ * the entries to metadataContentReceived(). The request goes to a local port nothing listens
+ * on, the answers are passed in directly before the event loop runs. The types of the signals
+ * are registered by QDropbox, so they can be queued to other threads.
+ */
+void QtDropboxTest::dropboxCase5()
+{
+    QDropbox dropbox(APP_KEY, APP_SECRET, QDropbox::Plaintext, "127.0.0.1:1");
+    QVERIFY2(QMetaType::type("QDropboxFileInfo") != QMetaType::UnknownType &&
+             QMetaType::type("QList<QDropboxFileInfo>") != QMetaType::UnknownType &&
+             QMetaType::type("QDropboxAccount") != QMetaType::UnknownType, "signal types can not be queued");
+    QSignalSpy entries(&dropbox, SIGNAL(metadataContentReceived(QDropboxFileInfo)));
+
+    QDropboxReply *root = dropbox.metadata("/dropbox");
+    const int      nr   = root->requestNumber();
+
+    const QUrl url("https://127.0.0.1:1/1/metadata/dropbox");
+    QtDropboxTestReply unavailable(url, 503, "");
+    QNetworkReply *reply = &unavailable;
+    QMetaObject::invokeMethod(&dropbox, "requestFinished", Q_ARG(int, nr), Q_ARG(QNetworkReply*, reply));
+    QVERIFY2(!root->isFinished(), "request not retried");
+
+    QtDropboxTestReply found(url, 200, "{\"path\": \"/dropbox\", \"is_dir\": true, \"contents\": ["
+                                       "{\"path\": \"/dropbox/a\"}, {\"path\": \"/dropbox/b\"}]}");
+    reply = &found;
+    QMetaObject::invokeMethod(&dropbox, "requestFinished", Q_ARG(int, nr), Q_ARG(QNetworkReply*, reply));
+    QVERIFY2(entries.count() == 2, "entries not streamed after the retry");
+    QVERIFY2(root->waitForFinished() && root->metadata().isDir(), "metadata of the retry lost");
+    delete root;
+}
+
+/**
+ * @brief QDropbox: streamed metadata parsed in background
+ * A streamed response that is kept for the reply is parsed by the parser pool when parsing
+ * in background is enabled. A first request takes the only token of the rate limit, so the
+ * metadata request stays queued and its answer is passed in directly.
+ */
+void QtDropboxTest::dropboxCase6()
+{
+    QDropbox dropbox(APP_KEY, APP_SECRET, QDropbox::Plaintext, "127.0.0.1:1");
+    dropbox.setParseInBackground(true);
+    dropbox.setRateLimit(0.5);
+    QSignalSpy entries(&dropbox, SIGNAL(metadataContentReceived(QDropboxFileInfo)));
+    QSignalSpy infos(&dropbox, SIGNAL(fileInfoReceived(QDropboxFileInfo)));
+
+    QDropboxReply *account = dropbox.accountInfo();
+    QDropboxReply *root    = dropbox.metadata("/dropbox");
+    const int      nr      = root->requestNumber();
+    QVERIFY2(dropbox.queuedRequests(QDropbox::NormalPriority) == 1, "request not queued");
+
+    QtDropboxTestReply found(QUrl("https://127.0.0.1:1/1/metadata/dropbox"), 200,
+                             "{\"path\": \"/dropbox\", \"is_dir\": true, \"contents\": ["
+                             "{\"path\": \"/dropbox/a\"}, {\"path\": \"/dropbox/b\"}]}");
+    QNetworkReply *reply = &found;
+    QMetaObject::invokeMethod(&dropbox, "requestFinished", Q_ARG(int, nr), Q_ARG(QNetworkReply*, reply));
+    QVERIFY2(entries.count() == 2 && !root->isFinished(), "response not parsed in background");
+    QVERIFY2(root->waitForFinished() && root->metadata().isDir() && infos.count() == 1,
+             "metadata parsed in background lost");
+    delete account;
+    delete root;
+}
+
+/**
+ * @brief QDropbox: request statistics, host limit and rate limit
+ * Requests wait for a free connection of their host and for the rate limit, the statistics
+ * count them until they are finished and the slots of finished requests are reused. The
+ * requests go to a local port nothing listens on and no event loop runs, so they stay in
+ * flight until their answer is passed in directly.
+ */
+void QtDropboxTest::dropboxCase7()
+{
+    QDropbox dropbox(APP_KEY, APP_SECRET, QDropbox::Plaintext, "127.0.0.1:1");
+    const QString host = "127.0.0.1:1";
+    QVERIFY2(dropbox.maxRequestsPerHost(host) == 6 && dropbox.rateLimit() == 20, "wrong default limits");
+
+    // one of two connections is kept free for interactive requests
+    dropbox.setMaxRequestsPerHost(host, 2);
+    QVERIFY2(dropbox.maxRequestsPerHost(host) == 2, "host limit not set");
+    QDropboxReply *account = dropbox.accountInfo();
+    QDropboxReply *first   = dropbox.metadata("/dropbox/a");
+    QDropboxReply *second  = dropbox.metadata("/dropbox/b");
+    QVERIFY2(dropbox.queuedRequests(QDropbox::NormalPriority) == 2, "host limit not applied");
+
+    dropbox.setPriority(QDropbox::InteractivePriority);
+    QDropboxReply *interactive = dropbox.metadata("/dropbox");
+    dropbox.setPriority(QDropbox::NormalPriority);
+    QVERIFY2(dropbox.queuedRequests(QDropbox::InteractivePriority) == 0, "free connection not used");
+
+    qdropbox_request_statistics statistics = dropbox.requestStatistics();
+    QVERIFY2(statistics.inFlight == 4 && statistics.total == 4 && statistics.queued == 2 &&
+             statistics.capacity == 4, "wrong statistics of queued requests");
+
+    // a higher host limit lets the next request go, the rate limit holds the last one back
+    dropbox.setRateLimit(0.5);
+    QVERIFY2(dropbox.rateLimit() == 0.5, "rate limit not set");
+    dropbox.setMaxRequestsPerHost(host, 6);
+    QVERIFY2(dropbox.queuedRequests(QDropbox::NormalPriority) == 1, "rate limit not applied");
+    QVERIFY2(dropbox.requestStatistics().queued == 1, "wrong number of queued requests");
+
+    // finished requests leave the statistics, their slots are reused
+    const int nr = account->requestNumber();
+    QtDropboxTestReply answer(QUrl("https://127.0.0.1:1/1/account/info"), 200, "{\"uid\": 1, \"display_name\": \"A\"}");
+    QNetworkReply *reply = &answer;
+    QMetaObject::invokeMethod(&dropbox, "requestFinished", Q_ARG(int, nr), Q_ARG(QNetworkReply*, reply));
+    QVERIFY2(account->isFinished(), "account request not finished");
+
+    QDropboxReply *third = dropbox.metadata("/dropbox/c");
+    statistics = dropbox.requestStatistics();
+    QVERIFY2(statistics.inFlight == 4 && statistics.total == 5 && statistics.queued == 2 &&
+             statistics.capacity == 4, "wrong statistics after a finished request");
+
+    delete account;
+    delete first;
+    delete second;
+    delete interactive;
+    delete third;
+}
+
 /**
  * @brief Prompt the user for authorization.
  */
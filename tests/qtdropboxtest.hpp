@@ -3,6 +3,9 @@
 
 #include <QtTest>
 #include <QDesktopServices>
+#include <QBuffer>
+#include <QTemporaryFile>
+#include <QtConcurrentMap>
 #include "qtdropbox.h"
 #include "keys.hpp"
 
@@ -31,9 +34,43 @@ private Q_SLOTS:
     void jsonCase13();
     void jsonCase14();
     void jsonCase15();
+    void jsonCase16();
+    void jsonCase17();
+    void jsonCase18();
+    void jsonCase19();
+    void jsonCase20();
+    void jsonCase21();
+    void jsonCase22();
+    void jsonCase23();
+    void jsonCase24();
+    void jsonCase25();
+    void jsonCase26();
+    void jsonCase27();
+    void jsonCase28();
+    void jsonCase29();
+    void jsonCase30();
+    void jsonCase31();
+    void jsonCase32();
+    void jsonCase33();
+    void jsonCase34();
+    void jsonCase35();
+    void jsonCase36();
+    void jsonCase37();
+    void jsonBenchmark1();
+
+  /* QDropbox requests */
+    void requestCase1();
+    void requestCase2();
+    void requestCase3();
 
   /* QDropbox */
     void dropboxCase1();
+    void dropboxCase2();
+    void dropboxCase3();
+    void dropboxCase4();
+    void dropboxCase5();
+    void dropboxCase6();
+    void dropboxCase7();
 
 private:
     void authorizeApplication(QDropbox *d);
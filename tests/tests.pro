@@ -5,6 +5,7 @@
 #-------------------------------------------------
 
 QT       += network testlib xml gui
+greaterThan(QT_MAJOR_VERSION, 4): QT += concurrent
 
 TARGET = qtdropboxtest
 CONFIG   += console